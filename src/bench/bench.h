@@ -0,0 +1,17 @@
+#pragma once
+#include <chrono>
+
+/**
+ * Shared timing for the benchmarks.
+ */
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The seconds since start.
+ */
+inline double
+getSeconds(Clock::time_point start)
+{
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
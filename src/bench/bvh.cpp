@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "./bench.h"
+#include "viz/bunny-model.h"
+#include "viz/geo/bvh.h"
+#include "viz/parallel.h"
+
+/**
+ * Measures how long it takes to build a BVH over the bunny, and how many rays a
+ * second it can trace, on one thread and on every thread.
+ *
+ * make ./bin/bench-bvh RELEASE=1 && ./bin/bench-bvh
+ */
+
+using namespace viz;
+
+static const size_t RAY_COUNT = 1 << 20;
+static const size_t BUILD_RUNS = 20;
+
+/**
+ * Rays from a sphere around the mesh, aimed at random points within its bounds,
+ * so that roughly half of them hit.
+ */
+static std::vector<Ray>
+generateRays(Mesh const& mesh, size_t count)
+{
+  std::array<float, 3> low{ INFINITY, INFINITY, INFINITY };
+  std::array<float, 3> high{ -INFINITY, -INFINITY, -INFINITY };
+  for (auto position : mesh.positions) {
+    for (uint32_t i = 0; i < 3; i++) {
+      low[i] = std::min(low[i], position[i]);
+      high[i] = std::max(high[i], position[i]);
+    }
+  }
+  std::array<float, 3> center{};
+  float radius = 0.0f;
+  for (uint32_t i = 0; i < 3; i++) {
+    center[i] = (low[i] + high[i]) / 2;
+    radius = std::max(radius, high[i] - low[i]);
+  }
+
+  std::mt19937 random{ 1234 };
+  std::normal_distribution<float> normal{};
+  std::uniform_real_distribution<float> unit{ 0.0f, 1.0f };
+
+  std::vector<Ray> rays{};
+  rays.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    Vector3 onSphere{ normal(random), normal(random), normal(random) };
+    onSphere = GLKVector3Normalize(onSphere);
+    Vector3 origin{ center[0] + onSphere[0] * radius,
+                    center[1] + onSphere[1] * radius,
+                    center[2] + onSphere[2] * radius };
+    Vector3 target{ low[0] + (high[0] - low[0]) * unit(random),
+                    low[1] + (high[1] - low[1]) * unit(random),
+                    low[2] + (high[2] - low[2]) * unit(random) };
+    rays.push_back(Ray{
+      .origin = origin,
+      .direction = GLKVector3Subtract(target, origin),
+    });
+  }
+  return rays;
+}
+
+template<typename Trace>
+static void
+benchRays(const char* name,
+          std::vector<Ray> const& rays,
+          size_t threadCount,
+          Trace trace)
+{
+  std::atomic<size_t> hitCount = 0;
+  auto start = Clock::now();
+  if (threadCount == 1) {
+    size_t hits = 0;
+    for (auto const& ray : rays) {
+      hits += trace(ray) ? 1 : 0;
+    }
+    hitCount = hits;
+  } else {
+    size_t grainSize = 4096;
+    ParallelFor(rays.size() / grainSize, 1, [&](size_t chunk) {
+      size_t hits = 0;
+      for (size_t i = chunk * grainSize; i < (chunk + 1) * grainSize; i++) {
+        hits += trace(rays[i]) ? 1 : 0;
+      }
+      hitCount += hits;
+    });
+  }
+  double seconds = getSeconds(start);
+
+  std::printf("%-12s %2zu thread(s) %8.2f Mrays/s  (%.1f%% hit)\n",
+              name,
+              threadCount,
+              rays.size() / seconds / 1e6,
+              100.0 * hitCount / rays.size());
+}
+
+int
+main()
+{
+  Mesh bunny = loadBunnyMesh();
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < BUILD_RUNS; i++) {
+    Bvh bvh{ bunny };
+  }
+  double buildSeconds = getSeconds(start) / BUILD_RUNS;
+
+  Bvh bvh{ bunny };
+  std::printf("Built a BVH over %zu cells in %.2fms, with %zu nodes\n",
+              bunny.cells.size(),
+              buildSeconds * 1e3,
+              bvh.GetNodeCount());
+
+  auto rays = generateRays(bunny, RAY_COUNT);
+  auto closest = [&](Ray const& ray) { return bvh.Intersect(ray).has_value(); };
+  auto any = [&](Ray const& ray) { return bvh.IsOccluded(ray); };
+
+  benchRays("closest-hit", rays, 1, closest);
+  benchRays("any-hit", rays, 1, any);
+  if (GetThreadCount() > 1) {
+    benchRays("closest-hit", rays, GetThreadCount(), closest);
+    benchRays("any-hit", rays, GetThreadCount(), any);
+  }
+}
@@ -0,0 +1,61 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "./bench.h"
+#include "viz/geo/icosphere.h"
+#include "viz/parallel.h"
+
+/**
+ * Compares generateIcosphere, which subdivides level by level, against
+ * generateIcosphereLattice, which builds the final level directly on every
+ * face of the icosahedron, in parallel.
+ *
+ * make ./bin/bench-icosphere RELEASE=1 && ./bin/bench-icosphere
+ */
+
+using namespace viz;
+
+/**
+ * The best time out of a few runs, in milliseconds. The larger levels take
+ * long enough that fewer runs are needed.
+ */
+template<typename Fn>
+static double
+timeRuns(size_t runs, Fn fn)
+{
+  double best = INFINITY;
+  for (size_t i = 0; i < runs; i++) {
+    auto start = Clock::now();
+    fn();
+    best = std::min(best, getSeconds(start) * 1e3);
+  }
+  return best;
+}
+
+int
+main()
+{
+  std::printf("%zu threads\n", GetThreadCount());
+  for (size_t subdivisions = 5; subdivisions <= 9; subdivisions++) {
+    IcosphereInitializer initializer{ .subdivisions = subdivisions };
+    size_t runs = subdivisions <= 7 ? 10 : 3;
+    size_t vertexCount = 0;
+
+    double subdivideMs = timeRuns(runs, [&]() {
+      vertexCount = generateIcosphere(initializer).positions.size();
+    });
+    double latticeMs = timeRuns(runs, [&]() {
+      vertexCount = generateIcosphereLattice(initializer).positions.size();
+    });
+
+    std::printf("icosphere-%zu %9zu vertices  subdivide %9.2fms  "
+                "lattice %8.2fms  %5.1fx\n",
+                subdivisions,
+                vertexCount,
+                subdivideMs,
+                latticeMs,
+                subdivideMs / latticeMs);
+  }
+  return 0;
+}
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "./bench.h"
+#include "viz/geo/icosphere.h"
+#include "viz/geo/import.h"
+#include "viz/parallel.h"
+
+/**
+ * Measures how many MB a second the OBJ and PLY importers read, on a large
+ * icosphere written out in each format.
+ *
+ * make ./bin/bench-import RELEASE=1 && ./bin/bench-import
+ */
+
+using namespace viz;
+
+static const size_t RUNS = 5;
+
+static void
+writeObj(std::filesystem::path const& path, Mesh const& mesh)
+{
+  std::ofstream file(path);
+  char line[128];
+  for (auto const& p : mesh.positions) {
+    std::snprintf(line, sizeof(line), "v %.9g %.9g %.9g\n", p[0], p[1], p[2]);
+    file << line;
+  }
+  for (auto const& n : mesh.normals) {
+    std::snprintf(line, sizeof(line), "vn %.9g %.9g %.9g\n", n[0], n[1], n[2]);
+    file << line;
+  }
+  for (auto const& cell : mesh.cells) {
+    std::snprintf(line,
+                  sizeof(line),
+                  "f %u//%u %u//%u %u//%u\n",
+                  cell[0] + 1,
+                  cell[0] + 1,
+                  cell[1] + 1,
+                  cell[1] + 1,
+                  cell[2] + 1,
+                  cell[2] + 1);
+    file << line;
+  }
+}
+
+static void
+writePly(std::filesystem::path const& path, Mesh const& mesh, bool binary)
+{
+  std::ofstream file(path, std::ios::binary);
+  file << "ply\n"
+       << (binary ? "format binary_little_endian 1.0\n" : "format ascii 1.0\n")
+       << "element vertex " << mesh.positions.size() << "\n"
+       << "property float x\nproperty float y\nproperty float z\n"
+       << "property float nx\nproperty float ny\nproperty float nz\n"
+       << "element face " << mesh.cells.size() << "\n"
+       << "property list uchar uint vertex_indices\n"
+       << "end_header\n";
+
+  char line[128];
+  for (size_t i = 0; i < mesh.positions.size(); i++) {
+    auto const& p = mesh.positions[i];
+    auto const& n = mesh.normals[i];
+    if (binary) {
+      float values[6] = { p[0], p[1], p[2], n[0], n[1], n[2] };
+      file.write(reinterpret_cast<const char*>(values), sizeof(values));
+    } else {
+      std::snprintf(line,
+                    sizeof(line),
+                    "%.9g %.9g %.9g %.9g %.9g %.9g\n",
+                    p[0],
+                    p[1],
+                    p[2],
+                    n[0],
+                    n[1],
+                    n[2]);
+      file << line;
+    }
+  }
+  for (auto const& cell : mesh.cells) {
+    if (binary) {
+      uint8_t count = 3;
+      file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+      file.write(reinterpret_cast<const char*>(cell.data()), sizeof(cell));
+    } else {
+      std::snprintf(
+        line, sizeof(line), "3 %u %u %u\n", cell[0], cell[1], cell[2]);
+      file << line;
+    }
+  }
+}
+
+template<typename Import>
+static void
+benchImport(const char* name,
+            std::filesystem::path const& path,
+            Mesh const& mesh,
+            Import import)
+{
+  double bytes = static_cast<double>(std::filesystem::file_size(path));
+  // Read it once so that it is in the page cache, and this measures parsing
+  // rather than the disk.
+  Mesh imported = import(path);
+  bool matches = imported.positions.size() == mesh.positions.size() &&
+                 imported.cells == mesh.cells;
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < RUNS; i++) {
+    import(path);
+  }
+  double seconds = getSeconds(start) / RUNS;
+
+  std::printf("%-12s %8.1fMB %8.2fms %8.1f MB/s %s\n",
+              name,
+              bytes / 1e6,
+              seconds * 1e3,
+              bytes / seconds / 1e6,
+              matches ? "" : "(mismatch)");
+  std::filesystem::remove(path);
+}
+
+int
+main()
+{
+  Mesh mesh = generateIcosphere({ .subdivisions = 9 });
+  std::printf("Importing %zu vertices and %zu cells on %zu threads\n",
+              mesh.positions.size(),
+              mesh.cells.size(),
+              GetThreadCount());
+
+  auto directory = std::filesystem::temp_directory_path();
+  writeObj(directory / "bench-import.obj", mesh);
+  benchImport("obj", directory / "bench-import.obj", mesh, importObj);
+
+  writePly(directory / "bench-import.ply", mesh, false);
+  benchImport("ply ascii", directory / "bench-import.ply", mesh, importPly);
+
+  writePly(directory / "bench-import-binary.ply", mesh, true);
+  benchImport(
+    "ply binary", directory / "bench-import-binary.ply", mesh, importPly);
+  return 0;
+}
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "./bench.h"
+#include "viz/bunny-model.h"
+#include "viz/geo/icosphere.h"
+#include "viz/geo/mesh-file.h"
+
+/**
+ * Measures how long it takes to open a mesh file and get at its streams, next
+ * to copying the same mesh into a Mesh. Opening only maps the file, so it
+ * should take the same few microseconds no matter how large the mesh is.
+ *
+ * make ./bin/bench-mesh-file RELEASE=1 && ./bin/bench-mesh-file
+ */
+
+using namespace viz;
+
+static const size_t OPEN_RUNS = 1000;
+static const size_t COPY_RUNS = 20;
+
+static void
+benchMeshFile(const char* name, Mesh const& mesh)
+{
+  auto path = std::filesystem::temp_directory_path() /
+              (std::string("bench-") + name + ".vizmesh");
+  writeMeshFile(path, mesh);
+
+  // Touch the spans so that the open isn't optimized out, but don't read
+  // through them, as that is the cost of using the data, not of loading it.
+  size_t checksum = 0;
+  auto start = Clock::now();
+  for (size_t i = 0; i < OPEN_RUNS; i++) {
+    MeshFile file{ path };
+    checksum += file.GetPositions().size() + file.GetCells().size();
+  }
+  double openSeconds = getSeconds(start) / OPEN_RUNS;
+
+  start = Clock::now();
+  for (size_t i = 0; i < COPY_RUNS; i++) {
+    MeshFile file{ path };
+    checksum += file.ToMesh().positions.size();
+  }
+  double copySeconds = getSeconds(start) / COPY_RUNS;
+
+  std::printf("%-12s %8zu vertices %8.2fus open %10.2fus copy  (%zu)\n",
+              name,
+              mesh.positions.size(),
+              openSeconds * 1e6,
+              copySeconds * 1e6,
+              checksum);
+  std::filesystem::remove(path);
+}
+
+int
+main()
+{
+  benchMeshFile("bunny", loadBunnyMesh());
+  for (size_t subdivisions : { 5, 7 }) {
+    std::string name = "icosphere-" + std::to_string(subdivisions);
+    benchMeshFile(name.c_str(),
+                  generateIcosphere({ .subdivisions = subdivisions }));
+  }
+  return 0;
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring> // std::memcmp
+#include <string>
+#include <vector>
+
+#include "./bench.h"
+#include "viz/bunny-model.h"
+#include "viz/geo/icosphere.h"
+#include "viz/geo/normals.h"
+#include "viz/math.h"
+#include "viz/parallel.h"
+
+/**
+ * Compares the scattering ComputeAngleNormalsPacked from viz/math.h against
+ * the gathering computeAngleNormalsPackedParallel from viz/geo/normals.h, and
+ * checks that they agree bit for bit. Then times the SIMD kernels of
+ * computeAngleNormals, and how far they are from the scattered normals, and
+ * the incremental updates of IncrementalNormals.
+ *
+ * make ./bin/bench-normals RELEASE=1 && ./bin/bench-normals
+ */
+
+using namespace viz;
+
+static const size_t RUNS = 20;
+
+/**
+ * The best time out of a few runs, in milliseconds.
+ */
+template<typename Fn>
+static double
+timeRuns(Fn fn)
+{
+  double best = INFINITY;
+  for (size_t i = 0; i < RUNS; i++) {
+    auto start = Clock::now();
+    fn();
+    best = std::min(best, getSeconds(start) * 1e3);
+  }
+  return best;
+}
+
+/**
+ * The largest angle between two sets of normals, in degrees.
+ */
+static double
+getMaxAngle(std::span<const float> a, std::span<const float> b)
+{
+  double maxAngle = 0.0;
+  for (size_t i = 0; i < a.size(); i += 3) {
+    double cx = a[i + 1] * b[i + 2] - a[i + 2] * b[i + 1];
+    double cy = a[i + 2] * b[i] - a[i] * b[i + 2];
+    double cz = a[i] * b[i + 1] - a[i + 1] * b[i];
+    double dot = a[i] * b[i] + a[i + 1] * b[i + 1] + a[i + 2] * b[i + 2];
+    double angle = std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot);
+    maxAngle = std::max(maxAngle, angle * 180.0 / M_PI);
+  }
+  return maxAngle;
+}
+
+static void
+benchNormals(const char* name, Mesh mesh)
+{
+  std::span<uint32_t> cells{ mesh.cells[0].data(), mesh.cells.size() * 3 };
+  std::span<float> positions{ mesh.positions[0].v,
+                              mesh.positions.size() * 3 };
+
+  auto scattered = ComputeAngleNormalsPacked(cells, positions);
+  auto gathered = computeAngleNormalsPackedParallel(cells, positions);
+  bool identical =
+    scattered.size() == gathered.size() &&
+    std::memcmp(
+      scattered.data(), gathered.data(), scattered.size() * sizeof(float)) ==
+      0;
+
+  double scatterMs =
+    timeRuns([&]() { ComputeAngleNormalsPacked(cells, positions); });
+  double gatherMs =
+    timeRuns([&]() { computeAngleNormalsPackedParallel(cells, positions); });
+
+  std::printf("%-12s %8zu cells  scatter %7.2fms  gather %7.2fms  "
+              "%5.2fx on %zu threads  %s\n",
+              name,
+              cells.size() / 3,
+              scatterMs,
+              gatherMs,
+              scatterMs / gatherMs,
+              GetThreadCount(),
+              identical ? "identical" : "DIFFERENT");
+
+  // The SIMD kernels, through the Mesh version.
+  for (bool approximate : { false, true }) {
+    AngleNormalsOptions options{ .approximate = approximate };
+    computeAngleNormals(mesh, options);
+    std::span<const float> normals{ mesh.normals[0].v,
+                                    mesh.normals.size() * 3 };
+    double simdMs = timeRuns([&]() { computeAngleNormals(mesh, options); });
+    std::printf("%-12s %8s        SIMD %-11s %7.2fms  %5.2fx  "
+                "max error %.6f degrees\n",
+                "",
+                "",
+                approximate ? "approximate" : "exact",
+                simdMs,
+                scatterMs / simdMs,
+                getMaxAngle(scattered, normals));
+  }
+}
+
+/**
+ * Displace a patch of the sphere every frame, and compare updating only the
+ * patch against recomputing everything.
+ */
+static void
+benchIncremental(size_t subdivisions, float patchRadius)
+{
+  Mesh sphere = generateIcosphere({ .subdivisions = subdivisions });
+  IncrementalNormals incrementalNormals{ sphere };
+  incrementalNormals.Compute(sphere.positions, sphere.normals);
+
+  std::vector<uint32_t> patch{};
+  Vector3 center{ 0.0f, 0.0f, 1.0f };
+  for (uint32_t vertex = 0; vertex < sphere.positions.size(); vertex++) {
+    if (GLKVector3Distance(sphere.positions[vertex], center) < patchRadius) {
+      patch.push_back(vertex);
+    }
+  }
+
+  size_t frame = 0;
+  auto displace = [&]() {
+    float scale = 1.0f + 0.01f * std::sin(static_cast<float>(frame++));
+    for (auto vertex : patch) {
+      sphere.positions[vertex] =
+        GLKVector3MultiplyScalar(GLKVector3Normalize(sphere.positions[vertex]),
+                                 scale);
+    }
+  };
+
+  double incrementalMs = timeRuns([&]() {
+    displace();
+    incrementalNormals.Update(sphere.positions, patch, sphere.normals);
+  });
+  double fullMs = timeRuns([&]() {
+    displace();
+    computeAngleNormals(sphere);
+  });
+
+  std::printf("icosphere-%zu  moving %zu of %zu vertices  "
+              "incremental %7.3fms  full %7.2fms  %6.1fx\n",
+              subdivisions,
+              patch.size(),
+              sphere.positions.size(),
+              incrementalMs,
+              fullMs,
+              fullMs / incrementalMs);
+}
+
+int
+main()
+{
+  benchNormals("bunny", loadBunnyMesh());
+
+  for (size_t subdivisions : { 5, 7 }) {
+    std::string name = "icosphere-" + std::to_string(subdivisions);
+    benchNormals(name.c_str(),
+                 generateIcosphere({ .subdivisions = subdivisions }));
+  }
+
+  benchIncremental(7, 0.1f);
+  benchIncremental(7, 0.5f);
+}
@@ -13,25 +13,35 @@
 #include "./box.h"
 #include "viz/debug.h"
 #include "viz/geo/box.h"
+#include "viz/geo/vertex-layout.h"
 
 using namespace viz;
 
 struct Buffers
 {
-  BufferViewList<Vector3> positions;
-  BufferViewList<std::array<uint32_t, 3>> cells;
-  BufferViewList<Vector3> normals;
+  MeshBuffers box;
   std::vector<BufferViewStruct<Uniforms>> uniformsList;
-  uint32_t cellsSize;
 };
 
 size_t COUNT_SIDE = 50;
 size_t COUNT = COUNT_SIDE * COUNT_SIDE;
 
+/**
+ * The positions and normals are interleaved into a single buffer, which the
+ * pipeline reads through a vertex descriptor made from the same layout.
+ */
+VertexLayout BOX_LAYOUT = {
+  .attributes = {
+    { VertexAttribute::Position, mtlpp::VertexFormat::Float3 },
+    { VertexAttribute::Normal, mtlpp::VertexFormat::Float3 },
+  },
+};
+
 Buffers
 CreateBuffers(Device& device)
 {
-  auto mesh = viz::generateBox({ 1.0, 10.0, 1.0 }, { 1, 1, 1 });
+  Vector3 size{ 1.0, 10.0, 1.0 };
+  Vector3 segments{ 1, 1, 1 };
   auto cpuWrite = mtlpp::ResourceOptions::CpuCacheModeWriteCombined;
 
   std::vector<BufferViewStruct<Uniforms>> uniformsList{};
@@ -40,12 +50,11 @@ CreateBuffers(Device& device)
   }
 
   return Buffers{
-    .positions = BufferViewList<Vector3>(device, cpuWrite, mesh.positions),
-    .cells =
-      BufferViewList<std::array<uint32_t, 3>>(device, cpuWrite, mesh.cells),
-    .normals = BufferViewList<Vector3>(device, cpuWrite, mesh.normals),
-    .uniformsList = uniformsList,
-    .cellsSize = static_cast<uint32_t>(mesh.cells.size() * 3),
+    .box = MeshBuffers{ device,
+                        viz::generateBox(size, segments),
+                        BOX_LAYOUT,
+                        cpuWrite },
+    .uniformsList = std::move(uniformsList),
   };
 }
 
@@ -69,6 +78,7 @@ run()
     .depthAttachmentPixelFormat = mtlpp::PixelFormat::Depth32Float,
     .colorAttachmentPixelFormats =
       std::vector{ mtlpp::PixelFormat::BGRA8Unorm },
+    .vertexDescriptor = createVertexDescriptor(buffers.box.vertices.table),
   });
 
   auto depthState = InitializeDepthStencil({
@@ -87,7 +97,7 @@ run()
   );
 
   TickFn tickFn = [&](Tick& tick) -> void {
-    AutoDraw draw{ commandQueue, pipeline, tick };
+    AutoDraw draw{ device, commandQueue, tick };
 
     draw.Clear(0.0, 0.05, 0.1);
 
@@ -115,18 +125,18 @@ run()
         uniforms.data->position = { x, y, z };
         uniforms.data->seconds = tick.seconds;
 
+        BufferRefs vertexInputs = buffers.box.vertices.Refs();
+        vertexInputs.push_back(uniforms.Ref());
+
         draw.DrawIndexed({
           .label = "Box",
+          .renderPipelineState = pipeline,
           // DrawIndexed options plus buffers.
           .primitiveType = mtlpp::PrimitiveType::Triangle,
-          .indexCount = buffers.cellsSize,
-          .indexType = mtlpp::IndexType::UInt32,
-          .indexBuffer = buffers.cells.buffer,
-          .vertexInputs = std::vector({
-            buffers.positions.Ref(),
-            buffers.normals.Ref(),
-            uniforms.Ref(),
-          }),
+          .indexCount = buffers.box.indices.indexCount,
+          .indexType = buffers.box.indices.indexType,
+          .indexBuffer = buffers.box.indices.buffer,
+          .vertexInputs = vertexInputs,
           .fragmentInputs = std::vector({ uniforms.Ref() }),
 
           // General draw config
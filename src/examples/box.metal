@@ -2,15 +2,20 @@
 using namespace metal;
 #include "./box.h"
 
+// The attributes follow the order of BOX_LAYOUT, and the uniforms come after
+// its single buffer.
+struct Vertex
+{
+  float3 position [[attribute(0)]];
+  float3 normal [[attribute(1)]];
+};
+
 vertex Varying
-vert(const device packed_float3* vertexArray [[buffer(0)]],
-     const device packed_float3* normalArray [[buffer(1)]],
-     constant Uniforms& uniforms [[buffer(2)]],
-     unsigned int i [[vertex_id]])
+vert(Vertex in [[stage_in]], constant Uniforms& uniforms [[buffer(1)]])
 {
   Varying varying;
-  float3 position = vertexArray[i];
-  float3 modelNormal = normalArray[i];
+  float3 position = in.position;
+  float3 modelNormal = in.normal;
 
   float3 normal = normalize(uniforms.matrices.normalModelView * modelNormal);
 
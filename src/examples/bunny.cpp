@@ -11,33 +11,35 @@
 #include "viz.h"
 // Now load other extraneous things.
 #include "./bunny.h"
-#include "viz/bunny-model.h"
+#include "viz/geo/index-buffer.h"
+#include "viz/geo/mesh-file.h"
+#include "viz/utils.h" // getExecutablePath
 
 using namespace viz;
 
 struct Buffers
 {
-  mtlpp::Buffer positions;
-  mtlpp::Buffer cells;
-  mtlpp::Buffer normals;
-  mtlpp::Buffer uniforms;
-  uint32_t cellsSize;
+  BufferViewList<Vector3> positions;
+  IndexBuffer indices;
+  BufferViewList<Vector3> normals;
+  BufferViewStruct<Uniforms> uniforms;
 };
 
 Buffers
 CreateBuffers(Device& device)
 {
   auto cpuWrite = mtlpp::ResourceOptions::CpuCacheModeWriteCombined;
-  std::span<float> positions = BUNNY_POSITIONS;
-  std::span<int> cells = BUNNY_CELLS;
-  auto normals = ComputeAngleNormalsPacked(cells, positions);
+  // The bunny is baked next to the executable by `make bake`, with its normals
+  // and an optimized order, so it only needs to be mapped and uploaded.
+  MeshFile bunny{ getExecutablePath() + ".vizmesh" };
 
   return Buffers{
-    .positions = CreateBufferFromList(device, cpuWrite, positions),
-    .cells = CreateBufferFromList(device, cpuWrite, cells),
-    .normals = CreateBufferFromList(device, cpuWrite, normals),
-    .uniforms = CreateBufferFromStructType<Uniforms>(device, cpuWrite),
-    .cellsSize = static_cast<uint32_t>(cells.size()),
+    .positions =
+      BufferViewList<Vector3>(bunny.GetPositions(), device, cpuWrite),
+    .indices =
+      IndexBuffer(device, cpuWrite, bunny.GetVertexCount(), bunny.GetCells()),
+    .normals = BufferViewList<Vector3>(bunny.GetNormals(), device, cpuWrite),
+    .uniforms = BufferViewStruct<Uniforms>(device, cpuWrite),
   };
 }
 
@@ -48,8 +50,7 @@ run()
   auto commandQueue = device.NewCommandQueue();
   auto library = CreateLibraryForExample(device);
   auto buffers = CreateBuffers(device);
-
-  Uniforms* uniforms = InitializeBuffer(buffers.uniforms, Uniforms{});
+  Uniforms* uniforms = buffers.uniforms.data;
 
   // This creates a render pipeline configuration that can be used to create a
   // pipeline state object. Right now, we only care about setting up a vertex
@@ -81,7 +82,7 @@ run()
   );
 
   TickFn tickFn = [&](Tick& tick) -> void {
-    AutoDraw draw{ commandQueue, pipeline, tick };
+    AutoDraw draw{ device, commandQueue, tick };
     draw.Clear(0.0, 0.0, 0.0);
 
     auto projection = Matrix4::MakePerspective(
@@ -94,11 +95,12 @@ run()
 
     draw.DrawIndexed({
       .label = "Bunny",
+      .renderPipelineState = pipeline,
       // DrawIndexed options plus buffers.
       .primitiveType = mtlpp::PrimitiveType::Triangle,
-      .indexCount = buffers.cellsSize,
-      .indexType = mtlpp::IndexType::UInt32,
-      .indexBuffer = buffers.cells,
+      .indexCount = buffers.indices.indexCount,
+      .indexType = buffers.indices.indexType,
+      .indexBuffer = buffers.indices.buffer,
       .vertexInputs = std::vector({
         buffers.positions.Ref(),
         buffers.normals.Ref(),
@@ -1,6 +1,7 @@
 #include <GLKit/GLKMath.h>
 #include <assert.h> // assert
 #include <cmath>
+#include <filesystem>
 #include <functional>
 #include <iostream> // std::cout
 #include <math.h>   // fmod
@@ -14,7 +15,10 @@
 #include "./sphere.h"
 #include "viz/draw/big-triangle.h"
 #include "viz/draw/texture.h"
-#include "viz/geo/icosphere.h"
+#include "viz/geo/mesh-cache.h"
+#include "viz/geo/mesh-file.h"
+#include "viz/geo/static-mesh.h"
+#include "viz/utils.h" // getExecutablePath
 
 using namespace viz;
 
@@ -49,18 +53,45 @@ float BIG_SPHERE_RADIUS = 0.9f;
 float SPHERE_ROTATE_X = -0.01f;
 float SPHERE_ROTATE_Y = 0.03f;
 
+/**
+ * The big sphere is baked next to the executable by `make bake`, so it only
+ * needs to be mapped and uploaded. When the example is built without it, the
+ * sphere is generated through the mesh cache instead, which persists it so that
+ * only the first launch pays for it.
+ */
+MeshBuffers
+LoadBigSphere(Device& device, mtlpp::ResourceOptions options)
+{
+  std::filesystem::path baked = getExecutablePath() + ".vizmesh";
+  if (std::filesystem::exists(baked)) {
+    viz::MeshFile file{ baked };
+    return MeshBuffers{ device,
+                        file.GetCounts(),
+                        [&](viz::MeshSpans spans) { file.Write(spans); },
+                        options };
+  }
+  viz::setMeshCacheDirectory(viz::getDefaultMeshCacheDirectory());
+  auto mesh = viz::getCachedIcosphere({ .subdivisions = 3, .radius = 1.0f });
+  return MeshBuffers{ device, *mesh, options };
+}
+
 Scene
 CreateScene(Device& device)
 {
-  auto bigMesh = viz::generateIcosphere({ .subdivisions = 3, .radius = 1.0f });
-  auto littleMesh =
-    viz::generateIcosphere({ .subdivisions = 2, .radius = 1.0f });
+  // The small spheres are built into the binary, so there is nothing to
+  // generate or load for them.
+  auto const& littleMesh = viz::STATIC_ICOSPHERE<2>;
   auto cpuWrite = mtlpp::ResourceOptions::CpuCacheModeWriteCombined;
   auto library = CreateLibraryForExample(device);
 
   return Scene{
-    .bigSphereBuffers = MeshBuffers{ device, bigMesh, cpuWrite },
-    .smallSphereBuffers = MeshBuffers{ device, littleMesh, cpuWrite },
+    .bigSphereBuffers = LoadBigSphere(device, cpuWrite),
+    .smallSphereBuffers = MeshBuffers{ device,
+                                       littleMesh.counts,
+                                       [&](viz::MeshSpans spans) {
+                                         littleMesh.Write(spans);
+                                       },
+                                       cpuWrite },
 
     .sceneUniforms = BufferViewStruct<SceneUniforms>(device, cpuWrite),
 
@@ -134,18 +165,17 @@ DrawSmallSpheres(AutoDraw& draw, Tick& tick, Scene& scene)
       Random(SMALL_SPHERE_BRIGHTNESS_MIN, SMALL_SPHERE_BRIGHTNESS_MAX);
   }
 
+  BufferRefs vertexInputs = scene.smallSphereBuffers.vertices.Refs();
+  vertexInputs.push_back(scene.smallSphereUniforms.Ref());
+
   draw.DrawIndexed({
     .label = "DrawSmallSpheres",
     .renderPipelineState = scene.smallSpherePipeline,
     .primitiveType = mtlpp::PrimitiveType::Triangle,
-    .indexCount = scene.smallSphereBuffers.indexCount,
-    .indexType = mtlpp::IndexType::UInt32,
-    .indexBuffer = scene.smallSphereBuffers.cells.buffer,
-    .vertexInputs = std::vector({
-      scene.smallSphereBuffers.positions.Ref(),
-      scene.smallSphereBuffers.normals.Ref(),
-      scene.smallSphereUniforms.Ref(),
-    }),
+    .indexCount = scene.smallSphereBuffers.indices.indexCount,
+    .indexType = scene.smallSphereBuffers.indices.indexType,
+    .indexBuffer = scene.smallSphereBuffers.indices.buffer,
+    .vertexInputs = vertexInputs,
     .fragmentInputs = std::vector({ scene.smallSphereUniforms.Ref() }),
 
     // Optional values.
@@ -166,19 +196,18 @@ DrawBigSphere(AutoDraw& draw, Tick& tick, Scene& scene)
   scene.bigSphereUniforms.data->matrices =
     GetModelMatrices(model, scene.view, scene.projection);
 
+  BufferRefs vertexInputs = scene.bigSphereBuffers.vertices.Refs();
+  vertexInputs.push_back(scene.sceneUniforms.Ref());
+  vertexInputs.push_back(scene.bigSphereUniforms.Ref());
+
   draw.DrawIndexed({
     .label = "DrawBigSphere",
     .renderPipelineState = scene.bigSpherePipeline,
     .primitiveType = mtlpp::PrimitiveType::Triangle,
-    .indexCount = scene.bigSphereBuffers.indexCount,
-    .indexType = mtlpp::IndexType::UInt32,
-    .indexBuffer = scene.bigSphereBuffers.cells.buffer,
-    .vertexInputs = std::vector({
-      scene.bigSphereBuffers.positions.Ref(),
-      scene.bigSphereBuffers.normals.Ref(),
-      scene.sceneUniforms.Ref(),
-      scene.bigSphereUniforms.Ref(),
-    }),
+    .indexCount = scene.bigSphereBuffers.indices.indexCount,
+    .indexType = scene.bigSphereBuffers.indices.indexType,
+    .indexBuffer = scene.bigSphereBuffers.indices.buffer,
+    .vertexInputs = vertexInputs,
     .fragmentInputs =
       std::vector({ scene.sceneUniforms.Ref(), scene.bigSphereUniforms.Ref() }),
 
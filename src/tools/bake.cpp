@@ -0,0 +1,125 @@
+#include <charconv> // std::from_chars
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "viz/assert.h"
+#include "viz/bunny-model.h"
+#include "viz/geo/bake.h"
+#include "viz/geo/icosphere.h"
+#include "viz/geo/import.h"
+
+/**
+ * Bakes a mesh into a mesh file, see viz/geo/bake.h. The examples' meshes are
+ * baked by `make bake`, and the examples that need them depend on them.
+ *
+ * make ./bin/bake && ./bin/bake bunny ./bin/bunny.vizmesh
+ */
+
+using namespace viz;
+using Clock = std::chrono::steady_clock;
+
+static const char* USAGE = R"(Usage: bake [options] <input> <output>
+
+The input is a .obj or .ply file, "bunny" for the model in viz/bunny-model.h,
+or "icosphere-N" for an icosphere with N subdivisions.
+
+Options:
+  --no-weld                  Keep duplicate vertices and degenerate cells.
+  --normals                  Recompute the normals, even if there are some.
+  --no-optimize              Keep the order of the cells and vertices.
+  --quantize=bounds16|half   Write the attributes in the quantized formats.
+)";
+
+static Mesh
+loadInput(std::string_view input)
+{
+  if (input == "bunny") {
+    return loadBunnyMesh();
+  }
+  std::string_view icosphere = "icosphere-";
+  if (input.starts_with(icosphere)) {
+    auto digits = input.substr(icosphere.size());
+    size_t subdivisions = 0;
+    auto [next, error] = std::from_chars(
+      digits.data(), digits.data() + digits.size(), subdivisions);
+    if (error != std::errc() || next != digits.data() + digits.size()) {
+      throw ErrorMessage("Unknown input " + std::string(input));
+    }
+    return generateIcosphere({ .subdivisions = subdivisions });
+  }
+  return importMesh(std::filesystem::path{ input });
+}
+
+static void
+bake(int argc, char** argv)
+{
+  BakeOptions options{};
+  std::vector<std::string_view> paths{};
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--no-weld") {
+      options.weld = std::nullopt;
+    } else if (arg == "--normals") {
+      options.computeNormals = true;
+    } else if (arg == "--no-optimize") {
+      options.optimize = false;
+    } else if (arg == "--quantize=bounds16") {
+      options.quantize = PositionQuantization::Bounds16;
+    } else if (arg == "--quantize=half") {
+      options.quantize = PositionQuantization::Half;
+    } else if (arg.starts_with("--")) {
+      throw ErrorMessage("Unknown option " + std::string(arg));
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.size() != 2) {
+    throw ErrorMessage("Expected an input and an output.");
+  }
+
+  auto start = Clock::now();
+  Mesh mesh = loadInput(paths[0]);
+  double loadSeconds =
+    std::chrono::duration<double>(Clock::now() - start).count();
+
+  start = Clock::now();
+  BakeReport report = bakeMesh(std::move(mesh), paths[1], options);
+  double bakeSeconds =
+    std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::printf("Baked %.*s into %.*s in %.1fms, after %.1fms loading\n",
+              static_cast<int>(paths[0].size()),
+              paths[0].data(),
+              static_cast<int>(paths[1].size()),
+              paths[1].data(),
+              bakeSeconds * 1e3,
+              loadSeconds * 1e3);
+  std::printf("  vertices %zu -> %zu, cells %zu -> %zu\n",
+              report.input.vertexCount,
+              report.output.vertexCount,
+              report.input.cellCount,
+              report.output.cellCount);
+  std::printf("  ACMR %.3f -> %.3f\n",
+              report.vertexCache.before.acmr,
+              report.vertexCache.after.acmr);
+  if (report.quantizationError) {
+    std::printf("  max position error %g, max normal error %g radians\n",
+                report.quantizationError->maxPositionError,
+                report.quantizationError->maxNormalError);
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  try {
+    bake(argc, argv);
+    return 0;
+  } catch (std::exception const& error) {
+    std::fprintf(stderr, "%s\n\n%s", error.what(), USAGE);
+    return 1;
+  }
+}
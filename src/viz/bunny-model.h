@@ -1,8 +1,13 @@
 // Source: https://github.com/mikolalysenko/bunny
+#pragma once
+#include "viz/geo/mesh.h"
+#include <cstdint>
 #include <span>
-#include <vector>
 
-float BUNNY_POSITIONS[] = {
+// These are inline so that every translation unit that includes this shares a
+// single copy. Prefer baking the model into a mesh file, see
+// viz/geo/mesh-file.h, so it doesn't need to be compiled in at all.
+inline const float BUNNY_POSITIONS[] = {
   1.301895,  0.122622,  2.550061,  1.045326,  0.139058,  2.835156,  0.569251,
   0.155925,  2.805125,  0.251886,  0.144145,  2.82928,   0.063033,  0.131726,
   3.01408,   -0.277753, 0.135892,  3.10716,   -0.441048, 0.277064,  2.594331,
@@ -793,7 +798,7 @@ float BUNNY_POSITIONS[] = {
   0.05617,   0.69473,   -1.43369,  0.058226,  1.977865,  -2.505459, 1.492266,
   1.19295
 };
-int BUNNY_CELLS[] = {
+inline const uint32_t BUNNY_CELLS[] = {
   2,    1661, 3,    1676, 7,    6,    712,  1694, 9,    3,    1674, 1662, 11,
   1672, 0,    1705, 0,    1,    5,    6,    1674, 4,    5,    1674, 7,    8,
   712,  2,    1662, 10,   1,    10,   1705, 11,   1690, 1672, 1705, 11,   0,
@@ -1643,3 +1648,28 @@ int BUNNY_CELLS[] = {
   16,   1767, 1084, 589,  1765, 1838, 1765, 1781, 1838, 1781, 1737, 1838, 1737,
   982,  1838, 982,  1053, 1838, 1053, 816,  1838, 816,  589,  1838
 };
+
+namespace viz {
+
+/**
+ * Copy the bunny into a Mesh, without normals.
+ */
+inline Mesh
+loadBunnyMesh()
+{
+  std::span<const float> positions = BUNNY_POSITIONS;
+  std::span<const uint32_t> cells = BUNNY_CELLS;
+  Mesh mesh{};
+  mesh.positions.reserve(positions.size() / 3);
+  mesh.cells.reserve(cells.size() / 3);
+  for (size_t i = 0; i < positions.size(); i += 3) {
+    mesh.positions.push_back(
+      Vector3{ positions[i], positions[i + 1], positions[i + 2] });
+  }
+  for (size_t i = 0; i < cells.size(); i += 3) {
+    mesh.cells.push_back({ cells[i], cells[i + 1], cells[i + 2] });
+  }
+  return mesh;
+}
+
+} // namespace viz
@@ -0,0 +1,250 @@
+#include "viz/geo/adjacency.h"
+#include "viz/assert.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <atomic>
+
+namespace viz {
+
+template<typename Fn>
+static void
+forEachIndex(bool parallel, size_t count, size_t grainSize, Fn fn)
+{
+  if (parallel) {
+    ParallelFor(count, grainSize, fn);
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      fn(i);
+    }
+  }
+}
+
+VertexCorners
+buildVertexCorners(std::span<const std::array<uint32_t, 3>> cells,
+                   size_t vertexCount,
+                   bool parallel)
+{
+  VertexCorners result{
+    .offsets = std::vector<uint32_t>(vertexCount + 1, 0),
+    .corners = std::vector<uint32_t>(cells.size() * 3),
+  };
+
+  // The atomics only pay for themselves when there are threads to share them.
+  if (!parallel || GetThreadCount() == 1) {
+    for (auto const& cell : cells) {
+      for (auto index : cell) {
+        ReleaseAssert(index < vertexCount, "A cell index is out of range.");
+        result.offsets[index + 1]++;
+      }
+    }
+    for (size_t i = 0; i < vertexCount; i++) {
+      result.offsets[i + 1] += result.offsets[i];
+    }
+    std::vector<uint32_t> cursors(result.offsets.begin(),
+                                  result.offsets.end() - 1);
+    for (uint32_t corner = 0; corner < result.corners.size(); corner++) {
+      result.corners[cursors[cells[corner / 3][corner % 3]]++] = corner;
+    }
+    return result;
+  }
+
+  std::vector<std::atomic<uint32_t>> counts(vertexCount);
+  std::atomic<bool> outOfRange = false;
+  ParallelFor(cells.size(), 4096, [&](size_t cell) {
+    for (auto index : cells[cell]) {
+      if (index >= vertexCount) {
+        outOfRange = true;
+        return;
+      }
+      counts[index].fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  ReleaseAssert(!outOfRange, "A cell index is out of range.");
+
+  for (size_t i = 0; i < vertexCount; i++) {
+    result.offsets[i + 1] = result.offsets[i] + counts[i];
+    counts[i] = result.offsets[i];
+  }
+
+  // The threads fill in each vertex's corners in any order, so sort them back
+  // into cell order afterwards.
+  ParallelFor(cells.size(), 4096, [&](size_t cell) {
+    for (uint32_t i = 0; i < 3; i++) {
+      uint32_t slot =
+        counts[cells[cell][i]].fetch_add(1, std::memory_order_relaxed);
+      result.corners[slot] = cell * 3 + i;
+    }
+  });
+  ParallelFor(vertexCount, 4096, [&](size_t vertex) {
+    std::sort(result.corners.begin() + result.offsets[vertex],
+              result.corners.begin() + result.offsets[vertex + 1]);
+  });
+
+  return result;
+}
+
+/**
+ * Gather the (neighbor, cell) pairs for every edge of a vertex into the
+ * output, sorted, and return how many there are. The output needs room for two
+ * pairs per corner.
+ */
+static uint32_t
+gatherEdgeCells(std::span<const std::array<uint32_t, 3>> cells,
+                VertexCorners const& vertexCorners,
+                uint32_t vertex,
+                std::pair<uint32_t, uint32_t>* output)
+{
+  uint32_t count = 0;
+  for (auto corner : vertexCorners.Get(vertex)) {
+    uint32_t cell = corner / 3;
+    uint32_t i = corner % 3;
+    for (uint32_t neighbor :
+         { cells[cell][(i + 1) % 3], cells[cell][(i + 2) % 3] }) {
+      if (neighbor != vertex) {
+        output[count++] = { neighbor, cell };
+      }
+    }
+  }
+  // A degenerate cell can list the same edge twice.
+  std::sort(output, output + count);
+  return std::unique(output, output + count) - output;
+}
+
+/**
+ * Calls fn(neighbor, edgeCells) for each neighbor in order, with the pairs of
+ * the cells on the edge to it.
+ */
+template<typename Fn>
+static void
+forEachNeighbor(std::span<const std::pair<uint32_t, uint32_t>> edgeCells,
+                Fn fn)
+{
+  size_t begin = 0;
+  while (begin < edgeCells.size()) {
+    size_t end = begin + 1;
+    while (end < edgeCells.size() &&
+           edgeCells[end].first == edgeCells[begin].first) {
+      end++;
+    }
+    fn(edgeCells[begin].first, edgeCells.subspan(begin, end - begin));
+    begin = end;
+  }
+}
+
+/**
+ * Turn per-vertex counts into offsets, in place, with the total at the end.
+ */
+static void
+prefixSum(std::vector<uint32_t>& counts)
+{
+  uint32_t sum = 0;
+  for (auto& count : counts) {
+    uint32_t next = sum + count;
+    count = sum;
+    sum = next;
+  }
+}
+
+MeshAdjacency::MeshAdjacency(std::span<const std::array<uint32_t, 3>> cells,
+                             size_t vertexCount,
+                             bool parallel)
+  : mVertexCorners(buildVertexCorners(cells, vertexCount, parallel))
+  , mNeighborOffsets(vertexCount + 1, 0)
+  , mEdgeOffsets(vertexCount + 1, 0)
+  , mCellEdges(cells.size(), { NO_EDGE, NO_EDGE, NO_EDGE })
+  , mBoundaryVertices(vertexCount, 0)
+{
+  // Gather every vertex's edges once, into a slot big enough for two pairs
+  // per corner, and then count everything so that each vertex knows where to
+  // write. Every vertex sees all of its own edges, so it can tell if it's on a
+  // boundary without looking at any other vertex.
+  std::vector<std::pair<uint32_t, uint32_t>> gathered(cells.size() * 6);
+  std::vector<uint32_t> gatheredCounts(vertexCount);
+  auto getGathered = [&](uint32_t vertex) {
+    return std::span<const std::pair<uint32_t, uint32_t>>{
+      gathered.data() + 2 * mVertexCorners.offsets[vertex],
+      gatheredCounts[vertex]
+    };
+  };
+
+  std::vector<uint32_t> edgeCellStarts(vertexCount + 1, 0);
+  forEachIndex(parallel, vertexCount, 1024, [&](size_t vertex) {
+    gatheredCounts[vertex] =
+      gatherEdgeCells(cells,
+                      mVertexCorners,
+                      vertex,
+                      gathered.data() + 2 * mVertexCorners.offsets[vertex]);
+    forEachNeighbor(
+      getGathered(vertex), [&](uint32_t neighbor, auto edgeCells) {
+        mNeighborOffsets[vertex]++;
+        mBoundaryVertices[vertex] |= edgeCells.size() == 1;
+        if (neighbor > vertex) {
+          mEdgeOffsets[vertex]++;
+          edgeCellStarts[vertex] += edgeCells.size();
+        }
+      });
+  });
+  prefixSum(mNeighborOffsets);
+  prefixSum(mEdgeOffsets);
+  prefixSum(edgeCellStarts);
+
+  mNeighbors.resize(mNeighborOffsets.back());
+  mEdges.resize(mEdgeOffsets.back());
+  mEdgeCellOffsets.resize(mEdges.size() + 1);
+  mEdgeCells.resize(edgeCellStarts.back());
+  mEdgeCellOffsets.back() = mEdgeCells.size();
+
+  // Each edge is only written by its owner, and so is its slot in each of its
+  // cells.
+  forEachIndex(parallel, vertexCount, 1024, [&](size_t vertex) {
+    uint32_t neighborIndex = mNeighborOffsets[vertex];
+    uint32_t edge = mEdgeOffsets[vertex];
+    uint32_t edgeCell = edgeCellStarts[vertex];
+    forEachNeighbor(
+      getGathered(vertex), [&](uint32_t neighbor, auto edgeCells) {
+        mNeighbors[neighborIndex++] = neighbor;
+        if (neighbor < vertex) {
+          return;
+        }
+        mEdges[edge] = { static_cast<uint32_t>(vertex), neighbor };
+        mEdgeCellOffsets[edge] = edgeCell;
+        for (auto [_, cell] : edgeCells) {
+          mEdgeCells[edgeCell++] = cell;
+          for (uint32_t i = 0; i < 3; i++) {
+            uint32_t a = cells[cell][i];
+            uint32_t b = cells[cell][(i + 1) % 3];
+            if ((a == vertex && b == neighbor) ||
+                (a == neighbor && b == vertex)) {
+              mCellEdges[cell][i] = edge;
+            }
+          }
+        }
+        edge++;
+      });
+  });
+}
+
+MeshAdjacency::MeshAdjacency(Mesh const& mesh, bool parallel)
+  : MeshAdjacency(mesh.cells, mesh.positions.size(), parallel)
+{}
+
+std::optional<uint32_t>
+MeshAdjacency::FindEdge(uint32_t a, uint32_t b) const
+{
+  uint32_t low = std::min(a, b);
+  uint32_t high = std::max(a, b);
+  if (low == high || high >= GetVertexCount()) {
+    return std::nullopt;
+  }
+
+  // The owned edges are the tail of the sorted neighbors.
+  auto [first, count] = GetOwnedEdges(low);
+  auto owned = GetVertexNeighbors(low).last(count);
+  auto found = std::lower_bound(owned.begin(), owned.end(), high);
+  if (found == owned.end() || *found != high) {
+    return std::nullopt;
+  }
+  return first + static_cast<uint32_t>(found - owned.begin());
+}
+
+} // namespace viz
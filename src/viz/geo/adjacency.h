@@ -0,0 +1,203 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * The cell corners around every vertex, as compressed sparse rows. The corners
+ * of vertex i are corners[offsets[i]] up to corners[offsets[i + 1]], where a
+ * corner is cellIndex * 3 plus the vertex's position within the cell. Each
+ * vertex's corners are listed in cell order.
+ */
+struct VertexCorners
+{
+  std::vector<uint32_t> offsets;
+  std::vector<uint32_t> corners;
+
+  std::span<const uint32_t> Get(uint32_t vertex) const
+  {
+    return { corners.data() + offsets[vertex],
+             offsets[vertex + 1] - offsets[vertex] };
+  }
+};
+
+/**
+ * Build the corners from packed cells, with a counting sort.
+ */
+template<typename Integer>
+VertexCorners
+buildVertexCorners(std::span<Integer> cells, size_t vertexCount)
+{
+  VertexCorners result{
+    .offsets = std::vector<uint32_t>(vertexCount + 1, 0),
+    .corners = std::vector<uint32_t>(cells.size()),
+  };
+  for (auto index : cells) {
+    result.offsets[index + 1]++;
+  }
+  for (size_t i = 0; i < vertexCount; i++) {
+    result.offsets[i + 1] += result.offsets[i];
+  }
+  std::vector<uint32_t> cursors(result.offsets.begin(),
+                                result.offsets.end() - 1);
+  for (size_t corner = 0; corner < cells.size(); corner++) {
+    result.corners[cursors[cells[corner]]++] = corner;
+  }
+  return result;
+}
+
+/**
+ * Build the corners of a mesh's cells. The parallel build counts and fills
+ * with atomics, and then sorts each vertex's corners, so the result is the
+ * same either way.
+ */
+VertexCorners
+buildVertexCorners(std::span<const std::array<uint32_t, 3>> cells,
+                   size_t vertexCount,
+                   bool parallel = true);
+
+/**
+ * The edge index for an edge that doesn't exist, such as the collapsed edge of
+ * a degenerate cell.
+ */
+static const uint32_t NO_EDGE = ~0u;
+
+/**
+ * The topology of a mesh, for algorithms that need to walk from vertices to
+ * their neighbors, cells, and edges. Everything is stored as flat compressed
+ * sparse rows, rather than as pointers, so it's compact and cache friendly,
+ * and is built in linear time.
+ *
+ * Every undirected edge is listed once, owned by its lower vertex, so the edges
+ * are sorted by (min, max). Non-manifold meshes are fine, as an edge can have
+ * any number of cells. An edge with a single cell is on a boundary.
+ *
+ * The build is parallel over vertices and cells, and gives the same result on
+ * any number of threads.
+ *
+ * e.g. Walk the one ring of every boundary vertex:
+ *
+ * MeshAdjacency adjacency{ mesh };
+ * for (uint32_t vertex = 0; vertex < adjacency.GetVertexCount(); vertex++) {
+ *   if (adjacency.IsBoundaryVertex(vertex)) {
+ *     for (auto neighbor : adjacency.GetVertexNeighbors(vertex)) {
+ *       ...
+ *     }
+ *   }
+ * }
+ */
+class MeshAdjacency
+{
+public:
+  // Move only
+  MeshAdjacency(MeshAdjacency&& other) = default;
+  MeshAdjacency& operator=(MeshAdjacency&& other) = default;
+
+  /**
+   * Set parallel to false to build on the calling thread, such as when it's
+   * already one of many workers.
+   */
+  MeshAdjacency(std::span<const std::array<uint32_t, 3>> cells,
+                size_t vertexCount,
+                bool parallel = true);
+
+  explicit MeshAdjacency(Mesh const& mesh, bool parallel = true);
+
+  size_t GetVertexCount() const { return mVertexCorners.offsets.size() - 1; }
+  size_t GetCellCount() const { return mCellEdges.size(); }
+  size_t GetEdgeCount() const { return mEdges.size(); }
+
+  /**
+   * The cell corners around every vertex, in cell order.
+   */
+  VertexCorners const& GetVertexCorners() const { return mVertexCorners; }
+
+  /**
+   * The corners of the cells around a vertex. The cell is corner / 3.
+   */
+  std::span<const uint32_t> GetVertexCorners(uint32_t vertex) const
+  {
+    return mVertexCorners.Get(vertex);
+  }
+
+  /**
+   * The one ring of a vertex, which is every vertex that shares an edge with
+   * it, in index order.
+   */
+  std::span<const uint32_t> GetVertexNeighbors(uint32_t vertex) const
+  {
+    return { mNeighbors.data() + mNeighborOffsets[vertex],
+             mNeighborOffsets[vertex + 1] - mNeighborOffsets[vertex] };
+  }
+
+  /**
+   * Every edge as its (min, max) vertices, sorted.
+   */
+  std::span<const std::array<uint32_t, 2>> GetEdges() const { return mEdges; }
+
+  /**
+   * The edges that a vertex owns, which are the edges to its neighbors with a
+   * higher index. These are [first, first + count) of GetEdges().
+   */
+  std::pair<uint32_t, uint32_t> GetOwnedEdges(uint32_t vertex) const
+  {
+    return { mEdgeOffsets[vertex],
+             mEdgeOffsets[vertex + 1] - mEdgeOffsets[vertex] };
+  }
+
+  /**
+   * The index of the edge between two vertices, in either order.
+   */
+  std::optional<uint32_t> FindEdge(uint32_t a, uint32_t b) const;
+
+  /**
+   * The cells on either side of an edge, in cell order.
+   */
+  std::span<const uint32_t> GetEdgeCells(uint32_t edge) const
+  {
+    return { mEdgeCells.data() + mEdgeCellOffsets[edge],
+             mEdgeCellOffsets[edge + 1] - mEdgeCellOffsets[edge] };
+  }
+
+  /**
+   * The edges of a cell, where edge i goes from cell[i] to cell[(i + 1) % 3].
+   * A degenerate cell has NO_EDGE in place of its collapsed edge.
+   */
+  std::array<uint32_t, 3> const& GetCellEdges(uint32_t cell) const
+  {
+    return mCellEdges[cell];
+  }
+
+  bool IsBoundaryEdge(uint32_t edge) const
+  {
+    return mEdgeCellOffsets[edge + 1] - mEdgeCellOffsets[edge] == 1;
+  }
+
+  /**
+   * Whether any of the vertex's edges are on a boundary.
+   */
+  bool IsBoundaryVertex(uint32_t vertex) const
+  {
+    return mBoundaryVertices[vertex] != 0;
+  }
+
+private:
+  VertexCorners mVertexCorners;
+
+  std::vector<uint32_t> mNeighborOffsets;
+  std::vector<uint32_t> mNeighbors;
+
+  std::vector<uint32_t> mEdgeOffsets;
+  std::vector<std::array<uint32_t, 2>> mEdges;
+  std::vector<uint32_t> mEdgeCellOffsets;
+  std::vector<uint32_t> mEdgeCells;
+
+  std::vector<std::array<uint32_t, 3>> mCellEdges;
+  std::vector<uint8_t> mBoundaryVertices;
+};
+
+} // namespace viz
@@ -0,0 +1,49 @@
+#include "viz/geo/bake.h"
+#include "viz/geo/mesh-file.h"
+#include "viz/geo/normals.h"
+#include "viz/geo/vertex-fetch.h"
+
+namespace viz {
+
+BakeReport
+bakeMesh(Mesh mesh,
+         std::filesystem::path const& output,
+         BakeOptions const& options)
+{
+  BakeReport report{
+    .input = { .vertexCount = mesh.positions.size(),
+               .cellCount = mesh.cells.size() },
+  };
+
+  if (options.weld) {
+    weldMesh(mesh, *options.weld);
+  }
+
+  if (options.computeNormals ||
+      mesh.normals.size() != mesh.positions.size()) {
+    computeAngleNormals(mesh);
+  }
+
+  if (options.optimize) {
+    report.vertexCache = optimizeVertexCache(mesh);
+    optimizeVertexFetch(mesh);
+  } else {
+    auto stats = analyzeVertexCache(mesh.cells, mesh.positions.size());
+    report.vertexCache = { .before = stats, .after = stats };
+  }
+
+  report.output = { .vertexCount = mesh.positions.size(),
+                    .cellCount = mesh.cells.size() };
+
+  if (options.quantize) {
+    QuantizedMesh quantized =
+      quantizeMesh(mesh, { .positions = *options.quantize });
+    report.quantizationError = measureQuantizationError(mesh, quantized);
+    writeMeshFile(output, quantized);
+  } else {
+    writeMeshFile(output, mesh);
+  }
+  return report;
+}
+
+} // namespace viz
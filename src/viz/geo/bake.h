@@ -0,0 +1,49 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include "viz/geo/quantize.h"
+#include "viz/geo/vertex-cache.h"
+#include "viz/geo/weld.h"
+#include <filesystem>
+#include <optional>
+
+namespace viz {
+
+struct BakeOptions
+{
+  // Merge duplicate vertices and drop degenerate cells first. Set to
+  // std::nullopt to keep the vertices as they are.
+  std::optional<WeldOptions> weld = WeldOptions{};
+  // Recompute the normals even when the mesh already has them. Meshes without
+  // normals always get them.
+  bool computeNormals = false;
+  // Reorder the cells for the vertex cache, and the vertices for fetching.
+  bool optimize = true;
+  // Write the attributes in the quantized GPU formats, rather than as floats.
+  std::optional<PositionQuantization> quantize = std::nullopt;
+};
+
+struct BakeReport
+{
+  MeshCounts input;
+  MeshCounts output;
+  VertexCacheReport vertexCache;
+  // Only filled in for quantized meshes.
+  std::optional<QuantizationError> quantizationError;
+};
+
+/**
+ * Do all of the work a mesh needs before it can be drawn, once, ahead of time,
+ * and write the result as a mesh file. Loading the file is then just a matter
+ * of mapping it, and uploading the streams, so startup doesn't depend on the
+ * size of the mesh.
+ *
+ * The steps run in order: weldMesh, computeAngleNormals, optimizeVertexCache,
+ * optimizeVertexFetch, which also drops the vertices the weld left unused, and
+ * then quantizeMesh.
+ */
+BakeReport
+bakeMesh(Mesh mesh,
+         std::filesystem::path const& output,
+         BakeOptions const& options = {});
+
+} // namespace viz
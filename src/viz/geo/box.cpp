@@ -1,12 +1,12 @@
 #include "viz/geo/box.h"
+#include "viz/assert.h"
 #include "viz/debug.h"
 #include "viz/math.h"
+#include <span>
 #include <vector>
 
 namespace viz {
 
-using Positions2D = std::vector<viz::Vector2>;
-
 struct PanelConfig
 {
   float wx;
@@ -15,138 +15,100 @@ struct PanelConfig
   float sy;
 };
 
-struct Panel
+/**
+ * The output streams of the box, and how much of them has been written so far.
+ */
+struct BoxWriter
 {
-  Positions2D positions2D;
-  Positions positions;
-  Cells cells;
-  UVs uvs;
-  Normals normals;
-  float vertexCount;
+  MeshSpans output;
+  uint32_t vertexOffset = 0;
+  size_t cellOffset = 0;
 };
 
-std::vector<Positions2D>
-generateGrid(PanelConfig const& config)
+static uint32_t
+getPanelVertexCount(PanelConfig const& config)
 {
-  auto stepY = config.wy / config.sy;
-  auto halfY = config.wy / 2;
-  auto lengthY = config.sy + 1;
-  std::vector<std::vector<viz::Vector2>> grid{};
-
-  for (auto i = 0; i < lengthY; ++i) {
-    auto height = stepY * i - halfY;
-    auto halfX = config.wx / 2;
-    auto stepX = config.wx / config.sx;
-    auto lengthX = config.sx + 1;
-    std::vector<viz::Vector2> row{};
-
-    for (auto j = 0; j < lengthX; j++) {
-      auto width = stepX * j - halfX;
-      row.push_back(viz::Vector2{ width, height });
-    }
-
-    grid.push_back(row);
-  }
-
-  return grid;
+  return (static_cast<uint32_t>(config.sx) + 1) *
+         (static_cast<uint32_t>(config.sy) + 1);
 }
 
-uint32_t
-getCellIndex(PanelConfig const& config, uint32_t x, uint32_t y)
+static size_t
+getPanelCellCount(PanelConfig const& config)
 {
-  return (config.sx + 1) * y + x;
+  return 2 * static_cast<size_t>(config.sx) * static_cast<size_t>(config.sy);
 }
 
-Cells
-generateCells(PanelConfig const& config)
+/**
+ * Write a single panel of the box. The panel is laid out as a grid in 2D, and
+ * then the toPosition function maps each 2D point onto its face of the box.
+ */
+template<typename ToPosition>
+static void
+writePanel(BoxWriter& writer,
+           PanelConfig const& config,
+           Vector3 normal,
+           ToPosition toPosition)
 {
-  Cells cells{};
-  for (auto x = 0; x < config.sx; x++) {
-
-    for (auto y = 0; y < config.sy; y++) {
-
-      auto a = getCellIndex(config, x + 0, y + 0); //   d __ c
-      auto b = getCellIndex(config, x + 1, y + 0); //    |  |
-      auto c = getCellIndex(config, x + 1, y + 1); //    |__|
-      auto d = getCellIndex(config, x + 0, y + 1); //   a    b
-
-      cells.push_back(std::array{ a, b, c });
-      cells.push_back(std::array{ c, d, a });
+  uint32_t columns = static_cast<uint32_t>(config.sx) + 1;
+  uint32_t rows = static_cast<uint32_t>(config.sy) + 1;
+  float stepX = config.wx / config.sx;
+  float stepY = config.wy / config.sy;
+  float halfX = config.wx / 2;
+  float halfY = config.wy / 2;
+
+  for (uint32_t y = 0; y < rows; y++) {
+    float height = stepY * y - halfY;
+    for (uint32_t x = 0; x < columns; x++) {
+      float width = stepX * x - halfX;
+      uint32_t index = writer.vertexOffset + columns * y + x;
+
+      float u = width / config.wx + 0.5;
+      float v = height / config.wy + 0.5;
+
+      writer.output.positions[index] = toPosition(width, height);
+      if (!writer.output.uvs.empty()) {
+        writer.output.uvs[index] = Vector2{ u, v };
+      }
+      if (!writer.output.normals.empty()) {
+        writer.output.normals[index] = normal;
+      }
     }
   }
-  return cells;
-}
 
-Positions2D
-flattenRowsIntoPositions(std::vector<std::vector<viz::Vector2>> const& rows)
-{
-  Positions2D positions{};
+  for (uint32_t x = 0; x < columns - 1; x++) {
+    for (uint32_t y = 0; y < rows - 1; y++) {
+      uint32_t a = writer.vertexOffset + columns * (y + 0) + (x + 0); // d __ c
+      uint32_t b = writer.vertexOffset + columns * (y + 0) + (x + 1); //  |  |
+      uint32_t c = writer.vertexOffset + columns * (y + 1) + (x + 1); //  |__|
+      uint32_t d = writer.vertexOffset + columns * (y + 1) + (x + 0); // a    b
 
-  for (auto i = 0; i < rows.size(); i++) {
-    auto& row = rows[i];
-    for (auto j = 0; j < row.size(); j++) {
-      positions.push_back(row[j]);
+      writer.output.cells[writer.cellOffset++] = { a, b, c };
+      writer.output.cells[writer.cellOffset++] = { c, d, a };
     }
   }
-  return positions;
-}
 
-UVs
-generateUvs(Positions2D& positions, PanelConfig const& config)
-{
-  UVs uvs{};
-  for (auto& position : positions) {
-    float u = position[0] / config.wx + 0.5;
-    float v = position[1] / config.wy + 0.5;
-    uvs.push_back({ u, v });
-  }
-  return uvs;
+  writer.vertexOffset += columns * rows;
 }
 
-Panel
-generatePanel(Mesh& mesh, PanelConfig const&& config)
+MeshCounts
+countBox(viz::Vector3 segments)
 {
-  auto rows = generateGrid(config);
-  auto positions2D = flattenRowsIntoPositions(rows);
-
-  return Panel{
-    .positions2D = positions2D,
-    .positions = Positions{},
-    .cells = generateCells(config),
-    .uvs = generateUvs(positions2D, config),
-    .normals = Normals{},
-    .vertexCount = (config.sx + 1) * (config.sy + 1),
+  PanelConfig z{ 0, 0, segments[0], segments[1] };
+  PanelConfig x{ 0, 0, segments[2], segments[1] };
+  PanelConfig y{ 0, 0, segments[0], segments[2] };
+
+  // Every panel is used twice, once for each side of the box.
+  return MeshCounts{
+    .vertexCount = 2 * (getPanelVertexCount(z) + getPanelVertexCount(x) +
+                        getPanelVertexCount(y)),
+    .cellCount =
+      2 * (getPanelCellCount(z) + getPanelCellCount(x) + getPanelCellCount(y)),
   };
 }
 
-template<typename Fn>
-Positions
-map2DTo3D(Panel const& panel, Fn fn)
-{
-  Positions positions3D;
-  for (auto p2D : panel.positions2D) {
-    Vector3 v = fn(p2D);
-    positions3D.push_back(v);
-  }
-  return positions3D;
-}
-
-Normals
-makeNormals(viz::Vector3&& normal, size_t count)
-{
-  Normals normals{};
-
-  for (auto i = 0; i < count; i++) {
-    normals.push_back(normal);
-  }
-
-  return normals;
-}
-
-std::vector<Panel>
-generateBoxPanels(Mesh& mesh, viz::Vector3& size, viz::Vector3& segments)
+void
+generateBox(MeshSpans output, viz::Vector3 size, viz::Vector3 segments)
 {
-
   //       yp  zm
   //        | /
   //        |/
@@ -155,81 +117,36 @@ generateBoxPanels(Mesh& mesh, viz::Vector3& size, viz::Vector3& segments)
   //      / |
   //    zp  ym
 
-  auto zp = generatePanel(
-    mesh, PanelConfig{ size[0], size[1], segments[0], segments[1] });
-  auto xp = generatePanel(
-    mesh, PanelConfig{ size[2], size[1], segments[2], segments[1] });
-  auto yp = generatePanel(
-    mesh, PanelConfig{ size[0], size[2], segments[0], segments[2] });
-
-  auto zm = Panel{ zp };
-  auto xm = Panel{ xp };
-  auto ym = Panel{ yp };
-
-  // clang-format off
-	zp.positions = map2DTo3D(zp, [&](Vector2& p){ return viz::Vector3 {       p[0],       p[1],  size[2]/2 }; });
-	zm.positions = map2DTo3D(zm, [&](Vector2& p){ return viz::Vector3 {       p[0],      -p[1], -size[2]/2 }; });
-	xp.positions = map2DTo3D(xp, [&](Vector2& p){ return viz::Vector3 {  size[0]/2,      -p[1],       p[0] }; });
-	xm.positions = map2DTo3D(xm, [&](Vector2& p){ return viz::Vector3 { -size[0]/2,       p[1],       p[0] }; });
-	yp.positions = map2DTo3D(yp, [&](Vector2& p){ return viz::Vector3 {       p[0],  size[1]/2,      -p[1] }; });
-	ym.positions = map2DTo3D(ym, [&](Vector2& p){ return viz::Vector3 {       p[0], -size[1]/2,       p[1] }; });
-  // clang-format on
-
-  zp.normals = makeNormals({ 0, 0, 1 }, zp.positions.size());
-  zm.normals = makeNormals({ 0, 0, -1 }, zm.positions.size());
-  xp.normals = makeNormals({ 1, 0, 0 }, xp.positions.size());
-  xm.normals = makeNormals({ -1, 0, 0 }, xm.positions.size());
-  yp.normals = makeNormals({ 0, 1, 0 }, yp.positions.size());
-  ym.normals = makeNormals({ 0, -1, 0 }, ym.positions.size());
+  auto counts = countBox(segments);
+  DebugAssert(output.positions.size() >= counts.vertexCount &&
+                output.cells.size() >= counts.cellCount,
+              "The box output spans are too small.");
 
-  return { zp, zm, xp, xm, yp, ym };
-}
+  PanelConfig z{ size[0], size[1], segments[0], segments[1] };
+  PanelConfig x{ size[2], size[1], segments[2], segments[1] };
+  PanelConfig y{ size[0], size[2], segments[0], segments[2] };
 
-void
-offsetCellIndices(std::vector<Panel>& panels)
-{
-  // e.g.
-  // from: [[[0,1,2],[2,3,0]],[[0,1,2],[2,3,0]]]
-  // to:   [[[0,1,2],[2,3,0]],[[6,7,8],[8,9,6]]]
+  BoxWriter writer{ .output = output };
 
-  uint32_t offset = 0;
+  float hx = size[0] / 2;
+  float hy = size[1] / 2;
+  float hz = size[2] / 2;
 
-  for (auto& panel : panels) {
-    for (auto& cell : panel.cells) {
-      cell[0] += offset;
-      cell[1] += offset;
-      cell[2] += offset;
-    }
-    offset += panel.vertexCount;
-  }
+  // clang-format off
+  writePanel(writer, z, { 0, 0, 1 },  [&](float u, float v) { return Vector3{  u,   v,  hz }; });
+  writePanel(writer, z, { 0, 0, -1 }, [&](float u, float v) { return Vector3{  u,  -v, -hz }; });
+  writePanel(writer, x, { 1, 0, 0 },  [&](float u, float v) { return Vector3{  hx, -v,  u  }; });
+  writePanel(writer, x, { -1, 0, 0 }, [&](float u, float v) { return Vector3{ -hx,  v,  u  }; });
+  writePanel(writer, y, { 0, 1, 0 },  [&](float u, float v) { return Vector3{  u,   hy, -v }; });
+  writePanel(writer, y, { 0, -1, 0 }, [&](float u, float v) { return Vector3{  u,  -hy,  v }; });
+  // clang-format on
 }
 
 Mesh
 generateBox(viz::Vector3 size, viz::Vector3 segments = Vector3{ 1, 1, 1 })
 {
   Mesh mesh{};
-
-  auto panels = generateBoxPanels(mesh, size, segments);
-
-  // Mutate the panels to correctly offset the cell indexes.
-  offsetCellIndices(panels);
-
-  // Combine the panels together.
-  for (auto const& panel : panels) {
-    for (auto const& position : panel.positions) {
-      mesh.positions.push_back(position);
-    }
-    for (auto const& uv : panel.uvs) {
-      mesh.uvs.push_back(uv);
-    }
-    for (auto const& normal : panel.normals) {
-      mesh.normals.push_back(normal);
-    }
-    for (auto const& cell : panel.cells) {
-      mesh.cells.push_back(cell);
-    }
-  }
-
+  generateBox(allocateMeshSpans(mesh, countBox(segments)), size, segments);
   return mesh;
 }
 
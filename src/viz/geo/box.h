@@ -1,3 +1,4 @@
+#pragma once
 #include "viz/geo/mesh.h"
 #include "viz/math.h"
 
@@ -6,4 +7,17 @@ namespace viz {
 Mesh
 generateBox(viz::Vector3 size, viz::Vector3 segments);
 
+/**
+ * The exact stream sizes of a box with the given segments.
+ */
+MeshCounts
+countBox(viz::Vector3 segments);
+
+/**
+ * Write a box directly into the output spans, which must be at least as large
+ * as countBox(segments). The uvs and normals are optional.
+ */
+void
+generateBox(MeshSpans output, viz::Vector3 size, viz::Vector3 segments);
+
 } // namespace viz
@@ -0,0 +1,880 @@
+#include "viz/geo/bvh.h"
+#include "viz/assert.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace viz {
+
+// Past this depth the build falls back to median splits, which keeps the tree,
+// and so the traversal stack, bounded on pathological inputs.
+static const uint32_t MAX_SAH_DEPTH = 48;
+// Each level of 4 wide nodes can grow the traversal stack by at most 3.
+static const size_t TRAVERSAL_STACK_SIZE = 256;
+static const uint32_t MAX_BIN_COUNT = 64;
+// Subtrees smaller than this are built on a single thread.
+static const uint32_t MIN_TASK_SIZE = 1024;
+
+static const float INF = std::numeric_limits<float>::infinity();
+
+/**
+ * A small wrapper over 4 floats, so that the traversal can be written once for
+ * SSE, NEON, and plain scalar code.
+ */
+#if defined(__SSE2__)
+struct Float4
+{
+  __m128 v;
+};
+
+static inline Float4
+load4(std::array<float, 4> const& values)
+{
+  return { _mm_loadu_ps(values.data()) };
+}
+static inline Float4
+splat4(float value)
+{
+  return { _mm_set1_ps(value) };
+}
+static inline Float4
+operator-(Float4 a, Float4 b)
+{
+  return { _mm_sub_ps(a.v, b.v) };
+}
+static inline Float4
+operator+(Float4 a, Float4 b)
+{
+  return { _mm_add_ps(a.v, b.v) };
+}
+static inline Float4
+operator*(Float4 a, Float4 b)
+{
+  return { _mm_mul_ps(a.v, b.v) };
+}
+static inline Float4
+min4(Float4 a, Float4 b)
+{
+  return { _mm_min_ps(a.v, b.v) };
+}
+static inline Float4
+max4(Float4 a, Float4 b)
+{
+  return { _mm_max_ps(a.v, b.v) };
+}
+// A bit per lane, set where a <= b.
+static inline uint32_t
+lessEqualMask4(Float4 a, Float4 b)
+{
+  return _mm_movemask_ps(_mm_cmple_ps(a.v, b.v));
+}
+static inline void
+store4(Float4 a, std::array<float, 4>& values)
+{
+  _mm_storeu_ps(values.data(), a.v);
+}
+#elif defined(__ARM_NEON)
+struct Float4
+{
+  float32x4_t v;
+};
+
+static inline Float4
+load4(std::array<float, 4> const& values)
+{
+  return { vld1q_f32(values.data()) };
+}
+static inline Float4
+splat4(float value)
+{
+  return { vdupq_n_f32(value) };
+}
+static inline Float4
+operator-(Float4 a, Float4 b)
+{
+  return { vsubq_f32(a.v, b.v) };
+}
+static inline Float4
+operator+(Float4 a, Float4 b)
+{
+  return { vaddq_f32(a.v, b.v) };
+}
+static inline Float4
+operator*(Float4 a, Float4 b)
+{
+  return { vmulq_f32(a.v, b.v) };
+}
+static inline Float4
+min4(Float4 a, Float4 b)
+{
+  return { vminq_f32(a.v, b.v) };
+}
+static inline Float4
+max4(Float4 a, Float4 b)
+{
+  return { vmaxq_f32(a.v, b.v) };
+}
+static inline uint32_t
+lessEqualMask4(Float4 a, Float4 b)
+{
+  uint32x4_t mask = vcleq_f32(a.v, b.v);
+  return (vgetq_lane_u32(mask, 0) & 1) | (vgetq_lane_u32(mask, 1) & 2) |
+         (vgetq_lane_u32(mask, 2) & 4) | (vgetq_lane_u32(mask, 3) & 8);
+}
+static inline void
+store4(Float4 a, std::array<float, 4>& values)
+{
+  vst1q_f32(values.data(), a.v);
+}
+#else
+struct Float4
+{
+  std::array<float, 4> v;
+};
+
+template<typename Op>
+static inline Float4
+map4(Float4 a, Float4 b, Op op)
+{
+  return { { op(a.v[0], b.v[0]),
+             op(a.v[1], b.v[1]),
+             op(a.v[2], b.v[2]),
+             op(a.v[3], b.v[3]) } };
+}
+
+static inline Float4
+load4(std::array<float, 4> const& values)
+{
+  return { values };
+}
+static inline Float4
+splat4(float value)
+{
+  return { { value, value, value, value } };
+}
+static inline Float4
+operator-(Float4 a, Float4 b)
+{
+  return map4(a, b, [](float x, float y) { return x - y; });
+}
+static inline Float4
+operator+(Float4 a, Float4 b)
+{
+  return map4(a, b, [](float x, float y) { return x + y; });
+}
+static inline Float4
+operator*(Float4 a, Float4 b)
+{
+  return map4(a, b, [](float x, float y) { return x * y; });
+}
+static inline Float4
+min4(Float4 a, Float4 b)
+{
+  return map4(a, b, [](float x, float y) { return x < y ? x : y; });
+}
+static inline Float4
+max4(Float4 a, Float4 b)
+{
+  return map4(a, b, [](float x, float y) { return x > y ? x : y; });
+}
+static inline uint32_t
+lessEqualMask4(Float4 a, Float4 b)
+{
+  uint32_t mask = 0;
+  for (uint32_t i = 0; i < 4; i++) {
+    mask |= (a.v[i] <= b.v[i] ? 1 : 0) << i;
+  }
+  return mask;
+}
+static inline void
+store4(Float4 a, std::array<float, 4>& values)
+{
+  values = a.v;
+}
+#endif
+
+struct Bounds
+{
+  std::array<float, 3> min{ INF, INF, INF };
+  std::array<float, 3> max{ -INF, -INF, -INF };
+
+  void Grow(std::array<float, 3> const& point)
+  {
+    for (uint32_t i = 0; i < 3; i++) {
+      min[i] = std::min(min[i], point[i]);
+      max[i] = std::max(max[i], point[i]);
+    }
+  }
+
+  void Grow(Bounds const& other)
+  {
+    for (uint32_t i = 0; i < 3; i++) {
+      min[i] = std::min(min[i], other.min[i]);
+      max[i] = std::max(max[i], other.max[i]);
+    }
+  }
+
+  // Half of the surface area, which is all that the SAH needs.
+  float GetArea() const
+  {
+    if (min[0] > max[0]) {
+      return 0.0f;
+    }
+    float x = max[0] - min[0];
+    float y = max[1] - min[1];
+    float z = max[2] - min[2];
+    return x * y + y * z + z * x;
+  }
+};
+
+/**
+ * A node of the binary tree, before it's collapsed into 4 wide nodes. Leaves
+ * have a count, and point at a range of the primitive order.
+ */
+struct BinaryNode
+{
+  Bounds bounds;
+  uint32_t left = 0;
+  uint32_t right = 0;
+  uint32_t first = 0;
+  uint32_t count = 0;
+};
+
+/**
+ * A subtree whose build was deferred, so that it can run in parallel.
+ */
+struct BuildTask
+{
+  uint32_t node;
+  uint32_t begin;
+  uint32_t end;
+  uint32_t depth;
+};
+
+struct BvhBuilder
+{
+  BvhOptions const& options;
+  std::vector<Bounds> const& bounds;
+  std::vector<std::array<float, 3>> const& centroids;
+  // The primitives, which are partitioned in place as the tree is built.
+  std::vector<uint32_t>& order;
+
+  /**
+   * Find the best binned SAH split of the range, and partition it. This returns
+   * the split point, or nothing if there isn't a useful split.
+   */
+  std::optional<uint32_t> PartitionSah(uint32_t begin,
+                                       uint32_t end,
+                                       Bounds const& centroidBounds)
+  {
+    struct Bin
+    {
+      Bounds bounds;
+      uint32_t count = 0;
+    };
+
+    uint32_t binCount = std::clamp(options.binCount, 2u, MAX_BIN_COUNT);
+    std::array<Bin, MAX_BIN_COUNT> bins;
+    std::array<float, MAX_BIN_COUNT> rightCosts;
+    float bestCost = INF;
+    uint32_t bestAxis = 0;
+    uint32_t bestBin = 0;
+
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      float low = centroidBounds.min[axis];
+      float extent = centroidBounds.max[axis] - low;
+      if (!(extent > 0.0f)) {
+        continue;
+      }
+      float scale = binCount / extent;
+
+      std::fill(bins.begin(), bins.begin() + binCount, Bin{});
+      for (uint32_t i = begin; i < end; i++) {
+        uint32_t primitive = order[i];
+        uint32_t bin = std::min(
+          binCount - 1,
+          static_cast<uint32_t>((centroids[primitive][axis] - low) * scale));
+        bins[bin].bounds.Grow(bounds[primitive]);
+        bins[bin].count++;
+      }
+
+      // Sweep from the right to get the cost of every right hand side, and
+      // then from the left to combine them.
+      Bounds right{};
+      uint32_t rightCount = 0;
+      for (uint32_t bin = binCount - 1; bin > 0; bin--) {
+        right.Grow(bins[bin].bounds);
+        rightCount += bins[bin].count;
+        rightCosts[bin] = right.GetArea() * rightCount;
+      }
+      Bounds left{};
+      uint32_t leftCount = 0;
+      for (uint32_t bin = 1; bin < binCount; bin++) {
+        left.Grow(bins[bin - 1].bounds);
+        leftCount += bins[bin - 1].count;
+        float cost = left.GetArea() * leftCount + rightCosts[bin];
+        if (cost < bestCost) {
+          bestCost = cost;
+          bestAxis = axis;
+          bestBin = bin;
+        }
+      }
+    }
+
+    if (bestCost == INF) {
+      return std::nullopt;
+    }
+
+    float low = centroidBounds.min[bestAxis];
+    float scale = binCount / (centroidBounds.max[bestAxis] - low);
+    auto middle = std::partition(
+      order.begin() + begin, order.begin() + end, [&](uint32_t primitive) {
+        uint32_t bin = std::min(
+          binCount - 1,
+          static_cast<uint32_t>((centroids[primitive][bestAxis] - low) *
+                                scale));
+        return bin < bestBin;
+      });
+    uint32_t split = middle - order.begin();
+    if (split == begin || split == end) {
+      return std::nullopt;
+    }
+    return split;
+  }
+
+  /**
+   * Split the range in half along the longest axis of the centroids.
+   */
+  uint32_t PartitionMedian(uint32_t begin,
+                           uint32_t end,
+                           Bounds const& centroidBounds)
+  {
+    uint32_t axis = 0;
+    for (uint32_t i = 1; i < 3; i++) {
+      if (centroidBounds.max[i] - centroidBounds.min[i] >
+          centroidBounds.max[axis] - centroidBounds.min[axis]) {
+        axis = i;
+      }
+    }
+    uint32_t split = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin,
+                     order.begin() + split,
+                     order.begin() + end,
+                     [&](uint32_t a, uint32_t b) {
+                       return centroids[a][axis] < centroids[b][axis];
+                     });
+    return split;
+  }
+
+  /**
+   * Build the subtree of the range into the nodes, and return its root. When
+   * there are tasks, ranges smaller than the task size are left as placeholder
+   * nodes, to be built later.
+   */
+  uint32_t Build(std::vector<BinaryNode>& nodes,
+                 uint32_t begin,
+                 uint32_t end,
+                 uint32_t depth,
+                 std::vector<BuildTask>* tasks,
+                 uint32_t taskSize)
+  {
+    uint32_t index = nodes.size();
+    nodes.emplace_back();
+
+    if (tasks && end - begin <= taskSize) {
+      tasks->push_back({ index, begin, end, depth });
+      return index;
+    }
+
+    Bounds nodeBounds{};
+    Bounds centroidBounds{};
+    for (uint32_t i = begin; i < end; i++) {
+      nodeBounds.Grow(bounds[order[i]]);
+      centroidBounds.Grow(centroids[order[i]]);
+    }
+    nodes[index].bounds = nodeBounds;
+
+    if (end - begin <= options.maxLeafSize) {
+      nodes[index].first = begin;
+      nodes[index].count = end - begin;
+      return index;
+    }
+
+    std::optional<uint32_t> split{};
+    if (depth < MAX_SAH_DEPTH) {
+      split = PartitionSah(begin, end, centroidBounds);
+    }
+    if (!split) {
+      split = PartitionMedian(begin, end, centroidBounds);
+    }
+
+    uint32_t left = Build(nodes, begin, *split, depth + 1, tasks, taskSize);
+    uint32_t right = Build(nodes, *split, end, depth + 1, tasks, taskSize);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+  }
+};
+
+/**
+ * Collapse the binary subtree into a 4 wide node, by repeatedly opening up the
+ * inner child with the largest surface area.
+ */
+static uint32_t
+collapseNode(std::vector<BinaryNode> const& binary,
+             uint32_t index,
+             std::vector<BvhNode>& nodes)
+{
+  std::array<uint32_t, 4> children{};
+  uint32_t childCount = 0;
+  if (binary[index].count > 0) {
+    // Only the root can be a leaf here.
+    children[childCount++] = index;
+  } else {
+    children[childCount++] = binary[index].left;
+    children[childCount++] = binary[index].right;
+  }
+
+  while (childCount < 4) {
+    int32_t largest = -1;
+    float largestArea = -1.0f;
+    for (uint32_t i = 0; i < childCount; i++) {
+      auto const& child = binary[children[i]];
+      if (child.count == 0 && child.bounds.GetArea() > largestArea) {
+        largest = i;
+        largestArea = child.bounds.GetArea();
+      }
+    }
+    if (largest < 0) {
+      break;
+    }
+    auto const& child = binary[children[largest]];
+    children[largest] = child.left;
+    children[childCount++] = child.right;
+  }
+
+  uint32_t nodeIndex = nodes.size();
+  nodes.emplace_back();
+
+  BvhNode node{};
+  for (uint32_t i = 0; i < 4; i++) {
+    Bounds bounds{};
+    if (i < childCount) {
+      auto const& child = binary[children[i]];
+      bounds = child.bounds;
+      if (child.count > 0) {
+        node.children[i] = child.first;
+        node.counts[i] = child.count;
+      } else {
+        node.children[i] = collapseNode(binary, children[i], nodes);
+        node.counts[i] = 0;
+      }
+    }
+    // Empty slots keep inverted bounds, which no ray or sphere can touch.
+    node.minX[i] = bounds.min[0];
+    node.minY[i] = bounds.min[1];
+    node.minZ[i] = bounds.min[2];
+    node.maxX[i] = bounds.max[0];
+    node.maxY[i] = bounds.max[1];
+    node.maxZ[i] = bounds.max[2];
+  }
+  nodes[nodeIndex] = node;
+  return nodeIndex;
+}
+
+Bvh::Bvh(std::span<const std::array<uint32_t, 3>> cells,
+         std::span<const Vector3> positions,
+         BvhOptions options)
+{
+  ReleaseAssert(options.maxLeafSize > 0, "The BVH leaves must not be empty.");
+  uint32_t cellCount = cells.size();
+  if (cellCount == 0) {
+    return;
+  }
+
+  auto getPoint = [&](uint32_t vertex) {
+    Vector3 position = positions[vertex];
+    return std::array<float, 3>{ position[0], position[1], position[2] };
+  };
+
+  // The indices are checked while the bounds are gathered, but the assert has
+  // to wait until the threads are done, as the callback must not throw.
+  std::vector<Bounds> bounds(cellCount);
+  std::vector<std::array<float, 3>> centroids(cellCount);
+  std::atomic<bool> outOfRange = false;
+  ParallelFor(cellCount, 4096, [&](size_t i) {
+    for (auto vertex : cells[i]) {
+      if (vertex >= positions.size()) {
+        outOfRange = true;
+        return;
+      }
+      bounds[i].Grow(getPoint(vertex));
+    }
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      centroids[i][axis] = 0.5f * (bounds[i].min[axis] + bounds[i].max[axis]);
+    }
+  });
+  ReleaseAssert(!outOfRange, "A cell is out of bounds.");
+
+  std::vector<uint32_t> order(cellCount);
+  for (uint32_t i = 0; i < cellCount; i++) {
+    order[i] = i;
+  }
+  BvhBuilder builder{ options, bounds, centroids, order };
+
+  // Build the top of the tree on this thread until the ranges are small enough
+  // to hand out, and then build those subtrees in parallel.
+  uint32_t taskSize = std::max<uint32_t>(
+    MIN_TASK_SIZE, cellCount / static_cast<uint32_t>(4 * GetThreadCount()));
+  std::vector<BinaryNode> binary{};
+  std::vector<BuildTask> tasks{};
+  builder.Build(binary, 0, cellCount, 0, &tasks, taskSize);
+
+  std::vector<std::vector<BinaryNode>> subtrees(tasks.size());
+  ParallelFor(tasks.size(), 1, [&](size_t i) {
+    auto const& task = tasks[i];
+    builder.Build(
+      subtrees[i], task.begin, task.end, task.depth, nullptr, taskSize);
+  });
+
+  // Stitch the subtrees back in. Each subtree's root replaces its placeholder,
+  // and the rest of its nodes are appended.
+  for (size_t i = 0; i < tasks.size(); i++) {
+    auto& subtree = subtrees[i];
+    uint32_t placeholder = tasks[i].node;
+    uint32_t base = binary.size();
+    auto remap = [&](uint32_t local) {
+      return local == 0 ? placeholder : base + local - 1;
+    };
+    for (auto& node : subtree) {
+      if (node.count == 0) {
+        node.left = remap(node.left);
+        node.right = remap(node.right);
+      }
+    }
+    binary[placeholder] = subtree[0];
+    binary.insert(binary.end(), subtree.begin() + 1, subtree.end());
+  }
+
+  mNodes.reserve(binary.size() / 2 + 1);
+  collapseNode(binary, 0, mNodes);
+
+  // Store the triangles in leaf order, so that a leaf's triangles are next to
+  // each other in memory.
+  mCells = std::move(order);
+  mTriangles.resize(cellCount);
+  ParallelFor(cellCount, 4096, [&](size_t i) {
+    auto const& cell = cells[mCells[i]];
+    auto a = getPoint(cell[0]);
+    auto b = getPoint(cell[1]);
+    auto c = getPoint(cell[2]);
+    auto& triangle = mTriangles[i];
+    for (uint32_t axis = 0; axis < 3; axis++) {
+      triangle.v0[axis] = a[axis];
+      triangle.edge1[axis] = b[axis] - a[axis];
+      triangle.edge2[axis] = c[axis] - a[axis];
+    }
+  });
+}
+
+Bvh::Bvh(Mesh const& mesh, BvhOptions options)
+  : Bvh(mesh.cells, mesh.positions, options)
+{}
+
+static inline std::array<float, 3>
+cross3(std::array<float, 3> const& a, std::array<float, 3> const& b)
+{
+  return { a[1] * b[2] - a[2] * b[1],
+           a[2] * b[0] - a[0] * b[2],
+           a[0] * b[1] - a[1] * b[0] };
+}
+
+static inline float
+dot3(std::array<float, 3> const& a, std::array<float, 3> const& b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static inline std::array<float, 3>
+sub3(std::array<float, 3> const& a, std::array<float, 3> const& b)
+{
+  return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+}
+
+template<bool AnyHit>
+std::optional<RayHit>
+Bvh::Traverse(Ray const& ray) const
+{
+  if (mNodes.empty()) {
+    return std::nullopt;
+  }
+
+  Vector3 rayOrigin = ray.origin;
+  Vector3 rayDirection = ray.direction;
+  std::array<float, 3> origin{ rayOrigin[0], rayOrigin[1], rayOrigin[2] };
+  std::array<float, 3> direction{ rayDirection[0],
+                                  rayDirection[1],
+                                  rayDirection[2] };
+
+  // The slab test works from the inverse direction, and picks the near and far
+  // planes of every box up front from the direction's signs.
+  // Axis aligned rays would get an infinite inverse, and a ray that starts
+  // exactly on a plane would then multiply 0 by infinity, which is NaN, and
+  // the min and max would pass it through or drop it depending on the
+  // platform. A large finite inverse keeps the sign and gives 0 instead.
+  std::array<Float4, 3> inverse{};
+  std::array<Float4, 3> origin4{};
+  std::array<bool, 3> negative{};
+  for (uint32_t axis = 0; axis < 3; axis++) {
+    float inv = std::abs(direction[axis]) > 1e-30f
+                  ? 1.0f / direction[axis]
+                  : std::copysign(1e30f, direction[axis]);
+    inverse[axis] = splat4(inv);
+    origin4[axis] = splat4(origin[axis]);
+    negative[axis] = inv < 0.0f;
+  }
+
+  struct StackEntry
+  {
+    uint32_t index;
+    uint32_t count;
+    float tNear;
+  };
+  std::array<StackEntry, TRAVERSAL_STACK_SIZE> stack;
+  size_t stackSize = 0;
+  stack[stackSize++] = { 0, 0, ray.tMin };
+
+  float tMax = ray.tMax;
+  std::optional<RayHit> hit{};
+
+  while (stackSize > 0) {
+    StackEntry entry = stack[--stackSize];
+    if (entry.tNear > tMax) {
+      continue;
+    }
+
+    if (entry.count > 0) {
+      // Möller-Trumbore, against every triangle in the leaf.
+      for (uint32_t i = entry.index; i < entry.index + entry.count; i++) {
+        auto const& triangle = mTriangles[i];
+        auto p = cross3(direction, triangle.edge2);
+        float determinant = dot3(triangle.edge1, p);
+        if (determinant == 0.0f) {
+          continue;
+        }
+        float inverseDeterminant = 1.0f / determinant;
+        auto s = sub3(origin, triangle.v0);
+        float u = dot3(s, p) * inverseDeterminant;
+        if (u < 0.0f || u > 1.0f) {
+          continue;
+        }
+        auto q = cross3(s, triangle.edge1);
+        float v = dot3(direction, q) * inverseDeterminant;
+        if (v < 0.0f || u + v > 1.0f) {
+          continue;
+        }
+        float t = dot3(triangle.edge2, q) * inverseDeterminant;
+        if (t < ray.tMin || t > tMax) {
+          continue;
+        }
+        hit = RayHit{ .cell = mCells[i], .t = t, .u = u, .v = v };
+        if constexpr (AnyHit) {
+          return hit;
+        }
+        tMax = t;
+      }
+      continue;
+    }
+
+    auto const& node = mNodes[entry.index];
+    Float4 nearX = load4(negative[0] ? node.maxX : node.minX);
+    Float4 nearY = load4(negative[1] ? node.maxY : node.minY);
+    Float4 nearZ = load4(negative[2] ? node.maxZ : node.minZ);
+    Float4 farX = load4(negative[0] ? node.minX : node.maxX);
+    Float4 farY = load4(negative[1] ? node.minY : node.maxY);
+    Float4 farZ = load4(negative[2] ? node.minZ : node.maxZ);
+
+    Float4 tNear =
+      max4(max4((nearX - origin4[0]) * inverse[0],
+                (nearY - origin4[1]) * inverse[1]),
+           max4((nearZ - origin4[2]) * inverse[2], splat4(ray.tMin)));
+    Float4 tFar = min4(min4((farX - origin4[0]) * inverse[0],
+                            (farY - origin4[1]) * inverse[1]),
+                       min4((farZ - origin4[2]) * inverse[2], splat4(tMax)));
+    uint32_t mask = lessEqualMask4(tNear, tFar);
+    if (mask == 0) {
+      continue;
+    }
+
+    std::array<float, 4> distances;
+    store4(tNear, distances);
+
+    // Push the hit children from far to near, so that the nearest is visited
+    // first, and can shrink tMax for the others.
+    std::array<StackEntry, 4> children;
+    uint32_t childCount = 0;
+    for (uint32_t i = 0; i < 4; i++) {
+      if (mask & (1 << i)) {
+        StackEntry child{ node.children[i], node.counts[i], distances[i] };
+        uint32_t j = childCount++;
+        for (; j > 0 && children[j - 1].tNear < child.tNear; j--) {
+          children[j] = children[j - 1];
+        }
+        children[j] = child;
+      }
+    }
+    DebugAssert(stackSize + childCount <= stack.size(),
+                "The BVH traversal stack overflowed.");
+    for (uint32_t i = 0; i < childCount; i++) {
+      stack[stackSize++] = children[i];
+    }
+  }
+
+  return hit;
+}
+
+std::optional<RayHit>
+Bvh::Intersect(Ray const& ray) const
+{
+  return Traverse<false>(ray);
+}
+
+bool
+Bvh::IsOccluded(Ray const& ray) const
+{
+  return Traverse<true>(ray).has_value();
+}
+
+/**
+ * The closest point on the triangle to p, from "Real-Time Collision Detection",
+ * Ericson 2004, section 5.1.5.
+ */
+static std::array<float, 3>
+closestPointOnTriangle(std::array<float, 3> const& p,
+                       std::array<float, 3> const& a,
+                       std::array<float, 3> const& ab,
+                       std::array<float, 3> const& ac)
+{
+  auto along = [&](std::array<float, 3> const& edge, float t) {
+    return std::array<float, 3>{
+      a[0] + edge[0] * t, a[1] + edge[1] * t, a[2] + edge[2] * t
+    };
+  };
+  std::array<float, 3> b{ a[0] + ab[0], a[1] + ab[1], a[2] + ab[2] };
+  std::array<float, 3> c{ a[0] + ac[0], a[1] + ac[1], a[2] + ac[2] };
+
+  auto ap = sub3(p, a);
+  float d1 = dot3(ab, ap);
+  float d2 = dot3(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    return a;
+  }
+
+  auto bp = sub3(p, b);
+  float d3 = dot3(ab, bp);
+  float d4 = dot3(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    return b;
+  }
+
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    return along(ab, d1 / (d1 - d3));
+  }
+
+  auto cp = sub3(p, c);
+  float d5 = dot3(ab, cp);
+  float d6 = dot3(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    return c;
+  }
+
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    return along(ac, d2 / (d2 - d6));
+  }
+
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+    float t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return { b[0] + (c[0] - b[0]) * t,
+             b[1] + (c[1] - b[1]) * t,
+             b[2] + (c[2] - b[2]) * t };
+  }
+
+  float denominator = 1.0f / (va + vb + vc);
+  float v = vb * denominator;
+  float w = vc * denominator;
+  return { a[0] + ab[0] * v + ac[0] * w,
+           a[1] + ab[1] * v + ac[1] * w,
+           a[2] + ab[2] * v + ac[2] * w };
+}
+
+void
+Bvh::QuerySphere(Vector3 center,
+                 float radius,
+                 std::vector<uint32_t>& cells) const
+{
+  if (mNodes.empty()) {
+    return;
+  }
+
+  std::array<float, 3> point{ center[0], center[1], center[2] };
+  std::array<Float4, 3> point4{ splat4(point[0]),
+                                splat4(point[1]),
+                                splat4(point[2]) };
+  Float4 zero = splat4(0.0f);
+  Float4 radiusSquared = splat4(radius * radius);
+
+  std::array<uint32_t, TRAVERSAL_STACK_SIZE> stack;
+  size_t stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while (stackSize > 0) {
+    auto const& node = mNodes[stack[--stackSize]];
+
+    // The distance from the center to the closest point of each box.
+    Float4 dx = max4(max4(load4(node.minX) - point4[0],
+                          point4[0] - load4(node.maxX)),
+                     zero);
+    Float4 dy = max4(max4(load4(node.minY) - point4[1],
+                          point4[1] - load4(node.maxY)),
+                     zero);
+    Float4 dz = max4(max4(load4(node.minZ) - point4[2],
+                          point4[2] - load4(node.maxZ)),
+                     zero);
+    uint32_t mask =
+      lessEqualMask4(dx * dx + dy * dy + dz * dz, radiusSquared);
+
+    for (uint32_t i = 0; i < 4; i++) {
+      if (!(mask & (1 << i))) {
+        continue;
+      }
+      if (node.counts[i] == 0) {
+        DebugAssert(stackSize < stack.size(),
+                    "The BVH traversal stack overflowed.");
+        stack[stackSize++] = node.children[i];
+        continue;
+      }
+      uint32_t first = node.children[i];
+      for (uint32_t j = first; j < first + node.counts[i]; j++) {
+        auto const& triangle = mTriangles[j];
+        auto closest = closestPointOnTriangle(
+          point, triangle.v0, triangle.edge1, triangle.edge2);
+        auto offset = sub3(closest, point);
+        if (dot3(offset, offset) <= radius * radius) {
+          cells.push_back(mCells[j]);
+        }
+      }
+    }
+  }
+}
+
+} // namespace viz
@@ -0,0 +1,115 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+struct Ray
+{
+  Vector3 origin;
+  // This doesn't need to be normalized. Hit distances are in units of it.
+  Vector3 direction;
+  float tMin = 0.0f;
+  float tMax = std::numeric_limits<float>::infinity();
+};
+
+struct RayHit
+{
+  // The index into the mesh's cells.
+  uint32_t cell;
+  float t;
+  // The barycentric coordinates of the hit, relative to the cell's second and
+  // third vertices.
+  float u;
+  float v;
+};
+
+/**
+ * A 4 wide BVH node. The child bounds are stored as a structure of arrays, so
+ * that all 4 can be tested at once with SIMD.
+ */
+struct alignas(64) BvhNode
+{
+  std::array<float, 4> minX, minY, minZ;
+  std::array<float, 4> maxX, maxY, maxZ;
+  // An inner node index when the count is 0, and otherwise the first of count
+  // triangles in the leaf.
+  std::array<uint32_t, 4> children;
+  std::array<uint32_t, 4> counts;
+};
+
+struct BvhOptions
+{
+  // Stop splitting once a node has this many cells or fewer.
+  uint32_t maxLeafSize = 4;
+  // The number of SAH bins per axis, up to 64.
+  uint32_t binCount = 16;
+};
+
+/**
+ * A bounding volume hierarchy over a mesh's cells, for ray and proximity
+ * queries on the CPU.
+ *
+ * It's built as a binary tree with binned SAH splits, from "On fast
+ * Construction of SAH-based Bounding Volume Hierarchies", Wald 2007, where
+ * the subtrees below the first few levels are built in parallel. The binary
+ * tree is then collapsed into 4 wide nodes in one flat array, with the
+ * triangles stored in leaf order next to them.
+ *
+ * The BVH keeps a copy of the triangles, so the mesh doesn't need to outlive
+ * it. The queries are const, and safe to run from many threads at once.
+ */
+class Bvh
+{
+public:
+  Bvh(std::span<const std::array<uint32_t, 3>> cells,
+      std::span<const Vector3> positions,
+      BvhOptions options = {});
+
+  explicit Bvh(Mesh const& mesh, BvhOptions options = {});
+
+  /**
+   * The closest hit along the ray, within [tMin, tMax].
+   */
+  std::optional<RayHit> Intersect(Ray const& ray) const;
+
+  /**
+   * Whether anything is hit along the ray. This stops at the first hit, so it's
+   * cheaper than Intersect for shadow and occlusion rays.
+   */
+  bool IsOccluded(Ray const& ray) const;
+
+  /**
+   * Append the index of every cell that touches the sphere.
+   */
+  void QuerySphere(Vector3 center,
+                   float radius,
+                   std::vector<uint32_t>& cells) const;
+
+  size_t GetNodeCount() const { return mNodes.size(); }
+
+private:
+  /**
+   * A triangle in the form that the intersection test wants.
+   */
+  struct Triangle
+  {
+    std::array<float, 3> v0;
+    std::array<float, 3> edge1;
+    std::array<float, 3> edge2;
+  };
+
+  template<bool AnyHit>
+  std::optional<RayHit> Traverse(Ray const& ray) const;
+
+  std::vector<BvhNode> mNodes;
+  std::vector<Triangle> mTriangles;
+  // The original cell index of each triangle.
+  std::vector<uint32_t> mCells;
+};
+
+} // namespace viz
@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <utility> // std::pair
+#include <vector>
+
+namespace viz {
+
+/**
+ * An open-addressing hash table that maps an undirected edge, given as a pair
+ * of vertex indices, to a uint32_t value. The edge (a, b) and (b, a) are the
+ * same key, as the key is built from the (min, max) index pair.
+ *
+ * The table never grows, so it must be sized up front with the maximum number
+ * of edges it will hold. It is kept at a load factor of at most 0.5 so that the
+ * linear probing stays short.
+ */
+class EdgeMap
+{
+public:
+  explicit EdgeMap(size_t maxEdges)
+  {
+    size_t capacity = 16;
+    while (capacity < maxEdges * 2) {
+      capacity *= 2;
+    }
+    mKeys.resize(capacity, EMPTY_KEY);
+    mValues.resize(capacity, 0);
+    mMask = capacity - 1;
+  }
+
+  /**
+   * Look up the edge, and insert the value if it's not present. The returned
+   * pair contains the stored value, and whether or not it was inserted.
+   */
+  std::pair<uint32_t, bool> Insert(uint32_t a, uint32_t b, uint32_t value)
+  {
+    uint64_t key = MakeKey(a, b);
+    for (size_t slot = Hash(key) & mMask;; slot = (slot + 1) & mMask) {
+      if (mKeys[slot] == key) {
+        return { mValues[slot], false };
+      }
+      if (mKeys[slot] == EMPTY_KEY) {
+        mKeys[slot] = key;
+        mValues[slot] = value;
+        mSize++;
+        return { value, true };
+      }
+    }
+  }
+
+  std::optional<uint32_t> Find(uint32_t a, uint32_t b) const
+  {
+    uint64_t key = MakeKey(a, b);
+    for (size_t slot = Hash(key) & mMask;; slot = (slot + 1) & mMask) {
+      if (mKeys[slot] == key) {
+        return mValues[slot];
+      }
+      if (mKeys[slot] == EMPTY_KEY) {
+        return std::nullopt;
+      }
+    }
+  }
+
+  /**
+   * Visit every stored edge. The order is the table order, and not the
+   * insertion order. The function signature is:
+   *
+   * (uint32_t min, uint32_t max, uint32_t value) -> void
+   */
+  template<typename Fn>
+  void ForEach(Fn fn) const
+  {
+    for (size_t slot = 0; slot < mKeys.size(); slot++) {
+      uint64_t key = mKeys[slot];
+      if (key != EMPTY_KEY) {
+        fn(static_cast<uint32_t>(key >> 32),
+           static_cast<uint32_t>(key),
+           mValues[slot]);
+      }
+    }
+  }
+
+  size_t Size() const { return mSize; }
+
+private:
+  static constexpr uint64_t EMPTY_KEY = ~uint64_t(0);
+
+  static uint64_t MakeKey(uint32_t a, uint32_t b)
+  {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+  }
+
+  // The finalizer from splitmix64, which spreads the bits of the two indices
+  // across the whole key.
+  static uint64_t Hash(uint64_t key)
+  {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111eb;
+    key ^= key >> 31;
+    return key;
+  }
+
+  std::vector<uint64_t> mKeys;
+  std::vector<uint32_t> mValues;
+  size_t mMask = 0;
+  size_t mSize = 0;
+};
+
+} // namespace viz
@@ -1,55 +1,16 @@
 #include "viz/geo/icosphere.h"
+#include "viz/assert.h"
+#include "viz/geo/subdivide.h"
 #include "viz/math.h"
-#include <map>
+#include "viz/parallel.h"
 #include <vector>
 
 namespace viz {
 
-// This function subdivides a mesh, but does not smooth or do anything to the
-// newly created geometry.
-void
-subdivide(Mesh& mesh)
-{
-  Positions midpoints = {};
-  auto oldCells = mesh.cells;
-  mesh.cells = {};
-
-  using PositionIndex = uint32_t;
-  std::map<Vector3, PositionIndex> vectorToIndex{};
-
-  auto getMidpointIndex = [&](Vector3& a, Vector3& b) {
-    auto midpoint = a.lerp(b, 0.5f);
-
-    // De-duplicate the midpoints.
-    auto result = vectorToIndex.find(midpoint);
-    if (result == vectorToIndex.end()) {
-      PositionIndex index = mesh.positions.size();
-      mesh.positions.push_back(midpoint);
-      vectorToIndex.insert({ midpoint, index });
-      return index;
-    } else {
-      return result->second;
-    }
-  };
-
-  for (auto const& cell : oldCells) {
-    auto v0 = mesh.positions[cell[0]];
-    auto v1 = mesh.positions[cell[1]];
-    auto v2 = mesh.positions[cell[2]];
-
-    auto mid0 = getMidpointIndex(v0, v1);
-    auto mid1 = getMidpointIndex(v1, v2);
-    auto mid2 = getMidpointIndex(v2, v0);
-
-    mesh.cells.push_back({ cell[0], mid0, mid2 });
-    mesh.cells.push_back({ cell[1], mid1, mid0 });
-    mesh.cells.push_back({ cell[2], mid2, mid1 });
-    mesh.cells.push_back({ mid0, mid1, mid2 });
-  }
-}
-
-Mesh
-generateIcosphere(IcosphereInitializer initializer)
+// The 12 vertices and 20 faces of an icosahedron. The vertices are not yet
+// projected onto the sphere.
+static Mesh
+generateIcosahedron()
 {
   Positions positions{};
   Cells cells{};
@@ -99,6 +60,13 @@ generateIcosphere(IcosphereInitializer initializer)
   Mesh mesh{};
   mesh.cells = cells;
   mesh.positions = positions;
+  return mesh;
+}
+
+Mesh
+generateIcosphere(IcosphereInitializer initializer)
+{
+  Mesh mesh = generateIcosahedron();
 
   // Subdividing iteratively will smooth out the sphere.
   for (size_t i = 0; i < initializer.subdivisions; i++) {
@@ -124,4 +92,160 @@ generateIcosphere(IcosphereInitializer initializer)
   return mesh;
 }
 
+MeshCounts
+countIcosphere(IcosphereInitializer initializer)
+{
+  size_t n = size_t(1) << initializer.subdivisions;
+  return MeshCounts{
+    .vertexCount = 10 * n * n + 2,
+    .cellCount = 20 * n * n,
+  };
+}
+
+void
+generateIcosphereLattice(MeshSpans output, IcosphereInitializer initializer)
+{
+  Mesh base = generateIcosahedron();
+  const uint32_t n = 1u << initializer.subdivisions;
+  const uint32_t cornerCount = base.positions.size();
+  const uint32_t faceCount = base.cells.size();
+
+  // Collect the unique edges of the icosahedron, in the order that the faces
+  // first visit them. Each face remembers which edge is on each of its sides.
+  std::vector<std::array<uint32_t, 2>> edges{};
+  std::vector<std::array<uint32_t, 3>> faceEdges(faceCount);
+  for (uint32_t f = 0; f < faceCount; f++) {
+    for (uint32_t side = 0; side < 3; side++) {
+      uint32_t a = base.cells[f][side];
+      uint32_t b = base.cells[f][(side + 1) % 3];
+      std::array<uint32_t, 2> edge{ std::min(a, b), std::max(a, b) };
+      auto found = std::find(edges.begin(), edges.end(), edge);
+      faceEdges[f][side] = found - edges.begin();
+      if (found == edges.end()) {
+        edges.push_back(edge);
+      }
+    }
+  }
+
+  const uint32_t verticesPerEdge = n - 1;
+  const uint32_t verticesPerFace = (n - 1) * (n - 2) / 2;
+  const uint32_t edgeStart = cornerCount;
+  const uint32_t faceStart = edgeStart + edges.size() * verticesPerEdge;
+  const uint32_t vertexCount = faceStart + faceCount * verticesPerFace;
+
+  DebugAssert(output.positions.size() >= vertexCount &&
+                output.cells.size() >= size_t(faceCount) * n * n,
+              "The icosphere output spans are too small.");
+  bool hasNormals = !output.normals.empty();
+
+  // Every vertex is written exactly once, so this is safe to call from any
+  // thread as long as no two threads own the same vertex.
+  auto setVertex = [&](uint32_t index, Vector3 position) {
+    position.Normalize();
+    if (hasNormals) {
+      output.normals[index] = position;
+    }
+    output.positions[index] = position * initializer.radius;
+  };
+
+  // The index of the vertex that is `step` segments along the edge, walking
+  // away from the `from` corner.
+  auto getEdgeVertex = [&](uint32_t edge, uint32_t from, uint32_t step) {
+    uint32_t k = from == edges[edge][0] ? step : n - step;
+    return edgeStart + edge * verticesPerEdge + (k - 1);
+  };
+
+  // The first interior vertex index of row i of a face, where rows start at 1.
+  auto getRowStart = [&](uint32_t face, uint32_t i) {
+    return faceStart + face * verticesPerFace + (i - 1) * (n - 1) -
+           (i - 1) * i / 2;
+  };
+
+  // Faces are addressed with a lattice coordinate (i, j), where i walks from
+  // corner A to B, and j walks from corner A to C. Vertices on the borders of
+  // the face are owned by the icosahedron's corners and edges, so that they
+  // are shared with the neighboring faces.
+  auto getLatticeIndex = [&](uint32_t face, uint32_t i, uint32_t j) {
+    auto const& cell = base.cells[face];
+    if (i == 0 && j == 0) {
+      return cell[0];
+    }
+    if (i == n) {
+      return cell[1];
+    }
+    if (j == n) {
+      return cell[2];
+    }
+    if (j == 0) {
+      return getEdgeVertex(faceEdges[face][0], cell[0], i);
+    }
+    if (i + j == n) {
+      return getEdgeVertex(faceEdges[face][1], cell[1], j);
+    }
+    if (i == 0) {
+      return getEdgeVertex(faceEdges[face][2], cell[2], n - j);
+    }
+    return getRowStart(face, i) + (j - 1);
+  };
+
+  auto getLatticePosition = [&](uint32_t face, uint32_t i, uint32_t j) {
+    auto const& cell = base.cells[face];
+    float scale = 1.0f / n;
+    return base.positions[cell[0]] * (scale * (n - i - j)) +
+           base.positions[cell[1]] * (scale * i) +
+           base.positions[cell[2]] * (scale * j);
+  };
+
+  for (uint32_t corner = 0; corner < cornerCount; corner++) {
+    setVertex(corner, base.positions[corner]);
+  }
+
+  ParallelFor(edges.size() * verticesPerEdge, 64, [&](size_t task) {
+    uint32_t edge = task / verticesPerEdge;
+    uint32_t k = task % verticesPerEdge + 1;
+    auto& a = base.positions[edges[edge][0]];
+    auto& b = base.positions[edges[edge][1]];
+    float scale = 1.0f / n;
+    setVertex(edgeStart + task, a * (scale * (n - k)) + b * (scale * k));
+  });
+
+  // Each task builds one row of one face. A row owns its interior vertices,
+  // and the triangles between it and the next row.
+  ParallelFor(faceCount * n, 1, [&](size_t task) {
+    uint32_t face = task / n;
+    uint32_t i = task % n;
+
+    if (i >= 1) {
+      for (uint32_t j = 1; i + j < n; j++) {
+        setVertex(getRowStart(face, i) + (j - 1),
+                  getLatticePosition(face, i, j));
+      }
+    }
+
+    size_t cellIndex = size_t(face) * n * n + 2 * n * i - i * i;
+    for (uint32_t j = 0; i + j < n; j++) {
+      // Each step emits the upward triangle (i, j) (i+1, j) (i, j+1), and then
+      // the downward triangle that fills the gap to the next step, if any.
+      output.cells[cellIndex++] = { getLatticeIndex(face, i, j),
+                                  getLatticeIndex(face, i + 1, j),
+                                  getLatticeIndex(face, i, j + 1) };
+      if (i + j + 1 < n) {
+        output.cells[cellIndex++] = { getLatticeIndex(face, i + 1, j),
+                                    getLatticeIndex(face, i + 1, j + 1),
+                                    getLatticeIndex(face, i, j + 1) };
+      }
+    }
+  });
+}
+
+Mesh
+generateIcosphereLattice(IcosphereInitializer initializer)
+{
+  Mesh mesh{};
+  auto spans =
+    allocateMeshSpans(mesh, countIcosphere(initializer), /* withUvs */ false);
+  generateIcosphereLattice(spans, initializer);
+  return mesh;
+}
+
 } // namespace viz
@@ -1,3 +1,4 @@
+#pragma once
 #include "viz/geo/mesh.h"
 #include "viz/math.h"
 
@@ -12,4 +13,38 @@ struct IcosphereInitializer
 Mesh
 generateIcosphere(IcosphereInitializer initializer);
 
+/**
+ * Generates the same sphere as generateIcosphere, but builds the final level
+ * directly on each of the 20 icosahedron faces rather than subdividing level by
+ * level. Every face is split into a lattice of n = 2^subdivisions segments per
+ * side, and the faces are built in parallel.
+ *
+ * The vertices are the same as generateIcosphere, up to floating point
+ * rounding, but the ordering differs:
+ *
+ *  - The 12 icosahedron corners.
+ *  - The (n - 1) inner vertices of each of the 30 icosahedron edges, walking
+ *    from the lower corner index to the higher one.
+ *  - The inner vertices of each of the 20 faces, row by row.
+ *
+ * The cells are emitted face by face, and row by row within a face.
+ */
+Mesh
+generateIcosphereLattice(IcosphereInitializer initializer);
+
+/**
+ * The exact stream sizes of an icosphere with the given subdivisions. This is
+ * the same for both generators.
+ */
+MeshCounts
+countIcosphere(IcosphereInitializer initializer);
+
+/**
+ * Write the lattice icosphere directly into the output spans, which must be at
+ * least as large as countIcosphere(initializer). The normals are optional, and
+ * the uvs are left untouched.
+ */
+void
+generateIcosphereLattice(MeshSpans output, IcosphereInitializer initializer);
+
 } // namespace viz
@@ -0,0 +1,1264 @@
+#include "viz/geo/import.h"
+#include "viz/assert.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <bit>      // std::endian
+#include <cctype>   // std::tolower
+#include <charconv> // std::from_chars
+#include <cstring>  // std::memchr, std::memcpy
+#include <fcntl.h>  // open
+#include <optional>
+#include <string>
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+#include <unordered_map>
+
+namespace viz {
+
+// Chunks are at least this large, so that small files don't pay for threads.
+static const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+static const uint32_t NO_INDEX = ~0u;
+
+/**
+ * Map the file, and call fn with its contents, unmapping it afterwards even if
+ * fn throws.
+ */
+template<typename Fn>
+static Mesh
+withMappedFile(std::filesystem::path const& path, Fn fn)
+{
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    throw ErrorMessage("Unable to open the mesh " + path.string());
+  }
+  struct stat info;
+  if (fstat(descriptor, &info) != 0) {
+    close(descriptor);
+    throw ErrorMessage("Unable to read the mesh " + path.string());
+  }
+  size_t size = info.st_size;
+  if (size == 0) {
+    close(descriptor);
+    return fn(std::string_view{});
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (data == MAP_FAILED) {
+    throw ErrorMessage("Unable to map the mesh " + path.string());
+  }
+  // The file is read front to back.
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  try {
+    Mesh mesh = fn(std::string_view{ static_cast<const char*>(data), size });
+    munmap(data, size);
+    return mesh;
+  } catch (ErrorMessage const& error) {
+    munmap(data, size);
+    throw ErrorMessage(path.string() + ": " + error.what());
+  }
+}
+
+static bool
+isDigit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static const char*
+skipSpaces(const char* p, const char* end)
+{
+  while (p != end && (*p == ' ' || *p == '\t')) {
+    p++;
+  }
+  return p;
+}
+
+static const char*
+skipToken(const char* p, const char* end)
+{
+  while (p != end && *p != ' ' && *p != '\t') {
+    p++;
+  }
+  return p;
+}
+
+/**
+ * A float parser for standard libraries without the floating point
+ * std::from_chars. The digits are gathered into an integer, and scaled by
+ * exact powers of ten in double precision, so the result is within a bit of
+ * the correctly rounded float.
+ */
+[[maybe_unused]] static const char*
+parseFloatFallback(const char* p, const char* end, float& value)
+{
+  bool negative = p != end && *p == '-';
+  if (negative) {
+    p++;
+  }
+
+  uint64_t mantissa = 0;
+  int digitCount = 0;
+  int exponent = 0;
+  bool hasDigits = false;
+  for (; p != end && isDigit(*p); p++) {
+    hasDigits = true;
+    if (digitCount < 19) {
+      mantissa = mantissa * 10 + (*p - '0');
+      digitCount += mantissa != 0 ? 1 : 0;
+    } else {
+      exponent++;
+    }
+  }
+  if (p != end && *p == '.') {
+    for (p++; p != end && isDigit(*p); p++) {
+      hasDigits = true;
+      if (digitCount < 19) {
+        mantissa = mantissa * 10 + (*p - '0');
+        digitCount += mantissa != 0 ? 1 : 0;
+        exponent--;
+      }
+    }
+  }
+  if (!hasDigits) {
+    return nullptr;
+  }
+
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    const char* q = p + 1;
+    bool negativeExponent = q != end && *q == '-';
+    if (q != end && (*q == '-' || *q == '+')) {
+      q++;
+    }
+    if (q != end && isDigit(*q)) {
+      int written = 0;
+      for (; q != end && isDigit(*q); q++) {
+        written = std::min(written * 10 + (*q - '0'), 1000);
+      }
+      exponent += negativeExponent ? -written : written;
+      p = q;
+    }
+  }
+
+  static const double POWERS[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                   1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                   1e18, 1e19, 1e20, 1e21, 1e22 };
+  double result = static_cast<double>(mantissa);
+  if (mantissa != 0) {
+    for (; exponent > 22; exponent -= 22) {
+      result *= POWERS[22];
+    }
+    for (; exponent < -22; exponent += 22) {
+      result /= POWERS[22];
+    }
+    result = exponent < 0 ? result / POWERS[-exponent]
+                          : result * POWERS[exponent];
+  }
+  value = static_cast<float>(negative ? -result : result);
+  return p;
+}
+
+/**
+ * Parse a float after any leading spaces. Returns nullptr if there isn't one.
+ */
+static const char*
+parseFloat(const char* p, const char* end, float& value)
+{
+  p = skipSpaces(p, end);
+  if (p != end && *p == '+') {
+    p++;
+  }
+#if defined(__cpp_lib_to_chars)
+  auto [next, error] = std::from_chars(p, end, value);
+  return error == std::errc() ? next : nullptr;
+#else
+  return parseFloatFallback(p, end, value);
+#endif
+}
+
+/**
+ * Parse an integer after any leading spaces. Returns nullptr if there isn't
+ * one.
+ */
+static const char*
+parseInteger(const char* p, const char* end, int64_t& value)
+{
+  p = skipSpaces(p, end);
+  if (p != end && *p == '+') {
+    p++;
+  }
+  auto [next, error] = std::from_chars(p, end, value);
+  return error == std::errc() ? next : nullptr;
+}
+
+/**
+ * Split the text into about as many chunks as there are threads to parse them,
+ * where every chunk ends just after a newline.
+ */
+static std::vector<std::string_view>
+splitLines(std::string_view text)
+{
+  size_t chunkCount = std::clamp<size_t>(
+    text.size() / MIN_CHUNK_SIZE, 1, GetThreadCount() * 4);
+  std::vector<std::string_view> chunks{};
+  const char* end = text.data() + text.size();
+  const char* begin = text.data();
+  for (size_t i = 1; i <= chunkCount && begin != end; i++) {
+    const char* split = std::max(
+      begin, text.data() + text.size() * i / chunkCount);
+    if (i < chunkCount) {
+      auto newline =
+        static_cast<const char*>(std::memchr(split, '\n', end - split));
+      split = newline == nullptr ? end : newline + 1;
+    } else {
+      split = end;
+    }
+    chunks.emplace_back(begin, split - begin);
+    begin = split;
+  }
+  return chunks;
+}
+
+/**
+ * Call fn(begin, end) for every line of the chunk, without the line ending.
+ * Stops early if fn returns false.
+ */
+template<typename Fn>
+static void
+forEachLine(std::string_view chunk, Fn fn)
+{
+  const char* p = chunk.data();
+  const char* end = chunk.data() + chunk.size();
+  while (p != end) {
+    auto newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+    const char* lineEnd = newline == nullptr ? end : newline;
+    const char* next = newline == nullptr ? end : newline + 1;
+    if (lineEnd != p && lineEnd[-1] == '\r') {
+      lineEnd--;
+    }
+    if (!fn(p, lineEnd)) {
+      return;
+    }
+    p = next;
+  }
+}
+
+static ErrorMessage
+getLineError(std::string_view text, const char* position)
+{
+  size_t line = 1 + std::count(text.data(), position, '\n');
+  return ErrorMessage("Unable to parse line " + std::to_string(line) + ".");
+}
+
+/**
+ * Join the chunks' cells through a prefix sum of their counts.
+ */
+static Cells
+joinCells(std::vector<Cells> const& chunkCells)
+{
+  std::vector<size_t> offsets(chunkCells.size() + 1, 0);
+  for (size_t i = 0; i < chunkCells.size(); i++) {
+    offsets[i + 1] = offsets[i] + chunkCells[i].size();
+  }
+  Cells cells(offsets.back());
+  ParallelFor(chunkCells.size(), 1, [&](size_t i) {
+    std::copy(
+      chunkCells[i].begin(), chunkCells[i].end(), cells.begin() + offsets[i]);
+  });
+  return cells;
+}
+
+/**
+ * What a chunk of an OBJ holds, and where its vertices start.
+ */
+struct ObjChunk
+{
+  std::string_view text;
+  size_t positionCount = 0;
+  size_t uvCount = 0;
+  size_t normalCount = 0;
+  size_t firstPosition = 0;
+  size_t firstUv = 0;
+  size_t firstNormal = 0;
+  Cells cells = {};
+  // Whether every corner's uv and normal index, when it has one, is the same
+  // as its position index.
+  bool uvsMatch = true;
+  bool normalsMatch = true;
+  bool missingUvs = false;
+  bool missingNormals = false;
+  // The uv and normal cells index their own streams, and are NO_INDEX for
+  // corners that don't have one. They are only filled in once a corner doesn't
+  // match, as most files share one index for all three.
+  Cells uvCells = {};
+  Cells normalCells = {};
+  const char* error = nullptr;
+};
+
+enum class ObjLine
+{
+  Position,
+  UV,
+  Normal,
+  Face,
+  Other,
+};
+
+static ObjLine
+getObjLine(const char*& p, const char* end)
+{
+  p = skipSpaces(p, end);
+  if (end - p < 2 || (p[0] != 'v' && p[0] != 'f')) {
+    return ObjLine::Other;
+  }
+  char next = p[1];
+  bool space = next == ' ' || next == '\t';
+  if (p[0] == 'f') {
+    p += 1;
+    return space ? ObjLine::Face : ObjLine::Other;
+  }
+  if (space) {
+    p += 1;
+    return ObjLine::Position;
+  }
+  if (end - p < 3 || (p[2] != ' ' && p[2] != '\t')) {
+    return ObjLine::Other;
+  }
+  p += 2;
+  return next == 't' ? ObjLine::UV
+                     : (next == 'n' ? ObjLine::Normal : ObjLine::Other);
+}
+
+/**
+ * Resolve a 1 based, or negative relative, OBJ index to a 0 based one.
+ */
+static std::optional<uint32_t>
+resolveObjIndex(int64_t index, size_t countSoFar, size_t total)
+{
+  int64_t resolved =
+    index > 0 ? index - 1 : static_cast<int64_t>(countSoFar) + index;
+  if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(total)) {
+    return std::nullopt;
+  }
+  return static_cast<uint32_t>(resolved);
+}
+
+static void
+parseObjChunk(ObjChunk& chunk,
+              std::vector<Vector3>& positions,
+              std::vector<Vector2>& uvs,
+              std::vector<Vector3>& normals)
+{
+  size_t positionIndex = chunk.firstPosition;
+  size_t uvIndex = chunk.firstUv;
+  size_t normalIndex = chunk.firstNormal;
+
+  forEachLine(chunk.text, [&](const char* p, const char* end) {
+    const char* start = p;
+    switch (getObjLine(p, end)) {
+      case ObjLine::Position: {
+        Vector3& position = positions[positionIndex++];
+        for (int i = 0; i < 3 && p != nullptr; i++) {
+          p = parseFloat(p, end, position.v[i]);
+        }
+        break;
+      }
+      case ObjLine::UV: {
+        Vector2& uv = uvs[uvIndex++];
+        p = parseFloat(p, end, uv.v[0]);
+        // The v is optional, and defaults to 0.
+        uv.v[1] = 0.0f;
+        if (p != nullptr && skipSpaces(p, end) != end) {
+          p = parseFloat(p, end, uv.v[1]);
+        }
+        break;
+      }
+      case ObjLine::Normal: {
+        Vector3& normal = normals[normalIndex++];
+        for (int i = 0; i < 3 && p != nullptr; i++) {
+          p = parseFloat(p, end, normal.v[i]);
+        }
+        break;
+      }
+      case ObjLine::Face: {
+        // Each corner is position/uv/normal, where the uv and normal are
+        // optional, and the first corner is shared by the whole fan.
+        std::array<uint32_t, 3> first{};
+        std::array<uint32_t, 3> previous{};
+        size_t cornerCount = 0;
+        for (p = skipSpaces(p, end); p != end; p = skipSpaces(p, end)) {
+          std::array<uint32_t, 3> corner{ NO_INDEX, NO_INDEX, NO_INDEX };
+          std::array<size_t, 3> countSoFar{ positionIndex,
+                                            uvIndex,
+                                            normalIndex };
+          std::array<size_t, 3> total{ positions.size(),
+                                       uvs.size(),
+                                       normals.size() };
+          for (int i = 0; i < 3 && p != nullptr; i++) {
+            if (i > 0) {
+              if (p == end || *p != '/') {
+                break;
+              }
+              p++;
+              // The uv can be left out, as in 1//1.
+              if (i == 1 && p != end && *p == '/') {
+                continue;
+              }
+            }
+            int64_t index = 0;
+            p = parseInteger(p, end, index);
+            if (p != nullptr) {
+              auto resolved = resolveObjIndex(index, countSoFar[i], total[i]);
+              corner[i] = resolved.value_or(NO_INDEX);
+              p = resolved ? p : nullptr;
+            }
+          }
+          if (p == nullptr) {
+            break;
+          }
+
+          bool separate = !chunk.uvsMatch || !chunk.normalsMatch;
+          chunk.missingUvs = chunk.missingUvs || corner[1] == NO_INDEX;
+          chunk.missingNormals = chunk.missingNormals || corner[2] == NO_INDEX;
+          chunk.uvsMatch =
+            chunk.uvsMatch && (corner[1] == corner[0] || corner[1] == NO_INDEX);
+          chunk.normalsMatch = chunk.normalsMatch && (corner[2] == corner[0] ||
+                                                      corner[2] == NO_INDEX);
+          if (!separate && (!chunk.uvsMatch || !chunk.normalsMatch)) {
+            // The cells so far matched, so they double as the other cells.
+            chunk.uvCells = chunk.cells;
+            chunk.normalCells = chunk.cells;
+          }
+
+          if (cornerCount == 0) {
+            first = corner;
+          } else if (cornerCount >= 2) {
+            chunk.cells.push_back({ first[0], previous[0], corner[0] });
+            if (!chunk.uvsMatch || !chunk.normalsMatch) {
+              chunk.uvCells.push_back({ first[1], previous[1], corner[1] });
+              chunk.normalCells.push_back(
+                { first[2], previous[2], corner[2] });
+            }
+          }
+          previous = corner;
+          cornerCount++;
+        }
+        if (p != nullptr && cornerCount < 3) {
+          p = nullptr;
+        }
+        break;
+      }
+      case ObjLine::Other:
+        break;
+    }
+    if (p == nullptr) {
+      chunk.error = start;
+      return false;
+    }
+    return true;
+  });
+}
+
+struct CornerHash
+{
+  size_t operator()(std::array<uint32_t, 3> const& corner) const
+  {
+    uint64_t hash = corner[0];
+    hash = hash * 0x9E3779B97F4A7C15ull + corner[1];
+    hash = hash * 0x9E3779B97F4A7C15ull + corner[2];
+    return hash ^ (hash >> 32);
+  }
+};
+
+Mesh
+parseObj(std::string_view text)
+{
+  std::vector<ObjChunk> chunks{};
+  for (auto chunkText : splitLines(text)) {
+    chunks.push_back({ .text = chunkText });
+  }
+
+  // Count the vertex lines, so that every chunk knows where its vertices go.
+  ParallelFor(chunks.size(), 1, [&](size_t i) {
+    auto& chunk = chunks[i];
+    forEachLine(chunk.text, [&](const char* p, const char* end) {
+      switch (getObjLine(p, end)) {
+        case ObjLine::Position:
+          chunk.positionCount++;
+          break;
+        case ObjLine::UV:
+          chunk.uvCount++;
+          break;
+        case ObjLine::Normal:
+          chunk.normalCount++;
+          break;
+        default:
+          break;
+      }
+      return true;
+    });
+  });
+
+  size_t positionCount = 0;
+  size_t uvCount = 0;
+  size_t normalCount = 0;
+  for (auto& chunk : chunks) {
+    chunk.firstPosition = positionCount;
+    chunk.firstUv = uvCount;
+    chunk.firstNormal = normalCount;
+    positionCount += chunk.positionCount;
+    uvCount += chunk.uvCount;
+    normalCount += chunk.normalCount;
+  }
+
+  std::vector<Vector3> positions(positionCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  std::vector<Vector2> uvs(uvCount, Vector2{ 0.0f, 0.0f });
+  std::vector<Vector3> normals(normalCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  ParallelFor(chunks.size(), 1, [&](size_t i) {
+    parseObjChunk(chunks[i], positions, uvs, normals);
+  });
+
+  bool hasUvs = uvCount > 0;
+  bool hasNormals = normalCount > 0;
+  bool uvsMatch = uvCount == positionCount;
+  bool normalsMatch = normalCount == positionCount;
+  for (auto const& chunk : chunks) {
+    if (chunk.error != nullptr) {
+      throw getLineError(text, chunk.error);
+    }
+    hasUvs = hasUvs && !chunk.missingUvs;
+    hasNormals = hasNormals && !chunk.missingNormals;
+    uvsMatch = uvsMatch && chunk.uvsMatch;
+    normalsMatch = normalsMatch && chunk.normalsMatch;
+  }
+
+  std::vector<Cells> chunkCells{};
+  for (auto& chunk : chunks) {
+    chunkCells.push_back(std::move(chunk.cells));
+  }
+  Mesh mesh{};
+  mesh.cells = joinCells(chunkCells);
+
+  if ((!hasUvs || uvsMatch) && (!hasNormals || normalsMatch)) {
+    mesh.positions = std::move(positions);
+    if (hasUvs) {
+      mesh.uvs = std::move(uvs);
+    }
+    if (hasNormals) {
+      mesh.normals = std::move(normals);
+    }
+    return mesh;
+  }
+
+  // The corners index the streams separately, so give every unique
+  // combination its own vertex.
+  std::unordered_map<std::array<uint32_t, 3>, uint32_t, CornerHash> vertices{};
+  vertices.reserve(positionCount);
+  size_t cellIndex = 0;
+  for (size_t c = 0; c < chunks.size(); c++) {
+    auto const& chunk = chunks[c];
+    bool separate = !chunk.uvCells.empty();
+    for (size_t i = 0; i < chunkCells[c].size(); i++, cellIndex++) {
+      auto& cell = mesh.cells[cellIndex];
+      for (int j = 0; j < 3; j++) {
+        uint32_t uv = separate ? chunk.uvCells[i][j] : cell[j];
+        uint32_t normal = separate ? chunk.normalCells[i][j] : cell[j];
+        std::array<uint32_t, 3> corner{
+          cell[j],
+          hasUvs ? uv : NO_INDEX,
+          hasNormals ? normal : NO_INDEX,
+        };
+        auto [entry, inserted] = vertices.try_emplace(
+          corner, static_cast<uint32_t>(mesh.positions.size()));
+        if (inserted) {
+          mesh.positions.push_back(positions[corner[0]]);
+          if (hasUvs) {
+            mesh.uvs.push_back(uvs[corner[1]]);
+          }
+          if (hasNormals) {
+            mesh.normals.push_back(normals[corner[2]]);
+          }
+        }
+        cell[j] = entry->second;
+      }
+    }
+  }
+  return mesh;
+}
+
+Mesh
+importObj(std::filesystem::path const& path)
+{
+  return withMappedFile(path, parseObj);
+}
+
+enum class PlyFormat
+{
+  Ascii,
+  BinaryLittleEndian,
+  BinaryBigEndian,
+};
+
+enum class PlyType
+{
+  Int8,
+  UInt8,
+  Int16,
+  UInt16,
+  Int32,
+  UInt32,
+  Float32,
+  Float64,
+};
+
+struct PlyProperty
+{
+  std::string name;
+  PlyType type;
+  // Lists store their count as countType, followed by that many values.
+  bool isList = false;
+  PlyType countType = PlyType::UInt8;
+};
+
+struct PlyElement
+{
+  std::string name;
+  size_t count;
+  std::vector<PlyProperty> properties = {};
+};
+
+struct PlyHeader
+{
+  PlyFormat format;
+  std::vector<PlyElement> elements;
+  // Where the data starts, after the header.
+  size_t dataOffset;
+};
+
+static std::optional<PlyType>
+getPlyType(std::string_view name)
+{
+  if (name == "char" || name == "int8") {
+    return PlyType::Int8;
+  }
+  if (name == "uchar" || name == "uint8") {
+    return PlyType::UInt8;
+  }
+  if (name == "short" || name == "int16") {
+    return PlyType::Int16;
+  }
+  if (name == "ushort" || name == "uint16") {
+    return PlyType::UInt16;
+  }
+  if (name == "int" || name == "int32") {
+    return PlyType::Int32;
+  }
+  if (name == "uint" || name == "uint32") {
+    return PlyType::UInt32;
+  }
+  if (name == "float" || name == "float32") {
+    return PlyType::Float32;
+  }
+  if (name == "double" || name == "float64") {
+    return PlyType::Float64;
+  }
+  return std::nullopt;
+}
+
+static size_t
+getPlyTypeSize(PlyType type)
+{
+  switch (type) {
+    case PlyType::Int8:
+    case PlyType::UInt8:
+      return 1;
+    case PlyType::Int16:
+    case PlyType::UInt16:
+      return 2;
+    case PlyType::Int32:
+    case PlyType::UInt32:
+    case PlyType::Float32:
+      return 4;
+    case PlyType::Float64:
+      return 8;
+  }
+  return 0;
+}
+
+static PlyHeader
+parsePlyHeader(std::string_view text)
+{
+  PlyHeader header{ .format = PlyFormat::Ascii, .elements = {} };
+  bool hasFormat = false;
+  size_t lineIndex = 0;
+  size_t offset = 0;
+  while (offset < text.size()) {
+    size_t newline = text.find('\n', offset);
+    size_t lineEnd = newline == std::string_view::npos ? text.size() : newline;
+    std::string_view line = text.substr(offset, lineEnd - offset);
+    offset = lineEnd + 1;
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+
+    std::vector<std::string_view> words{};
+    const char* end = line.data() + line.size();
+    for (const char* p = skipSpaces(line.data(), end); p != end;
+         p = skipSpaces(p, end)) {
+      const char* wordEnd = skipToken(p, end);
+      words.emplace_back(p, wordEnd - p);
+      p = wordEnd;
+    }
+
+    auto fail = [&]() {
+      return ErrorMessage("Unable to parse line " +
+                          std::to_string(lineIndex + 1) + " of the header.");
+    };
+    if (lineIndex++ == 0) {
+      if (words.size() != 1 || words[0] != "ply") {
+        throw ErrorMessage("This is not a PLY file.");
+      }
+      continue;
+    }
+    if (words.empty() || words[0] == "comment" || words[0] == "obj_info") {
+      continue;
+    }
+    if (words[0] == "end_header") {
+      if (!hasFormat) {
+        throw ErrorMessage("The PLY header is missing its format.");
+      }
+      header.dataOffset = std::min(offset, text.size());
+      return header;
+    }
+    if (words[0] == "format" && words.size() == 3) {
+      hasFormat = true;
+      if (words[1] == "ascii") {
+        header.format = PlyFormat::Ascii;
+      } else if (words[1] == "binary_little_endian") {
+        header.format = PlyFormat::BinaryLittleEndian;
+      } else if (words[1] == "binary_big_endian") {
+        header.format = PlyFormat::BinaryBigEndian;
+      } else {
+        throw fail();
+      }
+    } else if (words[0] == "element" && words.size() == 3) {
+      size_t count = 0;
+      auto [next, error] = std::from_chars(
+        words[2].data(), words[2].data() + words[2].size(), count);
+      if (error != std::errc()) {
+        throw fail();
+      }
+      header.elements.push_back({ .name = std::string(words[1]),
+                                  .count = count });
+    } else if (words[0] == "property" && !header.elements.empty()) {
+      auto& properties = header.elements.back().properties;
+      if (words.size() == 3 && getPlyType(words[1])) {
+        properties.push_back({ .name = std::string(words[2]),
+                               .type = *getPlyType(words[1]) });
+      } else if (words.size() == 5 && words[1] == "list" &&
+                 getPlyType(words[2]) && getPlyType(words[3])) {
+        properties.push_back({ .name = std::string(words[4]),
+                               .type = *getPlyType(words[3]),
+                               .isList = true,
+                               .countType = *getPlyType(words[2]) });
+      } else {
+        throw fail();
+      }
+    } else {
+      throw fail();
+    }
+  }
+  throw ErrorMessage("The PLY header is missing end_header.");
+}
+
+/**
+ * Which of the vertex element's properties hold each attribute.
+ */
+struct PlyVertexLayout
+{
+  std::array<std::optional<size_t>, 3> position = {};
+  std::array<std::optional<size_t>, 3> normal = {};
+  std::array<std::optional<size_t>, 2> uv = {};
+
+  bool HasNormals() const { return normal[0] && normal[1] && normal[2]; }
+  bool HasUVs() const { return uv[0] && uv[1]; }
+};
+
+static PlyVertexLayout
+getPlyVertexLayout(PlyElement const& element)
+{
+  PlyVertexLayout layout{};
+  for (size_t i = 0; i < element.properties.size(); i++) {
+    auto const& name = element.properties[i].name;
+    if (element.properties[i].isList) {
+      continue;
+    }
+    if (name == "x" || name == "y" || name == "z") {
+      layout.position[name[0] - 'x'] = i;
+    } else if (name == "nx" || name == "ny" || name == "nz") {
+      layout.normal[name[1] - 'x'] = i;
+    } else if (name == "u" || name == "s" || name == "texture_u" ||
+               name == "texture_s") {
+      layout.uv[0] = i;
+    } else if (name == "v" || name == "t" || name == "texture_v" ||
+               name == "texture_t") {
+      layout.uv[1] = i;
+    }
+  }
+  if (!layout.position[0] || !layout.position[1] || !layout.position[2]) {
+    throw ErrorMessage("The PLY vertices are missing x, y or z.");
+  }
+  return layout;
+}
+
+static std::optional<size_t>
+getPlyFaceIndices(PlyElement const& element)
+{
+  for (size_t i = 0; i < element.properties.size(); i++) {
+    auto const& property = element.properties[i];
+    if (property.isList && (property.name == "vertex_indices" ||
+                            property.name == "vertex_index")) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * Write one vertex's attributes from its property values.
+ */
+static void
+setPlyVertex(Mesh& mesh,
+             size_t index,
+             PlyVertexLayout const& layout,
+             std::span<const double> values)
+{
+  for (int i = 0; i < 3; i++) {
+    mesh.positions[index].v[i] =
+      static_cast<float>(values[*layout.position[i]]);
+  }
+  if (!mesh.normals.empty()) {
+    for (int i = 0; i < 3; i++) {
+      mesh.normals[index].v[i] = static_cast<float>(values[*layout.normal[i]]);
+    }
+  }
+  if (!mesh.uvs.empty()) {
+    for (int i = 0; i < 2; i++) {
+      mesh.uvs[index].v[i] = static_cast<float>(values[*layout.uv[i]]);
+    }
+  }
+}
+
+/**
+ * Split a polygon into a triangle fan. Returns false if it has too few
+ * vertices, or indexes past the vertices.
+ */
+static bool
+addPlyFace(Cells& cells, std::span<const uint32_t> polygon, size_t vertexCount)
+{
+  if (polygon.size() < 3) {
+    return false;
+  }
+  for (auto index : polygon) {
+    if (index >= vertexCount) {
+      return false;
+    }
+  }
+  for (size_t i = 2; i < polygon.size(); i++) {
+    cells.push_back({ polygon[0], polygon[i - 1], polygon[i] });
+  }
+  return true;
+}
+
+static Mesh
+parseAsciiPly(std::string_view text, PlyHeader const& header)
+{
+  std::string_view body = text.substr(header.dataOffset);
+  auto chunkTexts = splitLines(body);
+
+  // Every non-empty line is one record, so count them to find which element
+  // each chunk starts in.
+  std::vector<size_t> firstRecords(chunkTexts.size() + 1, 0);
+  ParallelFor(chunkTexts.size(), 1, [&](size_t i) {
+    size_t count = 0;
+    forEachLine(chunkTexts[i], [&](const char* p, const char* end) {
+      count += skipSpaces(p, end) != end ? 1 : 0;
+      return true;
+    });
+    firstRecords[i + 1] = count;
+  });
+  for (size_t i = 0; i < chunkTexts.size(); i++) {
+    firstRecords[i + 1] += firstRecords[i];
+  }
+
+  std::vector<size_t> elementStarts{ 0 };
+  std::optional<size_t> vertexElement{};
+  std::optional<size_t> faceElement{};
+  for (size_t i = 0; i < header.elements.size(); i++) {
+    elementStarts.push_back(elementStarts.back() + header.elements[i].count);
+    if (header.elements[i].name == "vertex") {
+      vertexElement = i;
+    } else if (header.elements[i].name == "face") {
+      faceElement = i;
+    }
+  }
+  if (!vertexElement) {
+    throw ErrorMessage("The PLY file has no vertex element.");
+  }
+  if (firstRecords.back() < elementStarts.back()) {
+    throw ErrorMessage("The PLY file has fewer records than its header says.");
+  }
+
+  auto const& vertices = header.elements[*vertexElement];
+  auto layout = getPlyVertexLayout(vertices);
+  std::optional<size_t> faceIndices =
+    faceElement ? getPlyFaceIndices(header.elements[*faceElement])
+                : std::nullopt;
+
+  Mesh mesh{};
+  mesh.positions.resize(vertices.count, Vector3{ 0.0f, 0.0f, 0.0f });
+  if (layout.HasNormals()) {
+    mesh.normals.resize(vertices.count, Vector3{ 0.0f, 0.0f, 0.0f });
+  }
+  if (layout.HasUVs()) {
+    mesh.uvs.resize(vertices.count, Vector2{ 0.0f, 0.0f });
+  }
+
+  std::vector<Cells> chunkCells(chunkTexts.size());
+  std::vector<const char*> errors(chunkTexts.size(), nullptr);
+  ParallelFor(chunkTexts.size(), 1, [&](size_t chunk) {
+    size_t record = firstRecords[chunk];
+    size_t element = 0;
+    std::vector<double> values{};
+    std::vector<uint32_t> polygon{};
+
+    forEachLine(chunkTexts[chunk], [&](const char* p, const char* end) {
+      const char* start = p;
+      if (skipSpaces(p, end) == end) {
+        return true;
+      }
+      while (element < header.elements.size() &&
+             record >= elementStarts[element + 1]) {
+        element++;
+      }
+      if (element != vertexElement && element != faceElement) {
+        record++;
+        return true;
+      }
+
+      // Read every property, keeping the scalars, and the face's indices.
+      auto const& properties = header.elements[element].properties;
+      values.assign(properties.size(), 0.0);
+      polygon.clear();
+      for (size_t i = 0; i < properties.size() && p != nullptr; i++) {
+        if (!properties[i].isList) {
+          float value = 0.0f;
+          p = parseFloat(p, end, value);
+          values[i] = value;
+          continue;
+        }
+        int64_t count = 0;
+        p = parseInteger(p, end, count);
+        for (int64_t j = 0; j < count && p != nullptr; j++) {
+          float value = 0.0f;
+          if (element == faceElement && i == faceIndices) {
+            int64_t index = 0;
+            p = parseInteger(p, end, index);
+            polygon.push_back(index < 0 ? NO_INDEX
+                                        : static_cast<uint32_t>(index));
+          } else {
+            p = parseFloat(p, end, value);
+          }
+        }
+      }
+
+      if (p != nullptr && element == vertexElement) {
+        setPlyVertex(mesh, record - elementStarts[element], layout, values);
+      } else if (p != nullptr && faceIndices &&
+                 !addPlyFace(chunkCells[chunk], polygon, vertices.count)) {
+        p = nullptr;
+      }
+      if (p == nullptr) {
+        errors[chunk] = start;
+        return false;
+      }
+      record++;
+      return true;
+    });
+  });
+
+  for (auto error : errors) {
+    if (error != nullptr) {
+      throw getLineError(text, error);
+    }
+  }
+  mesh.cells = joinCells(chunkCells);
+  return mesh;
+}
+
+template<typename T>
+static T
+readPlyScalar(const char* data, bool swap)
+{
+  char bytes[sizeof(T)];
+  std::memcpy(bytes, data, sizeof(T));
+  if (swap) {
+    std::reverse(bytes, bytes + sizeof(T));
+  }
+  T value;
+  std::memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+static double
+readPlyValue(const char* data, PlyType type, bool swap)
+{
+  switch (type) {
+    case PlyType::Int8:
+      return readPlyScalar<int8_t>(data, swap);
+    case PlyType::UInt8:
+      return readPlyScalar<uint8_t>(data, swap);
+    case PlyType::Int16:
+      return readPlyScalar<int16_t>(data, swap);
+    case PlyType::UInt16:
+      return readPlyScalar<uint16_t>(data, swap);
+    case PlyType::Int32:
+      return readPlyScalar<int32_t>(data, swap);
+    case PlyType::UInt32:
+      return readPlyScalar<uint32_t>(data, swap);
+    case PlyType::Float32:
+      return readPlyScalar<float>(data, swap);
+    case PlyType::Float64:
+      return readPlyScalar<double>(data, swap);
+  }
+  return 0.0;
+}
+
+/**
+ * Walks one binary record. Returns the position after it, or nullptr if it runs
+ * past the end. The scalars are written to values, and the list at listIndex to
+ * polygon.
+ */
+static const char*
+readPlyRecord(const char* p,
+              const char* end,
+              PlyElement const& element,
+              bool swap,
+              std::span<double> values,
+              std::optional<size_t> listIndex,
+              std::vector<uint32_t>& polygon)
+{
+  for (size_t i = 0; i < element.properties.size(); i++) {
+    auto const& property = element.properties[i];
+    size_t size = getPlyTypeSize(property.type);
+    if (!property.isList) {
+      if (static_cast<size_t>(end - p) < size) {
+        return nullptr;
+      }
+      values[i] = readPlyValue(p, property.type, swap);
+      p += size;
+      continue;
+    }
+    size_t countSize = getPlyTypeSize(property.countType);
+    if (static_cast<size_t>(end - p) < countSize) {
+      return nullptr;
+    }
+    double count = readPlyValue(p, property.countType, swap);
+    p += countSize;
+    if (count < 0 || static_cast<size_t>(end - p) / size < count) {
+      return nullptr;
+    }
+    if (i == listIndex) {
+      polygon.clear();
+      for (size_t j = 0; j < count; j++) {
+        double index = readPlyValue(p + j * size, property.type, swap);
+        polygon.push_back(index < 0 ? NO_INDEX : static_cast<uint32_t>(index));
+      }
+    }
+    p += static_cast<size_t>(count) * size;
+  }
+  return p;
+}
+
+/**
+ * The stride of a record if every list has listSize values, which is what the
+ * triangle fast path assumes of the faces.
+ */
+static size_t
+getPlyStride(PlyElement const& element, size_t listSize)
+{
+  size_t stride = 0;
+  for (auto const& property : element.properties) {
+    stride += property.isList
+                ? getPlyTypeSize(property.countType) +
+                    listSize * getPlyTypeSize(property.type)
+                : getPlyTypeSize(property.type);
+  }
+  return stride;
+}
+
+static size_t
+getPlyListCount(PlyElement const& element)
+{
+  return std::count_if(element.properties.begin(),
+                       element.properties.end(),
+                       [](auto const& property) { return property.isList; });
+}
+
+static Mesh
+parseBinaryPly(std::string_view text, PlyHeader const& header)
+{
+  bool swap = (header.format == PlyFormat::BinaryBigEndian) !=
+              (std::endian::native == std::endian::big);
+  const char* p = text.data() + header.dataOffset;
+  const char* end = text.data() + text.size();
+  const size_t grainSize = 4096;
+  auto truncated = []() {
+    return ErrorMessage("The PLY file is shorter than its header says.");
+  };
+
+  Mesh mesh{};
+  std::optional<PlyVertexLayout> layout{};
+  size_t vertexCount = 0;
+  std::vector<uint32_t> polygon{};
+
+  for (auto const& element : header.elements) {
+    std::vector<double> values(element.properties.size(), 0.0);
+    bool isVertex = element.name == "vertex";
+    bool isFace = element.name == "face";
+
+    if (isVertex) {
+      layout = getPlyVertexLayout(element);
+      vertexCount = element.count;
+      mesh.positions.resize(vertexCount, Vector3{ 0.0f, 0.0f, 0.0f });
+      if (layout->HasNormals()) {
+        mesh.normals.resize(vertexCount, Vector3{ 0.0f, 0.0f, 0.0f });
+      }
+      if (layout->HasUVs()) {
+        mesh.uvs.resize(vertexCount, Vector2{ 0.0f, 0.0f });
+      }
+    }
+
+    // Elements without lists have a fixed stride, so their records can be
+    // found, and read, independently.
+    if (getPlyListCount(element) == 0) {
+      size_t stride = getPlyStride(element, 0);
+      if (static_cast<size_t>(end - p) / std::max<size_t>(stride, 1) <
+          element.count) {
+        throw truncated();
+      }
+      if (isVertex) {
+        ParallelFor(element.count, grainSize, [&](size_t i) {
+          std::vector<uint32_t> unused{};
+          double values[64];
+          std::span<double> span{ values, element.properties.size() };
+          readPlyRecord(p + i * stride, end, element, swap, span, {}, unused);
+          setPlyVertex(mesh, i, *layout, span);
+        });
+      }
+      p += element.count * stride;
+      continue;
+    }
+
+    std::optional<size_t> faceIndices =
+      isFace ? getPlyFaceIndices(element) : std::nullopt;
+    if (faceIndices && !layout) {
+      throw ErrorMessage("The PLY faces come before the vertices.");
+    }
+
+    // Try the faces as triangles first, which is almost always what they are.
+    // If any of them aren't, fall back to walking them one at a time. This
+    // only works when the indices are the only list, as the stride assumes
+    // every list has 3 values.
+    size_t triangleStride = getPlyStride(element, 3);
+    if (faceIndices && getPlyListCount(element) == 1 &&
+        static_cast<size_t>(end - p) / triangleStride >= element.count) {
+      size_t blockCount = (element.count + grainSize - 1) / grainSize;
+      std::vector<uint8_t> valid(blockCount, 1);
+      Cells cells(element.count);
+      ParallelFor(blockCount, 1, [&](size_t block) {
+        std::vector<uint32_t> triangle{};
+        double values[64];
+        std::span<double> span{ values, element.properties.size() };
+        size_t blockEnd = std::min(element.count, (block + 1) * grainSize);
+        for (size_t i = block * grainSize; i < blockEnd; i++) {
+          triangle.clear();
+          const char* record = p + i * triangleStride;
+          const char* next = readPlyRecord(
+            record, end, element, swap, span, faceIndices, triangle);
+          if (next != record + triangleStride || triangle.size() != 3 ||
+              triangle[0] >= vertexCount || triangle[1] >= vertexCount ||
+              triangle[2] >= vertexCount) {
+            valid[block] = 0;
+            return;
+          }
+          cells[i] = { triangle[0], triangle[1], triangle[2] };
+        }
+      });
+      if (std::all_of(valid.begin(), valid.end(), [](auto v) { return v; })) {
+        mesh.cells = std::move(cells);
+        p += element.count * triangleStride;
+        continue;
+      }
+    }
+
+    for (size_t i = 0; i < element.count; i++) {
+      p = readPlyRecord(p, end, element, swap, values, faceIndices, polygon);
+      if (p == nullptr) {
+        throw truncated();
+      }
+      if (faceIndices && !addPlyFace(mesh.cells, polygon, vertexCount)) {
+        throw ErrorMessage("Face " + std::to_string(i) + " is invalid.");
+      }
+    }
+  }
+
+  if (!layout) {
+    throw ErrorMessage("The PLY file has no vertex element.");
+  }
+  return mesh;
+}
+
+Mesh
+parsePly(std::string_view text)
+{
+  PlyHeader header = parsePlyHeader(text);
+  for (auto const& element : header.elements) {
+    if (element.properties.size() > 64) {
+      throw ErrorMessage("The PLY element " + element.name +
+                         " has too many properties.");
+    }
+  }
+  return header.format == PlyFormat::Ascii ? parseAsciiPly(text, header)
+                                           : parseBinaryPly(text, header);
+}
+
+Mesh
+importPly(std::filesystem::path const& path)
+{
+  return withMappedFile(path, parsePly);
+}
+
+Mesh
+importMesh(std::filesystem::path const& path)
+{
+  auto extension = path.extension().string();
+  std::transform(
+    extension.begin(), extension.end(), extension.begin(), [](char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+  if (extension == ".obj") {
+    return importObj(path);
+  }
+  if (extension == ".ply") {
+    return importPly(path);
+  }
+  throw ErrorMessage("Unable to import " + path.string() +
+                     ", only .obj and .ply files are supported.");
+}
+
+} // namespace viz
@@ -0,0 +1,54 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <filesystem>
+#include <string_view>
+
+namespace viz {
+
+/**
+ * Import a Wavefront OBJ. The positions, texture coordinates, normals and faces
+ * are read, and everything else is skipped. Polygons are split into triangle
+ * fans, and negative indices count back from the end, as in the spec.
+ *
+ * When every corner uses the same index for its position, uv and normal, the
+ * streams are used as they are. Otherwise the corners are split into a vertex
+ * per unique combination. The uvs and normals are only kept when every corner
+ * has one.
+ *
+ * The file is memory mapped, and split into chunks on line boundaries, which
+ * are parsed in parallel. The vertex lines are counted first, so that every
+ * chunk can parse its vertices straight into place, and the chunks' cells are
+ * joined afterwards through a prefix sum of their counts.
+ *
+ * Throws an ErrorMessage with the line number when the file can't be parsed.
+ */
+Mesh
+importObj(std::filesystem::path const& path);
+
+Mesh
+parseObj(std::string_view text);
+
+/**
+ * Import a PLY, in either the ascii or binary formats. The vertex element's
+ * x, y, z, nx, ny, nz, and u, v or s, t properties are read, in any scalar
+ * type, along with the face element's vertex_indices. Polygons are split into
+ * triangle fans, and any other elements are skipped.
+ *
+ * Ascii files are split into chunks on line boundaries and parsed in parallel
+ * like importObj. The vertices of binary files have a fixed stride, so they
+ * are parsed in parallel directly, and so are the faces when they are all
+ * triangles, which is checked first.
+ */
+Mesh
+importPly(std::filesystem::path const& path);
+
+Mesh
+parsePly(std::string_view text);
+
+/**
+ * Import a mesh with the importer for its extension, .obj or .ply.
+ */
+Mesh
+importMesh(std::filesystem::path const& path);
+
+} // namespace viz
@@ -0,0 +1,142 @@
+#include "viz/geo/index-buffer.h"
+#include "viz/assert.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace viz {
+
+mtlpp::IndexType
+getIndexType(size_t vertexCount)
+{
+  // 0xFFFF is the primitive restart index for 16 bit draws, so it can't be
+  // used for a vertex, and a mesh with 65536 vertices needs 32 bits.
+  return vertexCount <= 0xFFFF ? mtlpp::IndexType::UInt16
+                               : mtlpp::IndexType::UInt32;
+}
+
+static size_t
+getIndexSize(mtlpp::IndexType indexType)
+{
+  return indexType == mtlpp::IndexType::UInt16 ? sizeof(uint16_t)
+                                               : sizeof(uint32_t);
+}
+
+void
+narrowIndices(std::span<const uint32_t> input, std::span<uint16_t> output)
+{
+  DebugAssert(output.size() >= input.size(),
+              "The narrowed index output is too small.");
+
+  const uint32_t* in = input.data();
+  uint16_t* out = output.data();
+  size_t count = input.size();
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  // SSE2 only has a signed saturating pack. Shift the indices into the signed
+  // range first, and then shift them back after packing.
+  const __m128i bias32 = _mm_set1_epi32(0x8000);
+  const __m128i bias16 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+  for (; i + 8 <= count; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4));
+    __m128i packed = _mm_packs_epi32(_mm_sub_epi32(a, bias32),
+                                     _mm_sub_epi32(b, bias32));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_add_epi16(packed, bias16));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 8 <= count; i += 8) {
+    uint16x4_t a = vmovn_u32(vld1q_u32(in + i));
+    uint16x4_t b = vmovn_u32(vld1q_u32(in + i + 4));
+    vst1q_u16(out + i, vcombine_u16(a, b));
+  }
+#endif
+
+  for (; i < count; i++) {
+    out[i] = static_cast<uint16_t>(in[i]);
+  }
+}
+
+std::span<const uint32_t>
+getCellIndices(std::span<const std::array<uint32_t, 3>> cells)
+{
+  return std::span<const uint32_t>{
+    reinterpret_cast<const uint32_t*>(cells.data()), cells.size() * 3
+  };
+}
+
+IndexBuffer::IndexBuffer(Device& device,
+                         mtlpp::ResourceOptions options,
+                         size_t vertexCount,
+                         size_t indexCount)
+  : BufferView(device, options, getIndexSize(getIndexType(vertexCount)) * indexCount)
+  , indexType(getIndexType(vertexCount))
+  , indexCount(indexCount)
+{}
+
+IndexBuffer::IndexBuffer(Device& device,
+                         mtlpp::ResourceOptions options,
+                         size_t vertexCount,
+                         std::span<const uint32_t> indices)
+  : IndexBuffer(device, options, vertexCount, indices.size())
+{
+  SetIndices(indices);
+}
+
+IndexBuffer::IndexBuffer(Device& device,
+                         mtlpp::ResourceOptions options,
+                         size_t vertexCount,
+                         std::span<const std::array<uint32_t, 3>> cells)
+  : IndexBuffer(device, options, vertexCount, getCellIndices(cells))
+{}
+
+void
+IndexBuffer::SetIndices(std::span<const uint32_t> indices, size_t offset)
+{
+  ReleaseAssert(offset + indices.size() <= indexCount,
+                "The indices do not fit into the index buffer.");
+
+  if (indexType == mtlpp::IndexType::UInt16) {
+    auto contents = static_cast<uint16_t*>(buffer.GetContents());
+    narrowIndices(indices,
+                  std::span<uint16_t>{ contents + offset, indices.size() });
+  } else {
+    auto contents = static_cast<uint32_t*>(buffer.GetContents());
+    std::copy(indices.begin(), indices.end(), contents + offset);
+  }
+}
+
+std::span<std::array<uint32_t, 3>>
+IndexBuffer::GetUInt32Cells()
+{
+  if (indexType != mtlpp::IndexType::UInt32) {
+    return {};
+  }
+  return std::span<std::array<uint32_t, 3>>{
+    static_cast<std::array<uint32_t, 3>*>(buffer.GetContents()),
+    indexCount / 3
+  };
+}
+
+IndexRange
+IndexBuffer::GetCellRange(size_t firstCell, size_t cellCount) const
+{
+  DebugAssert((firstCell + cellCount) * 3 <= indexCount,
+              "The cell range is out of bounds.");
+  if (indexType == mtlpp::IndexType::UInt16 && firstCell % 2 == 1) {
+    firstCell--;
+    cellCount++;
+  }
+  return IndexRange{
+    .offset =
+      static_cast<uint32_t>(firstCell * 3 * getIndexSize(indexType)),
+    .indexCount = static_cast<uint32_t>(cellCount * 3),
+  };
+}
+
+} // namespace viz
@@ -0,0 +1,93 @@
+#pragma once
+#include "viz/metal.h"
+#include <array>
+#include <span>
+
+namespace viz {
+
+/**
+ * The smallest index type that can address every vertex of a mesh. 16 bit
+ * indices are used for up to 65535 vertices, as Metal reserves 0xFFFF to
+ * restart the primitive.
+ */
+mtlpp::IndexType
+getIndexType(size_t vertexCount);
+
+/**
+ * Narrow 32 bit indices into 16 bit ones. Every index must already fit into a
+ * uint16_t, and the output must be at least as long as the input. This uses
+ * SSE2 or NEON to convert 8 indices at a time when they are available.
+ */
+void
+narrowIndices(std::span<const uint32_t> input, std::span<uint16_t> output);
+
+/**
+ * View a list of cells as a flat list of indices.
+ */
+std::span<const uint32_t>
+getCellIndices(std::span<const std::array<uint32_t, 3>> cells);
+
+/**
+ * The arguments to draw part of an index buffer.
+ */
+struct IndexRange
+{
+  // In bytes, for DrawIndexedInitializer::indexBufferOffset.
+  uint32_t offset;
+  uint32_t indexCount;
+};
+
+/**
+ * A GPU index buffer that automatically uses 16 bit indices when the mesh has
+ * at most 65535 vertices, see getIndexType, which halves the index memory and
+ * bandwidth. It carries its own IndexType and count, so that draw calls don't
+ * need to hardcode them.
+ */
+class IndexBuffer : public BufferView
+{
+public:
+  // Move only
+  IndexBuffer(IndexBuffer&& other) = default;
+  IndexBuffer& operator=(IndexBuffer&& other) = default;
+
+  // Allocate the buffer without writing to it. The indices can then be written
+  // with SetIndices.
+  IndexBuffer(Device& device,
+              mtlpp::ResourceOptions options,
+              size_t vertexCount,
+              size_t indexCount);
+
+  IndexBuffer(Device& device,
+              mtlpp::ResourceOptions options,
+              size_t vertexCount,
+              std::span<const uint32_t> indices);
+
+  IndexBuffer(Device& device,
+              mtlpp::ResourceOptions options,
+              size_t vertexCount,
+              std::span<const std::array<uint32_t, 3>> cells);
+
+  /**
+   * Write indices into the buffer starting at an index offset, narrowing them
+   * if this is a 16 bit buffer.
+   */
+  void SetIndices(std::span<const uint32_t> indices, size_t offset = 0);
+
+  /**
+   * The buffer contents as 32 bit cells, so that they can be written to
+   * directly. This is empty for 16 bit buffers.
+   */
+  std::span<std::array<uint32_t, 3>> GetUInt32Cells();
+
+  /**
+   * The range to draw a run of cells. Metal needs index buffer offsets to be 4
+   * byte aligned, so with 16 bit indices an odd first cell is moved back by
+   * one, and one extra cell is drawn.
+   */
+  IndexRange GetCellRange(size_t firstCell, size_t cellCount) const;
+
+  mtlpp::IndexType indexType;
+  uint32_t indexCount;
+};
+
+} // namespace viz
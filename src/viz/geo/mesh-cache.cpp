@@ -0,0 +1,256 @@
+#include "viz/geo/mesh-cache.h"
+#include "viz/geo/box.h"
+#include "viz/geo/icosphere.h"
+#include "viz/geo/vertex-cache.h"
+#include "viz/geo/vertex-fetch.h"
+#include "viz/utils.h"
+#include <cstring> // std::memcpy
+#include <fstream>
+#include <future>
+#include <map>
+#include <mutex>
+#include <sstream> // std::ostringstream
+#include <string>
+
+namespace viz {
+
+// Bump the version whenever a generator's output changes, so that stale files
+// on disk are ignored.
+static const char CACHE_MAGIC[4] = { 'V', 'Z', 'M', 'C' };
+static const uint32_t CACHE_VERSION = 3;
+
+struct CachedMeshHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t positionCount;
+  uint32_t uvCount;
+  uint32_t normalCount;
+  uint32_t cellCount;
+};
+
+static std::mutex sCacheMutex;
+static std::optional<std::filesystem::path> sCacheDirectory;
+// Each entry is added before its mesh is generated, so that callers with the
+// same key wait for the first one, rather than generating it again.
+static std::map<std::pair<size_t, float>, std::shared_future<SharedMesh>>
+  sIcospheres;
+static std::map<std::array<float, 6>, std::shared_future<SharedMesh>> sBoxes;
+
+// Floats are written by their bits, so that the file name is exact.
+static std::string
+floatToKey(float value)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  std::ostringstream stream;
+  stream << std::hex << bits;
+  return stream.str();
+}
+
+template<typename List>
+static bool
+readList(std::ifstream& file, List& list, size_t count)
+{
+  if (count == 0) {
+    return true;
+  }
+  file.read(reinterpret_cast<char*>(list.data()), sizeof(list[0]) * count);
+  return file.good();
+}
+
+template<typename List>
+static void
+writeList(std::ofstream& file, List const& list)
+{
+  if (!list.empty()) {
+    file.write(reinterpret_cast<const char*>(list.data()),
+               sizeof(list[0]) * list.size());
+  }
+}
+
+static std::optional<Mesh>
+readCachedMesh(std::filesystem::path const& path)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+
+  CachedMeshHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!file || std::memcmp(header.magic, CACHE_MAGIC, 4) != 0 ||
+      header.version != CACHE_VERSION) {
+    return std::nullopt;
+  }
+
+  // Check the counts against the size of the file before allocating for them,
+  // so that a truncated or corrupt file is a miss rather than a huge resize.
+  std::error_code error;
+  uint64_t fileSize = std::filesystem::file_size(path, error);
+  uint64_t expectedSize =
+    sizeof(header) +
+    uint64_t{ header.positionCount } * sizeof(Vector3) +
+    uint64_t{ header.uvCount } * sizeof(Vector2) +
+    uint64_t{ header.normalCount } * sizeof(Vector3) +
+    uint64_t{ header.cellCount } * sizeof(std::array<uint32_t, 3>);
+  if (error || fileSize != expectedSize) {
+    return std::nullopt;
+  }
+
+  Mesh mesh{};
+  mesh.positions.resize(header.positionCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  mesh.uvs.resize(header.uvCount, Vector2{ 0.0f, 0.0f });
+  mesh.normals.resize(header.normalCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  mesh.cells.resize(header.cellCount);
+
+  if (!readList(file, mesh.positions, header.positionCount) ||
+      !readList(file, mesh.uvs, header.uvCount) ||
+      !readList(file, mesh.normals, header.normalCount) ||
+      !readList(file, mesh.cells, header.cellCount)) {
+    return std::nullopt;
+  }
+  return mesh;
+}
+
+// The cache is best-effort, so failing to write it is not an error.
+static void
+writeCachedMesh(std::filesystem::path const& path, Mesh const& mesh)
+{
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  if (error) {
+    return;
+  }
+
+  // Write to a temporary file first, and then move it into place, so that a
+  // concurrent launch never reads a partially written file.
+  auto temporaryPath = path;
+  temporaryPath += ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      return;
+    }
+
+    CachedMeshHeader header{
+      .magic = { CACHE_MAGIC[0], CACHE_MAGIC[1], CACHE_MAGIC[2], CACHE_MAGIC[3] },
+      .version = CACHE_VERSION,
+      .positionCount = static_cast<uint32_t>(mesh.positions.size()),
+      .uvCount = static_cast<uint32_t>(mesh.uvs.size()),
+      .normalCount = static_cast<uint32_t>(mesh.normals.size()),
+      .cellCount = static_cast<uint32_t>(mesh.cells.size()),
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writeList(file, mesh.positions);
+    writeList(file, mesh.uvs);
+    writeList(file, mesh.normals);
+    writeList(file, mesh.cells);
+    if (!file) {
+      return;
+    }
+  }
+  std::filesystem::rename(temporaryPath, path, error);
+}
+
+/**
+ * Look the key up, or load or generate it. sCacheMutex is only held to look up
+ * and claim the entry, so the disk and the generator don't block callers with
+ * other keys. The generators are deterministic, so when one throws, the error
+ * is kept in the entry and rethrown to every caller with that key.
+ */
+template<typename Key, typename Generate>
+static SharedMesh
+getOrGenerate(std::map<Key, std::shared_future<SharedMesh>>& cache,
+              Key const& key,
+              std::string const& fileName,
+              Generate generate)
+{
+  std::unique_lock<std::mutex> lock(sCacheMutex);
+  auto result = cache.find(key);
+  if (result != cache.end()) {
+    auto future = result->second;
+    lock.unlock();
+    return future.get();
+  }
+
+  std::promise<SharedMesh> promise{};
+  auto future = promise.get_future().share();
+  cache.insert({ key, future });
+  auto directory = sCacheDirectory;
+  lock.unlock();
+
+  try {
+    std::optional<Mesh> mesh{};
+    if (directory) {
+      mesh = readCachedMesh(directory.value() / fileName);
+    }
+    if (!mesh) {
+      mesh = generate();
+      // The generators emit cells in a convenient order to build, rather than
+      // to draw, so optimize them once here, before they are stored.
+      optimizeVertexCache(mesh.value());
+      optimizeVertexFetch(mesh.value());
+      if (directory) {
+        writeCachedMesh(directory.value() / fileName, mesh.value());
+      }
+    }
+    promise.set_value(std::make_shared<const Mesh>(std::move(mesh.value())));
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+  return future.get();
+}
+
+SharedMesh
+getCachedIcosphere(IcosphereInitializer initializer)
+{
+  auto [subdivisions, radius] = initializer;
+
+  return getOrGenerate(
+    sIcospheres,
+    std::pair{ subdivisions, radius },
+    "icosphere-" + std::to_string(subdivisions) + "-" + floatToKey(radius) +
+      ".mesh",
+    [&]() { return generateIcosphere(initializer); });
+}
+
+SharedMesh
+getCachedBox(Vector3 size, Vector3 segments)
+{
+  std::array<float, 6> key{ size[0],     size[1],     size[2],
+                            segments[0], segments[1], segments[2] };
+
+  std::string fileName = "box";
+  for (auto value : key) {
+    fileName += "-" + floatToKey(value);
+  }
+  fileName += ".mesh";
+
+  return getOrGenerate(
+    sBoxes, key, fileName, [&]() { return generateBox(size, segments); });
+}
+
+void
+setMeshCacheDirectory(std::optional<std::filesystem::path> directory)
+{
+  std::lock_guard<std::mutex> lock(sCacheMutex);
+  sCacheDirectory = directory;
+}
+
+std::filesystem::path
+getDefaultMeshCacheDirectory()
+{
+  return std::filesystem::path{ getExecutablePath() }.parent_path() /
+         "mesh-cache";
+}
+
+void
+clearMeshCache()
+{
+  std::lock_guard<std::mutex> lock(sCacheMutex);
+  sIcospheres.clear();
+  sBoxes.clear();
+}
+
+} // namespace viz
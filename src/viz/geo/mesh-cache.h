@@ -0,0 +1,54 @@
+#pragma once
+#include "viz/geo/icosphere.h"
+#include "viz/geo/mesh.h"
+#include "viz/math.h"
+#include <filesystem>
+#include <memory>
+#include <optional>
+
+namespace viz {
+
+/**
+ * Cached meshes are shared between every caller, so they can't be mutated.
+ */
+using SharedMesh = std::shared_ptr<const Mesh>;
+
+/**
+ * Memoized versions of the generators. The first call with a given set of
+ * parameters generates the mesh, and every later call hands out the same
+ * instance. The cells and vertices are reordered for the vertex cache and
+ * vertex fetch before the mesh is stored. These are safe to call from multiple
+ * threads.
+ */
+SharedMesh
+getCachedIcosphere(IcosphereInitializer initializer);
+
+SharedMesh
+getCachedBox(Vector3 size, Vector3 segments);
+
+/**
+ * By default meshes are only cached in memory. Setting a directory persists
+ * each generated mesh there as a binary file, so that later launches can load
+ * it rather than generating it again. Pass std::nullopt to turn this off.
+ */
+void
+setMeshCacheDirectory(std::optional<std::filesystem::path> directory);
+
+/**
+ * The "mesh-cache" directory next to the binary.
+ *
+ * e.g.
+ * /path/to/bin/example
+ * /path/to/bin/mesh-cache/
+ */
+std::filesystem::path
+getDefaultMeshCacheDirectory();
+
+/**
+ * Drop every in-memory mesh. Meshes that are still referenced elsewhere stay
+ * alive until they are released.
+ */
+void
+clearMeshCache();
+
+} // namespace viz
@@ -0,0 +1,387 @@
+#include "viz/geo/mesh-file.h"
+#include "viz/assert.h"
+#include "viz/geo/normals.h"
+#include <algorithm>
+#include <cstring> // std::memcmp
+#include <fcntl.h> // open
+#include <fstream>
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+#include <utility>    // std::exchange
+
+namespace viz {
+
+static const char MESH_FILE_MAGIC[4] = { 'V', 'Z', 'M', 'F' };
+
+static uint64_t
+alignToPage(uint64_t size)
+{
+  return (size + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT *
+         MESH_FILE_ALIGNMENT;
+}
+
+void
+writeMeshFile(std::filesystem::path const& path,
+              MeshFileContents const& contents)
+{
+  MeshFileHeader header{
+    .magic = { MESH_FILE_MAGIC[0],
+               MESH_FILE_MAGIC[1],
+               MESH_FILE_MAGIC[2],
+               MESH_FILE_MAGIC[3] },
+    .version = MESH_FILE_VERSION,
+    .vertexCount = contents.vertexCount,
+    .cellCount = contents.cellCount,
+    .boundsMin = contents.boundsMin,
+    .boundsMax = contents.boundsMax,
+    .blockCount = static_cast<uint32_t>(contents.blocks.size()),
+    .reserved = 0,
+  };
+
+  // The header and block table take up the first page, or pages, and the
+  // blocks follow one after the other.
+  std::vector<MeshFileBlock> blocks{};
+  uint64_t offset = alignToPage(sizeof(MeshFileHeader) +
+                                sizeof(MeshFileBlock) * contents.blocks.size());
+  for (auto const& block : contents.blocks) {
+    ReleaseAssert(block.data.size() ==
+                    static_cast<uint64_t>(block.stride) * block.count,
+                  "A mesh file block's data doesn't match its stride and "
+                  "count.");
+    blocks.push_back({
+      .type = block.type,
+      .format = block.format,
+      .stride = block.stride,
+      .count = block.count,
+      .offset = offset,
+      .size = block.data.size(),
+    });
+    offset += alignToPage(block.data.size());
+  }
+
+  auto temporaryPath = path;
+  temporaryPath += ".tmp";
+  {
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      throw ErrorMessage("Unable to write the mesh file " +
+                         temporaryPath.string());
+    }
+
+    std::vector<char> padding(MESH_FILE_ALIGNMENT, 0);
+    auto padTo = [&](uint64_t position) {
+      file.write(padding.data(), position - file.tellp());
+    };
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(blocks.data()),
+               sizeof(MeshFileBlock) * blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+      padTo(blocks[i].offset);
+      file.write(reinterpret_cast<const char*>(contents.blocks[i].data.data()),
+                 contents.blocks[i].data.size());
+    }
+    padTo(offset);
+    if (!file) {
+      throw ErrorMessage("Unable to write the mesh file " +
+                         temporaryPath.string());
+    }
+  }
+  std::filesystem::rename(temporaryPath, path);
+}
+
+template<typename T>
+static std::span<const uint8_t>
+asBytes(std::vector<T> const& list)
+{
+  return { reinterpret_cast<const uint8_t*>(list.data()),
+           sizeof(T) * list.size() };
+}
+
+void
+writeMeshFile(std::filesystem::path const& path, Mesh const& mesh)
+{
+  auto vertexCount = static_cast<uint32_t>(mesh.positions.size());
+  MeshFileContents contents{
+    .vertexCount = vertexCount,
+    .cellCount = static_cast<uint32_t>(mesh.cells.size()),
+  };
+
+  for (size_t i = 0; i < mesh.positions.size(); i++) {
+    for (int j = 0; j < 3; j++) {
+      float value = mesh.positions[i].v[j];
+      contents.boundsMin[j] =
+        i == 0 ? value : std::min(contents.boundsMin[j], value);
+      contents.boundsMax[j] =
+        i == 0 ? value : std::max(contents.boundsMax[j], value);
+    }
+  }
+
+  auto float3 = static_cast<uint32_t>(mtlpp::VertexFormat::Float3);
+  auto float2 = static_cast<uint32_t>(mtlpp::VertexFormat::Float2);
+  contents.blocks.push_back({ MeshFileBlockType::Positions,
+                              float3,
+                              sizeof(Vector3),
+                              vertexCount,
+                              asBytes(mesh.positions) });
+  if (mesh.normals.size() == vertexCount) {
+    contents.blocks.push_back({ MeshFileBlockType::Normals,
+                                float3,
+                                sizeof(Vector3),
+                                vertexCount,
+                                asBytes(mesh.normals) });
+  }
+  if (mesh.uvs.size() == vertexCount) {
+    contents.blocks.push_back({ MeshFileBlockType::UVs,
+                                float2,
+                                sizeof(Vector2),
+                                vertexCount,
+                                asBytes(mesh.uvs) });
+  }
+  contents.blocks.push_back(
+    { MeshFileBlockType::Cells,
+      static_cast<uint32_t>(mtlpp::IndexType::UInt32),
+      sizeof(std::array<uint32_t, 3>),
+      contents.cellCount,
+      asBytes(mesh.cells) });
+
+  writeMeshFile(path, contents);
+}
+
+void
+writeMeshFile(std::filesystem::path const& path, QuantizedMesh const& mesh)
+{
+  auto vertexCount = static_cast<uint32_t>(mesh.positions.size());
+  bool half = mesh.positionQuantization == PositionQuantization::Half;
+  MeshFileContents contents{
+    .vertexCount = vertexCount,
+    .cellCount = static_cast<uint32_t>(mesh.cells.size()),
+  };
+  for (int j = 0; j < 3; j++) {
+    contents.boundsMin[j] = mesh.bounds.min[j];
+    contents.boundsMax[j] = mesh.bounds.min[j] + mesh.bounds.extent[j];
+  }
+
+  contents.blocks.push_back(
+    { MeshFileBlockType::Positions,
+      static_cast<uint32_t>(half ? mtlpp::VertexFormat::Half4
+                                 : mtlpp::VertexFormat::UShort4Normalized),
+      sizeof(QuantizedPosition),
+      vertexCount,
+      asBytes(mesh.positions) });
+  if (mesh.normals.size() == vertexCount) {
+    contents.blocks.push_back(
+      { MeshFileBlockType::Normals,
+        static_cast<uint32_t>(mtlpp::VertexFormat::Short2Normalized),
+        sizeof(uint32_t),
+        vertexCount,
+        asBytes(mesh.normals) });
+  }
+  if (mesh.uvs.size() == vertexCount) {
+    contents.blocks.push_back(
+      { MeshFileBlockType::UVs,
+        static_cast<uint32_t>(mtlpp::VertexFormat::UShort2Normalized),
+        sizeof(uint32_t),
+        vertexCount,
+        asBytes(mesh.uvs) });
+  }
+  contents.blocks.push_back(
+    { MeshFileBlockType::Cells,
+      static_cast<uint32_t>(mtlpp::IndexType::UInt32),
+      sizeof(std::array<uint32_t, 3>),
+      contents.cellCount,
+      asBytes(mesh.cells) });
+
+  writeMeshFile(path, contents);
+}
+
+MeshFile::MeshFile(std::filesystem::path const& path)
+{
+  int descriptor = open(path.c_str(), O_RDONLY);
+  if (descriptor < 0) {
+    throw ErrorMessage("Unable to open the mesh file " + path.string());
+  }
+  struct stat info;
+  if (fstat(descriptor, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(MeshFileHeader)) {
+    close(descriptor);
+    throw ErrorMessage("The mesh file is too small " + path.string());
+  }
+
+  mSize = info.st_size;
+  void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  // The mapping keeps the file alive on its own.
+  close(descriptor);
+  if (data == MAP_FAILED) {
+    throw ErrorMessage("Unable to map the mesh file " + path.string());
+  }
+  mData = static_cast<const uint8_t*>(data);
+  mHeader = reinterpret_cast<MeshFileHeader const*>(mData);
+
+  // Only the header and block table are checked, so that nothing else has to
+  // be read in from disk.
+  bool valid = std::memcmp(mHeader->magic, MESH_FILE_MAGIC, 4) == 0 &&
+               mHeader->version == MESH_FILE_VERSION &&
+               sizeof(MeshFileHeader) +
+                   sizeof(MeshFileBlock) * uint64_t(mHeader->blockCount) <=
+                 mSize;
+  if (valid) {
+    mBlocks = { reinterpret_cast<MeshFileBlock const*>(mHeader + 1),
+                mHeader->blockCount };
+    for (auto const& block : mBlocks) {
+      valid = valid && block.offset % MESH_FILE_ALIGNMENT == 0 &&
+              block.offset <= mSize && block.size <= mSize - block.offset &&
+              block.size == uint64_t(block.stride) * block.count;
+    }
+  }
+  if (!valid) {
+    Unmap();
+    throw ErrorMessage("The mesh file is invalid or from another version " +
+                       path.string());
+  }
+}
+
+MeshFile::MeshFile(MeshFile&& other)
+  : mData(std::exchange(other.mData, nullptr))
+  , mSize(std::exchange(other.mSize, 0))
+  , mHeader(std::exchange(other.mHeader, nullptr))
+  , mBlocks(std::exchange(other.mBlocks, {}))
+{}
+
+MeshFile&
+MeshFile::operator=(MeshFile&& other)
+{
+  if (this != &other) {
+    Unmap();
+    mData = std::exchange(other.mData, nullptr);
+    mSize = std::exchange(other.mSize, 0);
+    mHeader = std::exchange(other.mHeader, nullptr);
+    mBlocks = std::exchange(other.mBlocks, {});
+  }
+  return *this;
+}
+
+MeshFile::~MeshFile()
+{
+  Unmap();
+}
+
+void
+MeshFile::Unmap()
+{
+  if (mData != nullptr) {
+    munmap(const_cast<uint8_t*>(mData), mSize);
+    mData = nullptr;
+    mSize = 0;
+    mHeader = nullptr;
+    mBlocks = {};
+  }
+}
+
+std::optional<MeshFileBlock>
+MeshFile::FindBlock(MeshFileBlockType type) const
+{
+  for (auto const& block : mBlocks) {
+    if (block.type == type) {
+      return block;
+    }
+  }
+  return std::nullopt;
+}
+
+template<typename T>
+std::span<const T>
+MeshFile::GetTypedBlock(MeshFileBlockType type, uint32_t format) const
+{
+  auto block = FindBlock(type);
+  if (!block || block->format != format || block->stride != sizeof(T)) {
+    return {};
+  }
+  return { reinterpret_cast<const T*>(mData + block->offset), block->count };
+}
+
+std::span<const Vector3>
+MeshFile::GetPositions() const
+{
+  return GetTypedBlock<Vector3>(
+    MeshFileBlockType::Positions,
+    static_cast<uint32_t>(mtlpp::VertexFormat::Float3));
+}
+
+std::span<const Vector3>
+MeshFile::GetNormals() const
+{
+  return GetTypedBlock<Vector3>(
+    MeshFileBlockType::Normals,
+    static_cast<uint32_t>(mtlpp::VertexFormat::Float3));
+}
+
+std::span<const Vector2>
+MeshFile::GetUVs() const
+{
+  return GetTypedBlock<Vector2>(
+    MeshFileBlockType::UVs, static_cast<uint32_t>(mtlpp::VertexFormat::Float2));
+}
+
+std::span<const std::array<uint32_t, 3>>
+MeshFile::GetCells() const
+{
+  return GetTypedBlock<std::array<uint32_t, 3>>(
+    MeshFileBlockType::Cells, static_cast<uint32_t>(mtlpp::IndexType::UInt32));
+}
+
+void
+MeshFile::Write(MeshSpans output) const
+{
+  auto positions = GetPositions();
+  auto normals = GetNormals();
+  auto uvs = GetUVs();
+  auto cells = GetCells();
+  ReleaseAssert(positions.size() == GetVertexCount() &&
+                  cells.size() == GetCellCount(),
+                "Only mesh files with float positions and uint32_t cells can "
+                "be written into mesh spans.");
+
+  std::copy(positions.begin(), positions.end(), output.positions.begin());
+  std::copy(cells.begin(), cells.end(), output.cells.begin());
+  // A file without the attribute still fills the span, rather than leaving
+  // whatever the buffer held. Missing normals are computed from the cells.
+  if (!output.normals.empty()) {
+    if (normals.size() == GetVertexCount()) {
+      std::copy(normals.begin(), normals.end(), output.normals.begin());
+    } else {
+      computeAngleNormals(
+        cells, positions, output.normals.first(GetVertexCount()));
+    }
+  }
+  if (!output.uvs.empty()) {
+    if (uvs.size() == GetVertexCount()) {
+      std::copy(uvs.begin(), uvs.end(), output.uvs.begin());
+    } else {
+      std::fill_n(output.uvs.begin(), GetVertexCount(), Vector2{ 0.0f, 0.0f });
+    }
+  }
+}
+
+Mesh
+MeshFile::ToMesh() const
+{
+  auto positions = GetPositions();
+  auto normals = GetNormals();
+  auto uvs = GetUVs();
+  auto cells = GetCells();
+  ReleaseAssert(positions.size() == GetVertexCount() &&
+                  cells.size() == GetCellCount(),
+                "Only mesh files with float positions and uint32_t cells can "
+                "be copied into a Mesh.");
+
+  Mesh mesh{};
+  mesh.positions.assign(positions.begin(), positions.end());
+  mesh.normals.assign(normals.begin(), normals.end());
+  mesh.uvs.assign(uvs.begin(), uvs.end());
+  mesh.cells.assign(cells.begin(), cells.end());
+  return mesh;
+}
+
+} // namespace viz
@@ -0,0 +1,198 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include "viz/geo/quantize.h"
+#include "viz/metal.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * The blocks are aligned to, and padded out to, 16 KB, which is the page size
+ * on Apple silicon, so that every block can be mapped straight into a buffer.
+ */
+static const uint64_t MESH_FILE_ALIGNMENT = 16384;
+
+/**
+ * Bump this whenever the layout of the file changes, so that old files are
+ * rejected rather than misread.
+ */
+static const uint32_t MESH_FILE_VERSION = 1;
+
+/**
+ * Which of the mesh's streams a block holds.
+ */
+enum class MeshFileBlockType : uint32_t
+{
+  Positions = 0,
+  Normals = 1,
+  UVs = 2,
+  Tangents = 3,
+  Cells = 4,
+};
+
+/**
+ * The header at the start of the file, followed directly by the block table.
+ */
+struct MeshFileHeader
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t vertexCount;
+  uint32_t cellCount;
+  // The bounding box of the positions.
+  std::array<float, 3> boundsMin;
+  std::array<float, 3> boundsMax;
+  uint32_t blockCount;
+  uint32_t reserved;
+};
+
+/**
+ * An entry of the block table. The format is an mtlpp::VertexFormat for the
+ * vertex attributes, and an mtlpp::IndexType for the cells.
+ */
+struct MeshFileBlock
+{
+  MeshFileBlockType type;
+  uint32_t format;
+  // The size in bytes of one vertex, or one cell.
+  uint32_t stride;
+  uint32_t count;
+  // From the start of the file, aligned to MESH_FILE_ALIGNMENT.
+  uint64_t offset;
+  // The size of the data, without the padding.
+  uint64_t size;
+};
+
+/**
+ * A block to write, pointing at data that is already in its final format.
+ */
+struct MeshFileBlockData
+{
+  MeshFileBlockType type;
+  uint32_t format;
+  uint32_t stride;
+  uint32_t count;
+  std::span<const uint8_t> data;
+};
+
+struct MeshFileContents
+{
+  uint32_t vertexCount = 0;
+  uint32_t cellCount = 0;
+  std::array<float, 3> boundsMin = { 0, 0, 0 };
+  std::array<float, 3> boundsMax = { 0, 0, 0 };
+  std::vector<MeshFileBlockData> blocks = {};
+};
+
+/**
+ * Write the blocks out as a mesh file. The file is written to a temporary path
+ * and then moved into place, so a reader never sees it half written. Throws an
+ * ErrorMessage when the file can't be written.
+ */
+void
+writeMeshFile(std::filesystem::path const& path,
+              MeshFileContents const& contents);
+
+/**
+ * Write a mesh with its attributes as floats, and its cells as uint32_t. The
+ * normals and uvs are only written when there is one per position.
+ */
+void
+writeMeshFile(std::filesystem::path const& path, Mesh const& mesh);
+
+/**
+ * Write a quantized mesh, with its attributes in the GPU formats from
+ * viz/geo/quantize.h. For Bounds16 positions, the header's bounds are the
+ * quantization bounds, where the extent is boundsMax - boundsMin.
+ */
+void
+writeMeshFile(std::filesystem::path const& path, QuantizedMesh const& mesh);
+
+/**
+ * A read-only mesh file, which is memory mapped rather than read, so that
+ * opening it only costs the header validation, no matter how big the mesh is.
+ * The pages are read in by the OS when the spans are first touched.
+ *
+ * The spans point into the mapping, so they are only valid while the MeshFile
+ * is alive. Opening a file that is missing, truncated, or from another version
+ * throws an ErrorMessage.
+ *
+ * e.g.
+ *
+ * MeshFile file{ "bin/bunny.vizmesh" };
+ * std::span<const Vector3> positions = file.GetPositions();
+ * std::span<const std::array<uint32_t, 3>> cells = file.GetCells();
+ */
+class MeshFile
+{
+public:
+  // Move only
+  MeshFile(MeshFile&& other);
+  MeshFile& operator=(MeshFile&& other);
+  MeshFile(MeshFile const& other) = delete;
+  MeshFile& operator=(MeshFile const& other) = delete;
+
+  explicit MeshFile(std::filesystem::path const& path);
+  ~MeshFile();
+
+  MeshFileHeader const& GetHeader() const { return *mHeader; }
+  uint32_t GetVertexCount() const { return mHeader->vertexCount; }
+  uint32_t GetCellCount() const { return mHeader->cellCount; }
+  MeshCounts GetCounts() const
+  {
+    return { .vertexCount = GetVertexCount(), .cellCount = GetCellCount() };
+  }
+  std::span<const MeshFileBlock> GetBlocks() const { return mBlocks; }
+
+  std::optional<MeshFileBlock> FindBlock(MeshFileBlockType type) const;
+
+  /**
+   * The raw bytes of a block, without the padding.
+   */
+  std::span<const uint8_t> GetBlockData(MeshFileBlock const& block) const
+  {
+    return { mData + block.offset, block.size };
+  }
+
+  /**
+   * The typed streams, when the file stores them in these formats. Each is
+   * empty when the block is missing, or stored in another format.
+   */
+  std::span<const Vector3> GetPositions() const;
+  std::span<const Vector3> GetNormals() const;
+  std::span<const Vector2> GetUVs() const;
+  std::span<const std::array<uint32_t, 3>> GetCells() const;
+
+  /**
+   * Copy the float streams into the output spans, which must be at least as
+   * large as the counts. Like the generators, this skips any empty vertex
+   * attribute span, so it can be handed to MeshBuffers as the generate
+   * function, which uploads the file without building a Mesh. When the file
+   * has no normals they are computed, and missing uvs are written as zeros.
+   */
+  void Write(MeshSpans output) const;
+
+  /**
+   * Copy the float streams out into a Mesh.
+   */
+  Mesh ToMesh() const;
+
+private:
+  template<typename T>
+  std::span<const T> GetTypedBlock(MeshFileBlockType type,
+                                   uint32_t format) const;
+
+  void Unmap();
+
+  const uint8_t* mData = nullptr;
+  size_t mSize = 0;
+  MeshFileHeader const* mHeader = nullptr;
+  std::span<const MeshFileBlock> mBlocks = {};
+};
+
+} // namespace viz
@@ -0,0 +1,21 @@
+#include "viz/geo/mesh.h"
+
+namespace viz {
+
+MeshSpans
+allocateMeshSpans(Mesh& mesh, MeshCounts counts, bool withUvs)
+{
+  mesh.positions.resize(counts.vertexCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  mesh.normals.resize(counts.vertexCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  mesh.uvs.resize(withUvs ? counts.vertexCount : 0, Vector2{ 0.0f, 0.0f });
+  mesh.cells.resize(counts.cellCount);
+
+  return MeshSpans{
+    .positions = mesh.positions,
+    .uvs = mesh.uvs,
+    .normals = mesh.normals,
+    .cells = mesh.cells,
+  };
+}
+
+} // namespace viz
@@ -1,8 +1,11 @@
 #pragma once
 #include "viz/debug.h"
+#include "viz/geo/index-buffer.h"
+#include "viz/geo/vertex-layout.h"
 #include "viz/macros.h"
 #include "viz/math.h"
 #include "viz/metal.h"
+#include <span>
 #include <vector>
 
 namespace viz {
@@ -22,6 +25,36 @@ struct Mesh
   Cells cells = {};
 };
 
+/**
+ * The stream sizes that a generator needs for its output.
+ */
+struct MeshCounts
+{
+  size_t vertexCount = 0;
+  size_t cellCount = 0;
+};
+
+/**
+ * Output streams that a generator can write into directly. These can point into
+ * a Mesh's vectors, or into the contents of GPU buffers, so that the geometry
+ * never has to be copied. Generators skip any vertex attribute whose span is
+ * empty.
+ */
+struct MeshSpans
+{
+  std::span<Vector3> positions = {};
+  std::span<Vector2> uvs = {};
+  std::span<Vector3> normals = {};
+  std::span<std::array<uint32_t, 3>> cells = {};
+};
+
+/**
+ * Size the mesh's streams for the counts, and return spans that point into
+ * them. The uvs are only allocated when they are asked for.
+ */
+MeshSpans
+allocateMeshSpans(Mesh& mesh, MeshCounts counts, bool withUvs = true);
+
 /**
  * Use macros to generate the Debug<Mesh>() definition.
  */
@@ -35,7 +68,11 @@ VIZ_DEBUG_OBJ(mesh, Mesh, {
 });
 
 /**
- * Conveniently create all the buffers needed for a mesh.
+ * Conveniently create all the buffers needed for a mesh. The vertices are laid
+ * out by a VertexLayout, which defaults to getFloat3VertexLayout, so bind
+ * vertices.Refs() and build the pipeline's vertex descriptor from
+ * vertices.table with createVertexDescriptor. The indices are 16 bit for meshes
+ * of at most 65535 vertices, see getIndexType, so draw with indices.indexType.
  */
 class MeshBuffers
 {
@@ -44,18 +81,56 @@ public:
   MeshBuffers(MeshBuffers&& other) = default;
   MeshBuffers& operator=(MeshBuffers&& other) = default;
 
-  MeshBuffers(mtlpp::Device& device, Mesh& mesh, mtlpp::ResourceOptions options)
-    : positions(BufferViewList<Vector3>(mesh.positions, device, options))
-    , cells(
-        BufferViewList<std::array<uint32_t, 3>>(mesh.cells, device, options))
-    , normals(BufferViewList<Vector3>(mesh.normals, device, options))
-    , indexCount(mesh.cells.size() * 3)
+  MeshBuffers(mtlpp::Device& device,
+              const Mesh& mesh,
+              mtlpp::ResourceOptions options)
+    : MeshBuffers(device, mesh, getFloat3VertexLayout(), options)
+  {}
+
+  MeshBuffers(mtlpp::Device& device,
+              const Mesh& mesh,
+              VertexLayout const& layout,
+              mtlpp::ResourceOptions options)
+    : vertices(VertexBuffers(device, mesh, layout, options))
+    , indices(IndexBuffer(device, options, mesh.positions.size(), mesh.cells))
   {}
 
-  BufferViewList<Vector3> positions;
-  BufferViewList<std::array<uint32_t, 3>> cells;
-  BufferViewList<Vector3> normals;
-  uint32_t indexCount;
+  // Generate the mesh directly into the buffers, rather than building it in a
+  // Mesh and copying it over. This uses getFloat3VertexLayout, so that the
+  // positions and normals can be written in place. 16 bit cells are generated
+  // into a temporary list and then narrowed into the buffer. The function
+  // signature is:
+  //
+  // (MeshSpans spans) -> void
+  template<typename Fn>
+  MeshBuffers(mtlpp::Device& device,
+              MeshCounts counts,
+              Fn generate,
+              mtlpp::ResourceOptions options)
+    : vertices(VertexBuffers(
+        device, counts.vertexCount, getFloat3VertexLayout(), options))
+    , indices(
+        IndexBuffer(device, options, counts.vertexCount, counts.cellCount * 3))
+  {
+    MeshSpans spans{
+      .positions = vertices.GetAttributeSpan<Vector3>(
+        VertexAttribute::Position, mtlpp::VertexFormat::Float3),
+      .normals = vertices.GetAttributeSpan<Vector3>(
+        VertexAttribute::Normal, mtlpp::VertexFormat::Float3),
+      .cells = indices.GetUInt32Cells(),
+    };
+    if (!spans.cells.empty() || counts.cellCount == 0) {
+      generate(spans);
+      return;
+    }
+    Cells cells(counts.cellCount);
+    spans.cells = cells;
+    generate(spans);
+    indices.SetIndices(getCellIndices(cells));
+  }
+
+  VertexBuffers vertices;
+  IndexBuffer indices;
 };
 
 }
@@ -0,0 +1,276 @@
+#include "viz/geo/meshlet.h"
+#include "viz/assert.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace viz {
+
+static float
+dot3(simd::float3 a, simd::float3 b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static simd::float3
+toFloat3(Vector3 const& vector)
+{
+  return simd::float3{ vector[0], vector[1], vector[2] };
+}
+
+static simd::float3
+normalize3(simd::float3 vector)
+{
+  float length = std::sqrt(dot3(vector, vector));
+  return length > 0 ? vector * (1.0f / length) : vector;
+}
+
+/**
+ * Ritter's bounding sphere. This starts from the pair of extreme points along
+ * the axes that are furthest apart, and then grows the sphere to contain every
+ * other point. It is within a few percent of the minimal sphere.
+ */
+static void
+computeBoundingSphere(std::span<const uint32_t> vertices,
+                      Positions const& positions,
+                      MeshletBounds& bounds)
+{
+  uint32_t minIndex[3] = { vertices[0], vertices[0], vertices[0] };
+  uint32_t maxIndex[3] = { vertices[0], vertices[0], vertices[0] };
+  for (auto index : vertices) {
+    for (int axis = 0; axis < 3; axis++) {
+      if (positions[index][axis] < positions[minIndex[axis]][axis]) {
+        minIndex[axis] = index;
+      }
+      if (positions[index][axis] > positions[maxIndex[axis]][axis]) {
+        maxIndex[axis] = index;
+      }
+    }
+  }
+
+  float widestSpan = -1;
+  simd::float3 center{};
+  float radius = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    auto a = toFloat3(positions[minIndex[axis]]);
+    auto b = toFloat3(positions[maxIndex[axis]]);
+    auto ab = b - a;
+    float span = dot3(ab, ab);
+    if (span > widestSpan) {
+      widestSpan = span;
+      center = (a + b) * 0.5f;
+      radius = std::sqrt(span) * 0.5f;
+    }
+  }
+
+  for (auto index : vertices) {
+    auto offset = toFloat3(positions[index]) - center;
+    float distance = std::sqrt(dot3(offset, offset));
+    if (distance > radius) {
+      // Grow the sphere just enough to touch the point, keeping the far side
+      // of it in place.
+      float shift = (distance - radius) * 0.5f;
+      center = center + offset * (shift / distance);
+      radius += shift;
+    }
+  }
+
+  bounds.center = center;
+  bounds.radius = radius;
+}
+
+/**
+ * The normal cone follows "Optimizing the Graphics Pipeline with Compute",
+ * Wihlidal 2016, and meshoptimizer. The axis is the average of the cell
+ * normals, and the apex is moved back far enough that every cell's plane is
+ * behind it.
+ */
+static void
+computeNormalCone(std::span<const std::array<uint32_t, 3>> cells,
+                  Positions const& positions,
+                  MeshletBounds& bounds)
+{
+  // Never cull, unless a cone is found below.
+  bounds.coneApex = bounds.center;
+  bounds.coneAxis = simd::float3{ 0.0f, 0.0f, 1.0f };
+  bounds.coneCutoff = 1.0f;
+
+  // Degenerate cells have no normal, and are left as zero.
+  std::vector<simd::float3> normals(cells.size(), simd::float3{ 0, 0, 0 });
+  simd::float3 axis{ 0.0f, 0.0f, 0.0f };
+  for (size_t i = 0; i < cells.size(); i++) {
+    auto const& cell = cells[i];
+    auto a = toFloat3(positions[cell[0]]);
+    auto ab = toFloat3(positions[cell[1]]) - a;
+    auto ac = toFloat3(positions[cell[2]]) - a;
+    normals[i] = normalize3(simd::float3{ ab[1] * ac[2] - ab[2] * ac[1],
+                                          ab[2] * ac[0] - ab[0] * ac[2],
+                                          ab[0] * ac[1] - ab[1] * ac[0] });
+    axis = axis + normals[i];
+  }
+  if (dot3(axis, axis) == 0) {
+    return;
+  }
+  axis = normalize3(axis);
+
+  float minDot = 1.0f;
+  for (auto const& normal : normals) {
+    if (dot3(normal, normal) > 0) {
+      minDot = std::min(minDot, dot3(normal, axis));
+    }
+  }
+  // Cones that are too wide would almost never be culled, and would put the
+  // apex very far away.
+  if (minDot <= 0.1f) {
+    return;
+  }
+
+  float maxT = 0;
+  for (size_t i = 0; i < cells.size(); i++) {
+    auto const& normal = normals[i];
+    if (dot3(normal, normal) > 0) {
+      auto a = toFloat3(positions[cells[i][0]]);
+      float t = dot3(bounds.center - a, normal) / dot3(axis, normal);
+      maxT = std::max(maxT, t);
+    }
+  }
+
+  bounds.coneApex = bounds.center - axis * maxT;
+  bounds.coneAxis = axis;
+  bounds.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+Meshlets
+buildMeshlets(Mesh const& mesh, MeshletOptions options)
+{
+  ReleaseAssert(options.maxVertices >= 3 && options.maxVertices <= 256,
+                "Meshlets must have between 3 and 256 vertices.");
+  ReleaseAssert(options.maxCells >= 1, "Meshlets must have at least 1 cell.");
+
+  Meshlets result{};
+  // The local index of each vertex in the current meshlet, or NO_LOCAL.
+  const uint32_t NO_LOCAL = ~0u;
+  std::vector<uint32_t> localIndices(mesh.positions.size(), NO_LOCAL);
+
+  Meshlet meshlet{};
+  auto finishMeshlet = [&]() {
+    for (uint32_t i = 0; i < meshlet.vertexCount; i++) {
+      localIndices[result.vertices[meshlet.vertexOffset + i]] = NO_LOCAL;
+    }
+    result.meshlets.push_back(meshlet);
+    meshlet = Meshlet{
+      .cellOffset = meshlet.cellOffset + meshlet.cellCount,
+      .vertexOffset = static_cast<uint32_t>(result.vertices.size()),
+      .triangleOffset = static_cast<uint32_t>(result.triangles.size()),
+    };
+  };
+
+  for (auto const& cell : mesh.cells) {
+    uint32_t newVertices = 0;
+    for (int i = 0; i < 3; i++) {
+      ReleaseAssert(cell[i] < mesh.positions.size(),
+                    "A cell index is out of range.");
+      // Degenerate cells can repeat a vertex, which must only count once.
+      bool repeated = (i > 0 && cell[i] == cell[0]) ||
+                      (i > 1 && cell[i] == cell[1]);
+      newVertices += localIndices[cell[i]] == NO_LOCAL && !repeated;
+    }
+    if (meshlet.vertexCount + newVertices > options.maxVertices ||
+        meshlet.cellCount + 1 > options.maxCells) {
+      finishMeshlet();
+    }
+
+    std::array<uint8_t, 3> triangle;
+    for (int i = 0; i < 3; i++) {
+      uint32_t& local = localIndices[cell[i]];
+      if (local == NO_LOCAL) {
+        local = meshlet.vertexCount++;
+        result.vertices.push_back(cell[i]);
+      }
+      triangle[i] = static_cast<uint8_t>(local);
+    }
+    result.triangles.push_back(triangle);
+    meshlet.cellCount++;
+  }
+  if (meshlet.cellCount > 0) {
+    finishMeshlet();
+  }
+
+  ParallelFor(result.meshlets.size(), 16, [&](size_t i) {
+    auto& meshlet = result.meshlets[i];
+    std::span<const uint32_t> vertices{
+      result.vertices.data() + meshlet.vertexOffset, meshlet.vertexCount
+    };
+    std::span<const std::array<uint32_t, 3>> cells{
+      mesh.cells.data() + meshlet.cellOffset, meshlet.cellCount
+    };
+    computeBoundingSphere(vertices, mesh.positions, meshlet.bounds);
+    computeNormalCone(cells, mesh.positions, meshlet.bounds);
+  });
+
+  return result;
+}
+
+std::vector<CellRange>
+cullMeshlets(Meshlets const& meshlets, ModelMatrices const& matrices)
+{
+  // Extract the frustum planes in model space from the rows of the
+  // modelViewProj matrix. Metal's clip space depth is [0, w].
+  auto const& m = matrices.modelViewProj;
+  auto getRow = [&](int row) {
+    return simd::float4{ m.columns[0][row],
+                         m.columns[1][row],
+                         m.columns[2][row],
+                         m.columns[3][row] };
+  };
+  auto x = getRow(0);
+  auto y = getRow(1);
+  auto z = getRow(2);
+  auto w = getRow(3);
+  std::array<simd::float4, 6> planes{ w + x, w - x, w + y, w - y, z, w - z };
+  for (auto& plane : planes) {
+    float length = std::sqrt(
+      plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+    if (length > 0) {
+      plane = plane * (1.0f / length);
+    }
+  }
+
+  // The eye is at the origin of view space.
+  auto eye4 = simd::inverse(matrices.modelView) *
+              simd::float4{ 0.0f, 0.0f, 0.0f, 1.0f };
+  simd::float3 eye{ eye4[0] / eye4[3], eye4[1] / eye4[3], eye4[2] / eye4[3] };
+
+  std::vector<CellRange> ranges{};
+  for (auto const& meshlet : meshlets.meshlets) {
+    auto const& bounds = meshlet.bounds;
+
+    bool visible = true;
+    for (auto const& plane : planes) {
+      float distance = plane[0] * bounds.center[0] +
+                       plane[1] * bounds.center[1] +
+                       plane[2] * bounds.center[2] + plane[3];
+      if (distance < -bounds.radius) {
+        visible = false;
+        break;
+      }
+    }
+    if (visible && bounds.coneCutoff < 1.0f) {
+      auto view = normalize3(bounds.coneApex - eye);
+      visible = dot3(view, bounds.coneAxis) < bounds.coneCutoff;
+    }
+    if (!visible) {
+      continue;
+    }
+
+    if (!ranges.empty() && ranges.back().cellOffset + ranges.back().cellCount ==
+                             meshlet.cellOffset) {
+      ranges.back().cellCount += meshlet.cellCount;
+    } else {
+      ranges.push_back({ meshlet.cellOffset, meshlet.cellCount });
+    }
+  }
+  return ranges;
+}
+
+} // namespace viz
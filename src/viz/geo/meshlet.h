@@ -0,0 +1,84 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include "viz/shader-utils.h"
+#include <array>
+#include <simd/simd.h>
+#include <vector>
+
+namespace viz {
+
+/**
+ * The culling data for a meshlet, in the mesh's model space.
+ */
+struct MeshletBounds
+{
+  simd::float3 center;
+  float radius;
+  // Every cell in the meshlet faces away from a viewer inside the cone
+  // dot(normalize(coneApex - eye), coneAxis) >= coneCutoff. A cutoff of 1 or
+  // more means the cells face too many ways to ever be backface culled.
+  simd::float3 coneApex;
+  simd::float3 coneAxis;
+  float coneCutoff;
+};
+
+/**
+ * A meshlet is a contiguous run of the mesh's cells, so a group of visible
+ * meshlets can be drawn straight from the mesh's index buffer.
+ */
+struct Meshlet
+{
+  // The first cell of the meshlet in Mesh::cells.
+  uint32_t cellOffset;
+  uint32_t cellCount;
+  // The range of Meshlets::vertices that the local indices point into.
+  uint32_t vertexOffset;
+  uint32_t vertexCount;
+  // The range of Meshlets::triangles. There is one triangle per cell.
+  uint32_t triangleOffset;
+  MeshletBounds bounds;
+};
+
+struct Meshlets
+{
+  std::vector<Meshlet> meshlets;
+  // The mesh's vertex indices, for each meshlet in turn.
+  std::vector<uint32_t> vertices;
+  // Indices into the meshlet's own run of vertices.
+  std::vector<std::array<uint8_t, 3>> triangles;
+};
+
+struct MeshletOptions
+{
+  // At most 256, so that local indices fit into a byte.
+  uint32_t maxVertices = 64;
+  uint32_t maxCells = 124;
+};
+
+/**
+ * Greedily split the cells into meshlets, in order. The cells should already be
+ * optimized for the vertex cache, so that each run of cells shares as many
+ * vertices as possible. The bounds are computed in parallel.
+ */
+Meshlets
+buildMeshlets(Mesh const& mesh, MeshletOptions options = {});
+
+/**
+ * A run of cells that should be drawn.
+ */
+struct CellRange
+{
+  uint32_t cellOffset;
+  uint32_t cellCount;
+};
+
+/**
+ * Cull the meshlets against the view frustum of the modelViewProj matrix, and
+ * by their normal cones against the eye position. Visible meshlets that are
+ * next to each other are merged into a single range, so there is one draw call
+ * per range. Use IndexBuffer::GetCellRange to draw them.
+ */
+std::vector<CellRange>
+cullMeshlets(Meshlets const& meshlets, ModelMatrices const& matrices);
+
+} // namespace viz
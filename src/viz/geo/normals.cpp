@@ -0,0 +1,735 @@
+#include "viz/geo/normals.h"
+#include "viz/assert.h"
+#include <cmath>
+
+#if defined(__SSE2__)
+// This has the AVX2 intrinsics too. They are only used from functions that
+// are compiled for AVX2, see computeCellWeightsAvx2.
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// The AVX2 functions are compiled for AVX2 on their own, so that the rest of
+// the file, and the binary, still run on any x86 CPU.
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+namespace viz {
+
+/**
+ * SIMD registers of floats, with one lane per cell, and masks of lanes. The
+ * kernel below is written once against these, and instantiated for each.
+ */
+#if defined(__SSE2__)
+struct Avx2Lanes
+{
+  static constexpr size_t COUNT = 8;
+  using Mask = __m256;
+  __m256 v;
+
+  TARGET_AVX2 static Avx2Lanes Load(const float* values)
+  {
+    return { _mm256_loadu_ps(values) };
+  }
+  TARGET_AVX2 static Avx2Lanes Splat(float value)
+  {
+    return { _mm256_set1_ps(value) };
+  }
+};
+
+TARGET_AVX2 static inline void
+storeLanes(Avx2Lanes a, float* values)
+{
+  _mm256_storeu_ps(values, a.v);
+}
+TARGET_AVX2 static inline Avx2Lanes
+operator+(Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_add_ps(a.v, b.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+operator-(Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_sub_ps(a.v, b.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+operator*(Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_mul_ps(a.v, b.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+operator/(Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_div_ps(a.v, b.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+sqrtLanes(Avx2Lanes a)
+{
+  return { _mm256_sqrt_ps(a.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+rsqrtEstimateLanes(Avx2Lanes a)
+{
+  return { _mm256_rsqrt_ps(a.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+minLanes(Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_min_ps(a.v, b.v) };
+}
+TARGET_AVX2 static inline Avx2Lanes
+maxLanes(Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_max_ps(a.v, b.v) };
+}
+TARGET_AVX2 static inline __m256
+lessLanes(Avx2Lanes a, Avx2Lanes b)
+{
+  return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ);
+}
+TARGET_AVX2 static inline __m256
+orLanes(__m256 a, __m256 b)
+{
+  return _mm256_or_ps(a, b);
+}
+// Pick a where the mask is set, and b elsewhere.
+TARGET_AVX2 static inline Avx2Lanes
+selectLanes(__m256 mask, Avx2Lanes a, Avx2Lanes b)
+{
+  return { _mm256_blendv_ps(b.v, a.v, mask) };
+}
+
+struct SseLanes
+{
+  static constexpr size_t COUNT = 4;
+  using Mask = __m128;
+  __m128 v;
+
+  static SseLanes Load(const float* values) { return { _mm_loadu_ps(values) }; }
+  static SseLanes Splat(float value) { return { _mm_set1_ps(value) }; }
+};
+using DefaultLanes = SseLanes;
+
+static inline void
+storeLanes(SseLanes a, float* values)
+{
+  _mm_storeu_ps(values, a.v);
+}
+static inline SseLanes
+operator+(SseLanes a, SseLanes b)
+{
+  return { _mm_add_ps(a.v, b.v) };
+}
+static inline SseLanes
+operator-(SseLanes a, SseLanes b)
+{
+  return { _mm_sub_ps(a.v, b.v) };
+}
+static inline SseLanes
+operator*(SseLanes a, SseLanes b)
+{
+  return { _mm_mul_ps(a.v, b.v) };
+}
+static inline SseLanes
+operator/(SseLanes a, SseLanes b)
+{
+  return { _mm_div_ps(a.v, b.v) };
+}
+static inline SseLanes
+sqrtLanes(SseLanes a)
+{
+  return { _mm_sqrt_ps(a.v) };
+}
+static inline SseLanes
+rsqrtEstimateLanes(SseLanes a)
+{
+  return { _mm_rsqrt_ps(a.v) };
+}
+static inline SseLanes
+minLanes(SseLanes a, SseLanes b)
+{
+  return { _mm_min_ps(a.v, b.v) };
+}
+static inline SseLanes
+maxLanes(SseLanes a, SseLanes b)
+{
+  return { _mm_max_ps(a.v, b.v) };
+}
+static inline __m128
+lessLanes(SseLanes a, SseLanes b)
+{
+  return _mm_cmplt_ps(a.v, b.v);
+}
+static inline __m128
+orLanes(__m128 a, __m128 b)
+{
+  return _mm_or_ps(a, b);
+}
+static inline SseLanes
+selectLanes(__m128 mask, SseLanes a, SseLanes b)
+{
+  return { _mm_or_ps(_mm_and_ps(mask, a.v), _mm_andnot_ps(mask, b.v)) };
+}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct NeonLanes
+{
+  static constexpr size_t COUNT = 4;
+  using Mask = uint32x4_t;
+  float32x4_t v;
+
+  static NeonLanes Load(const float* values) { return { vld1q_f32(values) }; }
+  static NeonLanes Splat(float value) { return { vdupq_n_f32(value) }; }
+};
+using DefaultLanes = NeonLanes;
+
+static inline void
+storeLanes(NeonLanes a, float* values)
+{
+  vst1q_f32(values, a.v);
+}
+static inline NeonLanes
+operator+(NeonLanes a, NeonLanes b)
+{
+  return { vaddq_f32(a.v, b.v) };
+}
+static inline NeonLanes
+operator-(NeonLanes a, NeonLanes b)
+{
+  return { vsubq_f32(a.v, b.v) };
+}
+static inline NeonLanes
+operator*(NeonLanes a, NeonLanes b)
+{
+  return { vmulq_f32(a.v, b.v) };
+}
+static inline NeonLanes
+operator/(NeonLanes a, NeonLanes b)
+{
+  return { vdivq_f32(a.v, b.v) };
+}
+static inline NeonLanes
+sqrtLanes(NeonLanes a)
+{
+  return { vsqrtq_f32(a.v) };
+}
+// The NEON estimate is only good to 8 bits, so take it as far as the 12 bits
+// of the SSE one here, and let the shared Newton step do the rest.
+static inline NeonLanes
+rsqrtEstimateLanes(NeonLanes a)
+{
+  float32x4_t y = vrsqrteq_f32(a.v);
+  return { vmulq_f32(y, vrsqrtsq_f32(vmulq_f32(a.v, y), y)) };
+}
+static inline NeonLanes
+minLanes(NeonLanes a, NeonLanes b)
+{
+  return { vminq_f32(a.v, b.v) };
+}
+static inline NeonLanes
+maxLanes(NeonLanes a, NeonLanes b)
+{
+  return { vmaxq_f32(a.v, b.v) };
+}
+static inline uint32x4_t
+lessLanes(NeonLanes a, NeonLanes b)
+{
+  return vcltq_f32(a.v, b.v);
+}
+static inline uint32x4_t
+orLanes(uint32x4_t a, uint32x4_t b)
+{
+  return vorrq_u32(a, b);
+}
+static inline NeonLanes
+selectLanes(uint32x4_t mask, NeonLanes a, NeonLanes b)
+{
+  return { vbslq_f32(mask, a.v, b.v) };
+}
+#else
+struct ScalarLanes
+{
+  static constexpr size_t COUNT = 1;
+  using Mask = bool;
+  float v;
+
+  static ScalarLanes Load(const float* values) { return { values[0] }; }
+  static ScalarLanes Splat(float value) { return { value }; }
+};
+using DefaultLanes = ScalarLanes;
+
+static inline void
+storeLanes(ScalarLanes a, float* values)
+{
+  values[0] = a.v;
+}
+static inline ScalarLanes
+operator+(ScalarLanes a, ScalarLanes b)
+{
+  return { a.v + b.v };
+}
+static inline ScalarLanes
+operator-(ScalarLanes a, ScalarLanes b)
+{
+  return { a.v - b.v };
+}
+static inline ScalarLanes
+operator*(ScalarLanes a, ScalarLanes b)
+{
+  return { a.v * b.v };
+}
+static inline ScalarLanes
+operator/(ScalarLanes a, ScalarLanes b)
+{
+  return { a.v / b.v };
+}
+static inline ScalarLanes
+sqrtLanes(ScalarLanes a)
+{
+  return { std::sqrt(a.v) };
+}
+static inline ScalarLanes
+rsqrtEstimateLanes(ScalarLanes a)
+{
+  return { 1.0f / std::sqrt(a.v) };
+}
+static inline ScalarLanes
+minLanes(ScalarLanes a, ScalarLanes b)
+{
+  return { a.v < b.v ? a.v : b.v };
+}
+static inline ScalarLanes
+maxLanes(ScalarLanes a, ScalarLanes b)
+{
+  return { a.v > b.v ? a.v : b.v };
+}
+static inline bool
+lessLanes(ScalarLanes a, ScalarLanes b)
+{
+  return a.v < b.v;
+}
+static inline bool
+orLanes(bool a, bool b)
+{
+  return a || b;
+}
+static inline ScalarLanes
+selectLanes(bool mask, ScalarLanes a, ScalarLanes b)
+{
+  return mask ? a : b;
+}
+#endif
+
+/**
+ * 1 / sqrt(a), from the hardware estimate and one Newton-Raphson step, which
+ * is good to about 22 bits.
+ */
+template<typename Lanes>
+static inline Lanes
+rsqrtLanes(Lanes a)
+{
+  Lanes y = rsqrtEstimateLanes(a);
+  return y * (Lanes::Splat(1.5f) - Lanes::Splat(0.5f) * a * y * y);
+}
+
+/**
+ * atan2(y, x) for y >= 0, which is all that a corner angle needs. The range is
+ * folded into [0, 1] and evaluated with an odd minimax polynomial, which has
+ * an error of at most 2e-6 radians.
+ */
+template<typename Lanes>
+static inline Lanes
+atan2Lanes(Lanes y, Lanes x)
+{
+  Lanes zero = Lanes::Splat(0.0f);
+  Lanes absX = maxLanes(x, zero - x);
+  Lanes low = minLanes(absX, y);
+  Lanes high = maxLanes(absX, y);
+  Lanes a = selectLanes(lessLanes(zero, high), low / high, zero);
+
+  Lanes a2 = a * a;
+  Lanes p = Lanes::Splat(-0.01172120f);
+  p = p * a2 + Lanes::Splat(0.05265332f);
+  p = p * a2 + Lanes::Splat(-0.11643287f);
+  p = p * a2 + Lanes::Splat(0.19354346f);
+  p = p * a2 + Lanes::Splat(-0.33262347f);
+  p = p * a2 + Lanes::Splat(0.99997726f);
+  p = p * a;
+
+  p = selectLanes(lessLanes(absX, y), Lanes::Splat(M_PI_2) - p, p);
+  return selectLanes(lessLanes(x, zero), Lanes::Splat(M_PI) - p, p);
+}
+
+// ComputeAngleNormalsPacked compares the float edge lengths against the double
+// 0.000001. This is the smallest float that is not below it, so comparing
+// against it in floats gives the same answers.
+static const float MIN_EDGE_LENGTH = []() {
+  float length = 0.000001;
+  return length < 0.000001 ? std::nextafter(length, 1.0f) : length;
+}();
+
+/**
+ * Compute the weights of the cells cellAt(i) for i in [begin, end), one
+ * register of lanes at a time. The exact version follows
+ * ComputeAngleNormalsPacked operation for operation, apart from atan2, which is
+ * computed one lane at a time.
+ */
+template<typename Lanes, bool Approximate, typename CellAt>
+static void
+computeCellWeights(std::span<const uint32_t> cells,
+                   std::span<const float> positions,
+                   std::span<AngleWeightedCell<float>> weighted,
+                   size_t begin,
+                   size_t end,
+                   CellAt cellAt)
+{
+  // The corner positions of a batch of cells, transposed so that each
+  // component of each corner can be loaded as one register.
+  alignas(32) float input[9][Lanes::COUNT];
+  // The normal, and the y and then x arguments of each weight's atan2.
+  alignas(32) float output[7][Lanes::COUNT];
+
+  for (size_t first = begin; first < end; first += Lanes::COUNT) {
+    size_t count = std::min(Lanes::COUNT, end - first);
+    for (size_t lane = 0; lane < Lanes::COUNT; lane++) {
+      // A partial batch repeats its last cell, rather than reading past the
+      // end.
+      size_t cell = cellAt(first + std::min(lane, count - 1));
+      for (size_t corner = 0; corner < 3; corner++) {
+        const float* position = &positions[cells[cell * 3 + corner] * 3];
+        input[corner * 3][lane] = position[0];
+        input[corner * 3 + 1][lane] = position[1];
+        input[corner * 3 + 2][lane] = position[2];
+      }
+    }
+
+    Lanes ax = Lanes::Load(input[0]);
+    Lanes ay = Lanes::Load(input[1]);
+    Lanes az = Lanes::Load(input[2]);
+    Lanes bx = Lanes::Load(input[3]);
+    Lanes by = Lanes::Load(input[4]);
+    Lanes bz = Lanes::Load(input[5]);
+    Lanes cx = Lanes::Load(input[6]);
+    Lanes cy = Lanes::Load(input[7]);
+    Lanes cz = Lanes::Load(input[8]);
+    Lanes zero = Lanes::Splat(0.0f);
+
+    Lanes abx = bx - ax;
+    Lanes aby = by - ay;
+    Lanes abz = bz - az;
+    Lanes bcx = bx - cx;
+    Lanes bcy = by - cy;
+    Lanes bcz = bz - cz;
+    Lanes cax = cx - ax;
+    Lanes cay = cy - ay;
+    Lanes caz = cz - az;
+    Lanes ab2 = abx * abx + aby * aby + abz * abz;
+    Lanes bc2 = bcx * bcx + bcy * bcy + bcz * bcz;
+    Lanes ca2 = cax * cax + cay * cay + caz * caz;
+
+    Lanes nx = aby * bcz - abz * bcy;
+    Lanes ny = abz * bcx - abx * bcz;
+    Lanes nz = abx * bcy - aby * bcx;
+    Lanes nl2 = nx * nx + ny * ny + nz * nz;
+
+    typename Lanes::Mask degenerate;
+    if constexpr (Approximate) {
+      // Rather than Heron's formula, take each corner's angle from the cross
+      // and dot products of its edges, which needs no edge lengths, and
+      // doesn't cancel badly on thin cells. The cross product's length is the
+      // same for every corner. The angles are halved to match the scale of
+      // the exact weights.
+      Lanes minLength = Lanes::Splat(MIN_EDGE_LENGTH * MIN_EDGE_LENGTH);
+      Lanes minLength2 = minLanes(minLanes(ab2, bc2), ca2);
+      degenerate = orLanes(lessLanes(minLength2, minLength),
+                           lessLanes(nl2, minLength * minLength));
+      Lanes inverseLength = rsqrtLanes(nl2);
+      Lanes nl = nl2 * inverseLength;
+      nx = nx * inverseLength;
+      ny = ny * inverseLength;
+      nz = nz * inverseLength;
+
+      Lanes half = Lanes::Splat(0.5f);
+      Lanes dotA = abx * cax + aby * cay + abz * caz;
+      Lanes dotB = abx * bcx + aby * bcy + abz * bcz;
+      Lanes dotC = zero - (cax * bcx + cay * bcy + caz * bcz);
+      Lanes w0 = half * atan2Lanes(nl, dotA);
+      Lanes w1 = half * atan2Lanes(nl, dotB);
+      Lanes w2 = half * atan2Lanes(nl, dotC);
+      storeLanes(selectLanes(degenerate, zero, w0), output[3]);
+      storeLanes(selectLanes(degenerate, zero, w1), output[4]);
+      storeLanes(selectLanes(degenerate, zero, w2), output[5]);
+    } else {
+      Lanes ab = sqrtLanes(ab2);
+      Lanes bc = sqrtLanes(bc2);
+      Lanes ca = sqrtLanes(ca2);
+      degenerate = lessLanes(minLanes(minLanes(ab, bc), ca),
+                             Lanes::Splat(MIN_EDGE_LENGTH));
+      Lanes s = Lanes::Splat(0.5f) * (ab + bc + ca);
+      Lanes r = sqrtLanes((s - ab) * (s - bc) * (s - ca) / s);
+      Lanes nl = sqrtLanes(nl2);
+      nx = nx / nl;
+      ny = ny / nl;
+      nz = nz / nl;
+      // Degenerate cells get atan2(0, 1), which is a weight of 0.
+      Lanes one = Lanes::Splat(1.0f);
+      storeLanes(selectLanes(degenerate, zero, r), output[3]);
+      storeLanes(selectLanes(degenerate, one, s - bc), output[4]);
+      storeLanes(selectLanes(degenerate, one, s - ca), output[5]);
+      storeLanes(selectLanes(degenerate, one, s - ab), output[6]);
+    }
+    storeLanes(selectLanes(degenerate, zero, nx), output[0]);
+    storeLanes(selectLanes(degenerate, zero, ny), output[1]);
+    storeLanes(selectLanes(degenerate, zero, nz), output[2]);
+
+    for (size_t lane = 0; lane < count; lane++) {
+      auto& cell = weighted[cellAt(first + lane)];
+      cell.normal = { output[0][lane], output[1][lane], output[2][lane] };
+      if constexpr (Approximate) {
+        cell.weights = { output[3][lane], output[4][lane], output[5][lane] };
+      } else {
+        float r = output[3][lane];
+        cell.weights = { static_cast<float>(atan2(r, output[4][lane])),
+                         static_cast<float>(atan2(r, output[5][lane])),
+                         static_cast<float>(atan2(r, output[6][lane])) };
+      }
+    }
+  }
+}
+
+#if defined(__SSE2__)
+/**
+ * The AVX2 kernel. Everything that it calls is inlined into it, so that the
+ * lanes never leave AVX2 code.
+ */
+template<bool Approximate, typename CellAt>
+TARGET_AVX2 __attribute__((flatten)) static void
+computeCellWeightsAvx2(std::span<const uint32_t> cells,
+                       std::span<const float> positions,
+                       std::span<AngleWeightedCell<float>> weighted,
+                       size_t begin,
+                       size_t end,
+                       CellAt cellAt)
+{
+  computeCellWeights<Avx2Lanes, Approximate>(
+    cells, positions, weighted, begin, end, cellAt);
+}
+
+static bool
+hasAvx2()
+{
+  static const bool supported = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+  }();
+  return supported;
+}
+#endif
+
+/**
+ * Compute the weights of the cells cellAt(i) for i in [begin, end), with the
+ * widest kernel that the CPU runs.
+ */
+template<bool Approximate, typename CellAt>
+static void
+computeCellWeights(std::span<const uint32_t> cells,
+                   std::span<const float> positions,
+                   std::span<AngleWeightedCell<float>> weighted,
+                   size_t begin,
+                   size_t end,
+                   CellAt cellAt)
+{
+#if defined(__SSE2__)
+  if (hasAvx2()) {
+    computeCellWeightsAvx2<Approximate>(
+      cells, positions, weighted, begin, end, cellAt);
+    return;
+  }
+#endif
+  computeCellWeights<DefaultLanes, Approximate>(
+    cells, positions, weighted, begin, end, cellAt);
+}
+
+/**
+ * Compute the weights of cellAt(i) for every i in [0, count), in parallel.
+ */
+template<typename CellAt>
+static void
+computeCellWeights(std::span<const uint32_t> cells,
+                   std::span<const float> positions,
+                   std::span<AngleWeightedCell<float>> weighted,
+                   AngleNormalsOptions options,
+                   size_t count,
+                   CellAt cellAt)
+{
+  const size_t chunkSize = 4096;
+  size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+  ParallelFor(chunkCount, 1, [&](size_t chunk) {
+    size_t begin = chunk * chunkSize;
+    size_t end = std::min(count, begin + chunkSize);
+    if (options.approximate) {
+      computeCellWeights<true>(
+        cells, positions, weighted, begin, end, cellAt);
+    } else {
+      computeCellWeights<false>(
+        cells, positions, weighted, begin, end, cellAt);
+    }
+  });
+}
+
+// Vector3 is 3 packed floats, and a cell is 3 packed indices, so the packed
+// functions can work on the mesh's memory directly.
+static std::span<const uint32_t>
+getPackedCells(std::span<const std::array<uint32_t, 3>> cells)
+{
+  return { cells.empty() ? nullptr : cells[0].data(), cells.size() * 3 };
+}
+
+static std::span<const float>
+getPackedPositions(std::span<const Vector3> positions)
+{
+  return { positions.empty() ? nullptr : positions[0].v,
+           positions.size() * 3 };
+}
+
+void
+computeAngleNormals(std::span<const std::array<uint32_t, 3>> cells,
+                    std::span<const Vector3> positions,
+                    std::span<Vector3> normals,
+                    AngleNormalsOptions options)
+{
+  ReleaseAssert(normals.size() == positions.size(),
+                "There must be one normal per position.");
+  if (positions.empty()) {
+    return;
+  }
+
+  std::vector<AngleWeightedCell<float>> weighted(cells.size());
+  computeCellWeights(getPackedCells(cells),
+                     getPackedPositions(positions),
+                     weighted,
+                     options,
+                     cells.size(),
+                     [](size_t i) { return i; });
+
+  auto vertexCorners = buildVertexCorners(cells, positions.size());
+  ParallelFor(positions.size(), 4096, [&](size_t vertex) {
+    gatherAngleNormal<float>(
+      vertexCorners, weighted, vertex, normals[vertex].v);
+  });
+}
+
+void
+computeAngleNormals(Mesh& mesh, AngleNormalsOptions options)
+{
+  mesh.normals.resize(mesh.positions.size(), Vector3{ 0.0f, 0.0f, 0.0f });
+  computeAngleNormals(mesh.cells, mesh.positions, mesh.normals, options);
+}
+
+IncrementalNormals::IncrementalNormals(
+  std::span<const std::array<uint32_t, 3>> cells,
+  size_t vertexCount,
+  AngleNormalsOptions options)
+  : mCells(cells.begin(), cells.end())
+  , mVertexCorners(buildVertexCorners(cells, vertexCount))
+  , mWeighted(cells.size())
+  , mOptions(options)
+  , mCellStamps(cells.size(), 0)
+  , mVertexStamps(vertexCount, 0)
+{}
+
+IncrementalNormals::IncrementalNormals(Mesh const& mesh,
+                                       AngleNormalsOptions options)
+  : IncrementalNormals(mesh.cells, mesh.positions.size(), options)
+{}
+
+void
+IncrementalNormals::NextStamp()
+{
+  mStamp++;
+  if (mStamp == 0) {
+    // The stamps wrapped around, so clear out the old ones.
+    std::fill(mCellStamps.begin(), mCellStamps.end(), 0);
+    std::fill(mVertexStamps.begin(), mVertexStamps.end(), 0);
+    mStamp = 1;
+  }
+}
+
+void
+IncrementalNormals::Compute(std::span<const Vector3> positions,
+                            std::span<Vector3> normals)
+{
+  size_t vertexCount = mVertexStamps.size();
+  ReleaseAssert(positions.size() == vertexCount &&
+                  normals.size() == vertexCount,
+                "There must be one position and normal per vertex.");
+  if (vertexCount == 0) {
+    return;
+  }
+
+  computeCellWeights(getPackedCells(mCells),
+                     getPackedPositions(positions),
+                     mWeighted,
+                     mOptions,
+                     mCells.size(),
+                     [](size_t i) { return i; });
+
+  ParallelFor(vertexCount, 4096, [&](size_t vertex) {
+    gatherAngleNormal<float>(
+      mVertexCorners, mWeighted, vertex, normals[vertex].v);
+  });
+}
+
+void
+IncrementalNormals::Update(std::span<const Vector3> positions,
+                           std::span<const uint32_t> movedVertices,
+                           std::span<Vector3> normals)
+{
+  size_t vertexCount = mVertexStamps.size();
+  ReleaseAssert(positions.size() == vertexCount &&
+                  normals.size() == vertexCount,
+                "There must be one position and normal per vertex.");
+
+  // Every cell around a moved vertex changes shape.
+  NextStamp();
+  mDirtyCells.clear();
+  for (auto vertex : movedVertices) {
+    ReleaseAssert(vertex < vertexCount, "A moved vertex is out of bounds.");
+    for (auto corner : mVertexCorners.Get(vertex)) {
+      uint32_t cell = corner / 3;
+      if (mCellStamps[cell] != mStamp) {
+        mCellStamps[cell] = mStamp;
+        mDirtyCells.push_back(cell);
+      }
+    }
+  }
+  if (mDirtyCells.empty()) {
+    return;
+  }
+
+  computeCellWeights(getPackedCells(mCells),
+                     getPackedPositions(positions),
+                     mWeighted,
+                     mOptions,
+                     mDirtyCells.size(),
+                     [&](size_t i) { return mDirtyCells[i]; });
+
+  // Which in turn changes the normal of every vertex of those cells, which is
+  // the one ring around the moved vertices.
+  mDirtyVertices.clear();
+  for (auto cell : mDirtyCells) {
+    for (auto vertex : mCells[cell]) {
+      if (mVertexStamps[vertex] != mStamp) {
+        mVertexStamps[vertex] = mStamp;
+        mDirtyVertices.push_back(vertex);
+      }
+    }
+  }
+
+  ParallelFor(mDirtyVertices.size(), 4096, [&](size_t i) {
+    uint32_t vertex = mDirtyVertices[i];
+    gatherAngleNormal<float>(
+      mVertexCorners, mWeighted, vertex, normals[vertex].v);
+  });
+}
+
+} // namespace viz
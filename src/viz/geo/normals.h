@@ -0,0 +1,262 @@
+#pragma once
+#include "viz/geo/adjacency.h"
+#include "viz/geo/mesh.h"
+#include "viz/parallel.h"
+#include <array>
+#include <cmath>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * A cell's unit normal, and the angle of each of its corners.
+ */
+template<typename Decimal>
+struct AngleWeightedCell
+{
+  std::array<Decimal, 3> normal;
+  std::array<Decimal, 3> weights;
+};
+
+/**
+ * Sum the weighted cell normals around a single vertex, and normalize them
+ * into the 3 values of its normal.
+ */
+template<typename Value>
+inline void
+gatherAngleNormal(VertexCorners const& vertexCorners,
+                  std::span<const AngleWeightedCell<Value>> weighted,
+                  size_t vertex,
+                  Value* normal)
+{
+  Value x = 0.0;
+  Value y = 0.0;
+  Value z = 0.0;
+  for (uint32_t i = vertexCorners.offsets[vertex];
+       i < vertexCorners.offsets[vertex + 1];
+       i++) {
+    uint32_t corner = vertexCorners.corners[i];
+    auto const& cell = weighted[corner / 3];
+    Value w = cell.weights[corner % 3];
+    x += w * cell.normal[0];
+    y += w * cell.normal[1];
+    z += w * cell.normal[2];
+  }
+
+  auto l = sqrt(x * x + y * y + z * z);
+  if (l < 0.00000008) {
+    normal[0] = 1;
+    normal[1] = 0;
+    normal[2] = 0;
+    return;
+  }
+  normal[0] = x / l;
+  normal[1] = y / l;
+  normal[2] = z / l;
+}
+
+/**
+ * Sum the weighted cell normals around every vertex, and normalize them. The
+ * normals are packed, with 3 values per vertex.
+ */
+template<typename Value, typename Integer>
+void
+gatherAngleNormals(std::span<Integer> cells,
+                   std::span<const AngleWeightedCell<Value>> weighted,
+                   std::span<Value> normals)
+{
+  size_t vertexCount = normals.size() / 3;
+  auto vertexCorners = buildVertexCorners(cells, vertexCount);
+
+  ParallelFor(vertexCount, 4096, [&](size_t vertex) {
+    gatherAngleNormal(vertexCorners, weighted, vertex, &normals[vertex * 3]);
+  });
+}
+
+/**
+ * The parallel version of ComputeAngleNormalsPacked from viz/math.h, which
+ * writes into the normals rather than allocating them.
+ *
+ * The cell weights are computed first, and then every vertex gathers from the
+ * cells around it, so that the work splits across threads without any shared
+ * writes. Each vertex sums its cells in the same order that the scatter does,
+ * with the same arithmetic, so the result is bit for bit the same, no matter
+ * how many threads there are.
+ */
+template<typename Decimal, typename Integer>
+void
+computeAngleNormalsPackedParallel(
+  std::span<Integer> cells,
+  std::span<Decimal> positions,
+  std::span<std::remove_const_t<Decimal>> normals)
+{
+  using Value = std::remove_const_t<Decimal>;
+  size_t cellCount = cells.size() / 3;
+
+  std::vector<AngleWeightedCell<Value>> weighted(cellCount);
+  ParallelFor(cellCount, 4096, [&](size_t cellIndex) {
+    size_t aIdx = cells[cellIndex * 3] * 3;
+    size_t bIdx = cells[cellIndex * 3 + 1] * 3;
+    size_t cIdx = cells[cellIndex * 3 + 2] * 3;
+
+    // This is kept operation for operation the same as
+    // ComputeAngleNormalsPacked, down to the double precision constants.
+    Value abx = positions[bIdx] - positions[aIdx];
+    Value aby = positions[bIdx + 1] - positions[aIdx + 1];
+    Value abz = positions[bIdx + 2] - positions[aIdx + 2];
+    Value ab = sqrt(abx * abx + aby * aby + abz * abz);
+
+    Value bcx = positions[bIdx] - positions[cIdx];
+    Value bcy = positions[bIdx + 1] - positions[cIdx + 1];
+    Value bcz = positions[bIdx + 2] - positions[cIdx + 2];
+    Value bc = sqrt(bcx * bcx + bcy * bcy + bcz * bcz);
+
+    Value cax = positions[cIdx] - positions[aIdx];
+    Value cay = positions[cIdx + 1] - positions[aIdx + 1];
+    Value caz = positions[cIdx + 2] - positions[aIdx + 2];
+    Value ca = sqrt(cax * cax + cay * cay + caz * caz);
+
+    // Degenerate cells add nothing. Adding a zero to the +0 that every sum
+    // starts from never changes it, so they don't need to be skipped later.
+    auto& cell = weighted[cellIndex];
+    if (std::min(std::min(ab, bc), ca) < 0.000001) {
+      cell = { { 0, 0, 0 }, { 0, 0, 0 } };
+      return;
+    }
+
+    Value s = 0.5 * (ab + bc + ca);
+    Value r = sqrt((s - ab) * (s - bc) * (s - ca) / s);
+
+    Value nx = aby * bcz - abz * bcy;
+    Value ny = abz * bcx - abx * bcz;
+    Value nz = abx * bcy - aby * bcx;
+    Value nl = sqrt(nx * nx + ny * ny + nz * nz);
+    nx /= nl;
+    ny /= nl;
+    nz /= nl;
+
+    cell.normal = { nx, ny, nz };
+    cell.weights = { static_cast<Value>(atan2(r, s - bc)),
+                     static_cast<Value>(atan2(r, s - ca)),
+                     static_cast<Value>(atan2(r, s - ab)) };
+  });
+
+  gatherAngleNormals<Value, Integer>(cells, weighted, normals);
+}
+
+template<typename Decimal, typename Integer>
+std::vector<std::remove_const_t<Decimal>>
+computeAngleNormalsPackedParallel(std::span<Integer> cells,
+                                  std::span<Decimal> positions)
+{
+  std::vector<std::remove_const_t<Decimal>> normals(positions.size(), 0.0);
+  computeAngleNormalsPackedParallel<Decimal, Integer>(
+    cells, positions, normals);
+  return normals;
+}
+
+struct AngleNormalsOptions
+{
+  /**
+   * Take the corner angles from a polynomial atan2 of the cross and dot
+   * products, with a refined reciprocal square root estimate, in place of
+   * Heron's formula and the exact functions. This is for normals that only
+   * drive shading. The angles are within 2e-6 radians, which keeps smooth
+   * meshes like the bunny within 0.0001 degrees of the exact normals. Vertices
+   * where the cells nearly cancel each other out, on very noisy meshes, can
+   * move by up to about 0.05 degrees.
+   */
+  bool approximate = false;
+};
+
+/**
+ * Angle weighted vertex normals, computed in parallel. The normals must have
+ * one entry per position.
+ *
+ * The cell weights are computed by a SIMD kernel, which works on 8 cells at a
+ * time on x86 CPUs with AVX2, which is checked at runtime, 4 with SSE or NEON,
+ * and otherwise 1. In the exact mode it follows the same arithmetic as
+ * ComputeAngleNormalsPacked. The results only differ where the compiler fuses
+ * the scalar version's multiply adds, which can move the last bit.
+ */
+void
+computeAngleNormals(std::span<const std::array<uint32_t, 3>> cells,
+                    std::span<const Vector3> positions,
+                    std::span<Vector3> normals,
+                    AngleNormalsOptions options = {});
+
+/**
+ * Replace the mesh's normals with angle weighted vertex normals.
+ */
+void
+computeAngleNormals(Mesh& mesh, AngleNormalsOptions options = {});
+
+/**
+ * Angle weighted normals for a mesh whose vertices move, but whose cells stay
+ * the same. The weighted normal of every cell is kept around, so that when
+ * only some of the vertices move, only the cells that touch them, and the
+ * normals of those cells' vertices, are recomputed. The cost of an update
+ * depends on how much of the mesh moved, rather than on its size. The
+ * normals match what computeAngleNormals gives for the same positions.
+ *
+ * e.g. Displace part of a surface every frame:
+ *
+ * IncrementalNormals incrementalNormals{ mesh };
+ * incrementalNormals.Compute(mesh.positions, mesh.normals);
+ *
+ * // Then for each frame:
+ * for (auto vertex : displacedVertices) {
+ *   mesh.positions[vertex] = ...;
+ * }
+ * incrementalNormals.Update(mesh.positions, displacedVertices, mesh.normals);
+ */
+class IncrementalNormals
+{
+public:
+  // Move only
+  IncrementalNormals(IncrementalNormals&& other) = default;
+  IncrementalNormals& operator=(IncrementalNormals&& other) = default;
+
+  IncrementalNormals(std::span<const std::array<uint32_t, 3>> cells,
+                     size_t vertexCount,
+                     AngleNormalsOptions options = {});
+
+  explicit IncrementalNormals(Mesh const& mesh,
+                              AngleNormalsOptions options = {});
+
+  /**
+   * Recompute every cell, and write every normal.
+   */
+  void Compute(std::span<const Vector3> positions, std::span<Vector3> normals);
+
+  /**
+   * Recompute the cells around the moved vertices, and write the normals of
+   * every vertex of those cells. Every other normal is left as it was. The
+   * same vertex can be listed more than once.
+   */
+  void Update(std::span<const Vector3> positions,
+              std::span<const uint32_t> movedVertices,
+              std::span<Vector3> normals);
+
+private:
+  /**
+   * Start a new set of stamps, which marks every cell and vertex as unvisited.
+   */
+  void NextStamp();
+
+  Cells mCells;
+  VertexCorners mVertexCorners;
+  std::vector<AngleWeightedCell<float>> mWeighted;
+  AngleNormalsOptions mOptions;
+
+  // The cells and vertices that an update touches, along with the stamp of
+  // the last update that added each of them, so that they're only added once.
+  std::vector<uint32_t> mCellStamps;
+  std::vector<uint32_t> mVertexStamps;
+  uint32_t mStamp = 0;
+  std::vector<uint32_t> mDirtyCells;
+  std::vector<uint32_t> mDirtyVertices;
+};
+
+} // namespace viz
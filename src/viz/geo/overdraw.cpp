@@ -0,0 +1,322 @@
+#include "viz/geo/overdraw.h"
+#include "viz/assert.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric> // std::iota
+#include <vector>
+
+namespace viz {
+
+/**
+ * A FIFO post-transform cache simulation, that can be reset in constant time.
+ */
+struct FifoCache
+{
+  std::vector<uint32_t> timestamps;
+  uint32_t size;
+  uint32_t time;
+
+  FifoCache(size_t vertexCount, uint32_t size)
+    : timestamps(vertexCount, 0)
+    , size(size)
+    , time(size + 1)
+  {}
+
+  void Reset() { time += size + 1; }
+
+  // Returns how many of the cell's vertices missed the cache.
+  uint32_t Push(std::array<uint32_t, 3> const& cell)
+  {
+    uint32_t misses = 0;
+    for (auto index : cell) {
+      if (time - timestamps[index] > size) {
+        timestamps[index] = time++;
+        misses++;
+      }
+    }
+    return misses;
+  }
+};
+
+/**
+ * The area weighted centroid and normal of a range of cells.
+ */
+struct ClusterShape
+{
+  std::array<double, 3> centroid;
+  std::array<double, 3> normal;
+  double area;
+};
+
+static ClusterShape
+getClusterShape(std::span<const std::array<uint32_t, 3>> cells,
+                std::span<const Vector3> positions)
+{
+  ClusterShape shape{};
+  for (auto const& cell : cells) {
+    auto const& a = positions[cell[0]];
+    auto const& b = positions[cell[1]];
+    auto const& c = positions[cell[2]];
+    std::array<double, 3> ab{ b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    std::array<double, 3> ac{ c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    std::array<double, 3> cross{ ab[1] * ac[2] - ab[2] * ac[1],
+                                 ab[2] * ac[0] - ab[0] * ac[2],
+                                 ab[0] * ac[1] - ab[1] * ac[0] };
+    double area = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] +
+                            cross[2] * cross[2]);
+
+    for (int i = 0; i < 3; i++) {
+      shape.centroid[i] += area * (a[i] + b[i] + c[i]) / 3.0;
+      shape.normal[i] += cross[i];
+    }
+    shape.area += area;
+  }
+
+  if (shape.area > 0) {
+    for (int i = 0; i < 3; i++) {
+      shape.centroid[i] /= shape.area;
+    }
+  }
+  double length = std::sqrt(shape.normal[0] * shape.normal[0] +
+                            shape.normal[1] * shape.normal[1] +
+                            shape.normal[2] * shape.normal[2]);
+  if (length > 0) {
+    for (int i = 0; i < 3; i++) {
+      shape.normal[i] /= length;
+    }
+  }
+  return shape;
+}
+
+/**
+ * Split the cells into clusters, and return the index of the first cell of each
+ * cluster. Hard boundaries are where the vertex cache order starts over, with a
+ * cell that misses on every vertex. Each of those is then split again wherever
+ * the running ACMR has dropped to within the threshold of the whole range.
+ */
+static std::vector<size_t>
+splitClusters(std::span<const std::array<uint32_t, 3>> cells,
+              size_t vertexCount,
+              float threshold,
+              uint32_t cacheSize)
+{
+  FifoCache cache(vertexCount, cacheSize);
+  std::vector<size_t> hardBoundaries{};
+  for (size_t i = 0; i < cells.size(); i++) {
+    if (cache.Push(cells[i]) == 3 || i == 0) {
+      hardBoundaries.push_back(i);
+    }
+  }
+  hardBoundaries.push_back(cells.size());
+
+  std::vector<size_t> boundaries{};
+  for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+    size_t start = hardBoundaries[h];
+    size_t end = hardBoundaries[h + 1];
+
+    cache.Reset();
+    size_t rangeMisses = 0;
+    for (size_t i = start; i < end; i++) {
+      rangeMisses += cache.Push(cells[i]);
+    }
+    double targetAcmr =
+      threshold * static_cast<double>(rangeMisses) / (end - start);
+
+    cache.Reset();
+    boundaries.push_back(start);
+    size_t runningMisses = 0;
+    size_t runningCells = 0;
+    for (size_t i = start; i + 1 < end; i++) {
+      runningMisses += cache.Push(cells[i]);
+      runningCells++;
+      if (runningMisses <= targetAcmr * runningCells) {
+        boundaries.push_back(i + 1);
+        cache.Reset();
+        runningMisses = 0;
+        runningCells = 0;
+      }
+    }
+  }
+  boundaries.push_back(cells.size());
+  return boundaries;
+}
+
+void
+optimizeOverdraw(std::span<const std::array<uint32_t, 3>> input,
+                 std::span<std::array<uint32_t, 3>> output,
+                 std::span<const Vector3> positions,
+                 float threshold,
+                 uint32_t cacheSize)
+{
+  ReleaseAssert(input.size() == output.size(),
+                "The overdraw output must be the same size as the input.");
+  ReleaseAssert(threshold >= 1.0f,
+                "The overdraw threshold must be at least 1.");
+  if (input.empty()) {
+    return;
+  }
+
+  auto boundaries =
+    splitClusters(input, positions.size(), threshold, cacheSize);
+  size_t clusterCount = boundaries.size() - 1;
+
+  auto meshShape = getClusterShape(input, positions);
+  std::vector<double> sortKeys(clusterCount);
+  ParallelFor(clusterCount, 64, [&](size_t i) {
+    auto shape = getClusterShape(
+      input.subspan(boundaries[i], boundaries[i + 1] - boundaries[i]),
+      positions);
+    // Clusters that face away from the center are on the outside of the mesh,
+    // and are the most likely to occlude the others.
+    double key = 0;
+    for (int j = 0; j < 3; j++) {
+      key += (shape.centroid[j] - meshShape.centroid[j]) * shape.normal[j];
+    }
+    sortKeys[i] = key;
+  });
+
+  std::vector<size_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  size_t outputIndex = 0;
+  for (auto cluster : order) {
+    for (size_t i = boundaries[cluster]; i < boundaries[cluster + 1]; i++) {
+      output[outputIndex++] = input[i];
+    }
+  }
+}
+
+void
+optimizeOverdraw(Mesh& mesh, float threshold, uint32_t cacheSize)
+{
+  Cells cells(mesh.cells.size());
+  optimizeOverdraw(mesh.cells, cells, mesh.positions, threshold, cacheSize);
+  mesh.cells = std::move(cells);
+}
+
+/**
+ * Rasterize the cells as seen looking down an axis, either from the positive
+ * or negative side, and count the fragments.
+ */
+static OverdrawStats
+rasterizeView(std::span<const std::array<uint32_t, 3>> cells,
+              std::span<const Vector3> positions,
+              uint32_t resolution,
+              int axis,
+              float side)
+{
+  int axisU = (axis + 1) % 3;
+  int axisV = (axis + 2) % 3;
+
+  float minU = std::numeric_limits<float>::max();
+  float minV = std::numeric_limits<float>::max();
+  float maxU = std::numeric_limits<float>::lowest();
+  float maxV = std::numeric_limits<float>::lowest();
+  for (auto const& position : positions) {
+    minU = std::min(minU, position[axisU]);
+    minV = std::min(minV, position[axisV]);
+    maxU = std::max(maxU, position[axisU]);
+    maxV = std::max(maxV, position[axisV]);
+  }
+  float extent = std::max(maxU - minU, maxV - minV);
+  float scale = extent > 0 ? resolution / extent : 0;
+
+  std::vector<float> depths(resolution * resolution,
+                            std::numeric_limits<float>::infinity());
+  OverdrawStats stats{};
+
+  for (auto const& cell : cells) {
+    // (u, v) is a cyclic permutation of the axes, so the signed area has the
+    // same sign as the normal's component along the axis.
+    std::array<float, 3> x, y, z;
+    for (int i = 0; i < 3; i++) {
+      auto const& position = positions[cell[i]];
+      x[i] = (position[axisU] - minU) * scale;
+      y[i] = (position[axisV] - minV) * scale;
+      // Smaller depths are closer to the viewer.
+      z[i] = -side * position[axis];
+    }
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area * side <= 0) {
+      // Back facing, or degenerate.
+      continue;
+    }
+    if (area < 0) {
+      std::swap(x[1], x[2]);
+      std::swap(y[1], y[2]);
+      std::swap(z[1], z[2]);
+      area = -area;
+    }
+
+    auto [lowX, highX] = std::minmax({ x[0], x[1], x[2] });
+    auto [lowY, highY] = std::minmax({ y[0], y[1], y[2] });
+    int last = static_cast<int>(resolution) - 1;
+    int minX = std::max(0, static_cast<int>(std::floor(lowX)));
+    int minY = std::max(0, static_cast<int>(std::floor(lowY)));
+    int maxX = std::min(last, static_cast<int>(std::ceil(highX)));
+    int maxY = std::min(last, static_cast<int>(std::ceil(highY)));
+
+    for (int py = minY; py <= maxY; py++) {
+      for (int px = minX; px <= maxX; px++) {
+        float sx = px + 0.5f;
+        float sy = py + 0.5f;
+        float w0 = (x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1]);
+        float w1 = (x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2]);
+        float w2 = (x[1] - x[0]) * (sy - y[0]) - (y[1] - y[0]) * (sx - x[0]);
+        if (w0 < 0 || w1 < 0 || w2 < 0) {
+          continue;
+        }
+        float depth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+        float& stored = depths[py * resolution + px];
+        if (depth < stored) {
+          stored = depth;
+          stats.pixelsShaded++;
+        }
+      }
+    }
+  }
+
+  for (auto depth : depths) {
+    stats.pixelsCovered += depth != std::numeric_limits<float>::infinity();
+  }
+  return stats;
+}
+
+OverdrawStats
+estimateOverdraw(std::span<const std::array<uint32_t, 3>> cells,
+                 std::span<const Vector3> positions,
+                 uint32_t resolution)
+{
+  std::array<OverdrawStats, 6> views{};
+  ParallelFor(views.size(), 1, [&](size_t i) {
+    views[i] = rasterizeView(cells,
+                             positions,
+                             resolution,
+                             static_cast<int>(i / 2),
+                             i % 2 == 0 ? 1.0f : -1.0f);
+  });
+
+  OverdrawStats stats{};
+  for (auto const& view : views) {
+    stats.pixelsCovered += view.pixelsCovered;
+    stats.pixelsShaded += view.pixelsShaded;
+  }
+  if (stats.pixelsCovered > 0) {
+    stats.overdraw =
+      static_cast<float>(stats.pixelsShaded) / stats.pixelsCovered;
+  }
+  return stats;
+}
+
+OverdrawStats
+estimateOverdraw(Mesh const& mesh, uint32_t resolution)
+{
+  return estimateOverdraw(mesh.cells, mesh.positions, resolution);
+}
+
+} // namespace viz
@@ -0,0 +1,54 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <span>
+
+namespace viz {
+
+/**
+ * Reorder the cells to reduce overdraw, while keeping most of the vertex cache
+ * efficiency. The cells are split into clusters along the points where the
+ * vertex cache order starts over, and the clusters are then sorted so that the
+ * ones facing away from the mesh's center are drawn first, and occlude the
+ * rest.
+ *
+ * The cells should already be optimized for the vertex cache. The threshold is
+ * how much worse the ACMR of each cluster may get compared to the original
+ * order. 1.0 keeps the vertex cache efficiency, and larger values allow
+ * smaller clusters, which sort better and reduce more overdraw.
+ */
+void
+optimizeOverdraw(std::span<const std::array<uint32_t, 3>> input,
+                 std::span<std::array<uint32_t, 3>> output,
+                 std::span<const Vector3> positions,
+                 float threshold = 1.05f,
+                 uint32_t cacheSize = 16);
+
+void
+optimizeOverdraw(Mesh& mesh, float threshold = 1.05f, uint32_t cacheSize = 16);
+
+struct OverdrawStats
+{
+  // The pixels covered by the mesh, summed over every view.
+  size_t pixelsCovered = 0;
+  // The fragments that passed the depth test, and so were shaded.
+  size_t pixelsShaded = 0;
+  // Shaded fragments per covered pixel. 1 means there was no overdraw.
+  float overdraw = 0;
+};
+
+/**
+ * Estimate the overdraw of the cells' order on the CPU. The mesh is rasterized
+ * in order from the 6 axis directions with an orthographic projection, back
+ * face culling, and an early depth test. Front faces are counter-clockwise when
+ * seen from outside the mesh.
+ */
+OverdrawStats
+estimateOverdraw(std::span<const std::array<uint32_t, 3>> cells,
+                 std::span<const Vector3> positions,
+                 uint32_t resolution = 256);
+
+OverdrawStats
+estimateOverdraw(Mesh const& mesh, uint32_t resolution = 256);
+
+} // namespace viz
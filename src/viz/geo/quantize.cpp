@@ -0,0 +1,402 @@
+#include "viz/geo/quantize.h"
+#include "viz/assert.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring> // std::memcpy
+#include <limits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace viz {
+
+uint16_t
+encodeHalf(float value)
+{
+  // Adapted from "float_to_half_fast3_rtne" by Fabian Giesen.
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  bits &= 0x7fffffff;
+
+  if (bits >= 0x7f800000) {
+    // Infinity stays infinity, and NaN stays a quiet NaN.
+    return sign | 0x7c00 | (bits > 0x7f800000 ? 0x0200 : 0);
+  }
+  if (bits >= 0x477ff000) {
+    // Everything from 65520 up rounds to infinity.
+    return sign | 0x7c00;
+  }
+  if (bits < 0x38800000) {
+    // This is a subnormal half. Adding 0.5 lines the mantissa up so that the
+    // FPU does the rounding.
+    float magnitude;
+    std::memcpy(&magnitude, &bits, sizeof(bits));
+    magnitude += 0.5f;
+    std::memcpy(&bits, &magnitude, sizeof(bits));
+    return sign | (bits - 0x3f000000);
+  }
+
+  // Rebias the exponent from 127 to 15, and round the mantissa to the nearest
+  // even value.
+  uint32_t mantissaOdd = (bits >> 13) & 1;
+  bits += 0xc8000fff + mantissaOdd;
+  return sign | (bits >> 13);
+}
+
+float
+decodeHalf(uint16_t value)
+{
+  uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+  uint32_t bits;
+
+  if (exponent == 0) {
+    float magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+    std::memcpy(&bits, &magnitude, sizeof(bits));
+    bits |= sign;
+  } else if (exponent == 31) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+
+  float result;
+  std::memcpy(&result, &bits, sizeof(bits));
+  return result;
+}
+
+#if defined(__SSE2__)
+static bool
+hasF16c()
+{
+  static const bool supported = []() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("f16c") != 0;
+  }();
+  return supported;
+}
+
+/**
+ * Convert the floats 4 at a time with F16C, which x86 builds don't assume, so
+ * this is compiled for it on its own. Returns how many were converted.
+ */
+__attribute__((target("f16c"))) static size_t
+encodeHalfsF16c(const float* input, uint16_t* output, size_t count)
+{
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i halfs =
+      _mm_cvtps_ph(_mm_loadu_ps(input + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output + i), halfs);
+  }
+  return i;
+}
+
+__attribute__((target("f16c"))) static size_t
+decodeHalfsF16c(const uint16_t* input, float* output, size_t count)
+{
+  size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m128i halfs =
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + i));
+    _mm_storeu_ps(output + i, _mm_cvtph_ps(halfs));
+  }
+  return i;
+}
+#endif
+
+void
+encodeHalfs(std::span<const float> input, std::span<uint16_t> output)
+{
+  DebugAssert(output.size() >= input.size(),
+              "The half float output is too small.");
+  size_t count = input.size();
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  if (hasF16c()) {
+    i = encodeHalfsF16c(input.data(), output.data(), count);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t halfs = vcvt_f16_f32(vld1q_f32(input.data() + i));
+    vst1_u16(output.data() + i, vreinterpret_u16_f16(halfs));
+  }
+#endif
+
+  for (; i < count; i++) {
+    output[i] = encodeHalf(input[i]);
+  }
+}
+
+void
+decodeHalfs(std::span<const uint16_t> input, std::span<float> output)
+{
+  DebugAssert(output.size() >= input.size(), "The float output is too small.");
+  size_t count = input.size();
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  if (hasF16c()) {
+    i = decodeHalfsF16c(input.data(), output.data(), count);
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t halfs = vreinterpret_f16_u16(vld1_u16(input.data() + i));
+    vst1q_f32(output.data() + i, vcvt_f32_f16(halfs));
+  }
+#endif
+
+  for (; i < count; i++) {
+    output[i] = decodeHalf(input[i]);
+  }
+}
+
+static int16_t
+encodeSnorm16(float value)
+{
+  return static_cast<int16_t>(
+    std::round(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static float
+decodeSnorm16(int16_t value)
+{
+  return std::max(static_cast<float>(value) / 32767.0f, -1.0f);
+}
+
+uint32_t
+encodeOctahedralNormal(Vector3 normal)
+{
+  float x = normal[0];
+  float y = normal[1];
+  float z = normal[2];
+  float sum = std::abs(x) + std::abs(y) + std::abs(z);
+  if (sum == 0) {
+    return 0;
+  }
+  x /= sum;
+  y /= sum;
+
+  // Fold the lower half of the octahedron over the upper half.
+  if (z < 0) {
+    float foldedX = (1.0f - std::abs(y)) * (x >= 0 ? 1.0f : -1.0f);
+    float foldedY = (1.0f - std::abs(x)) * (y >= 0 ? 1.0f : -1.0f);
+    x = foldedX;
+    y = foldedY;
+  }
+
+  uint32_t lo = static_cast<uint16_t>(encodeSnorm16(x));
+  uint32_t hi = static_cast<uint16_t>(encodeSnorm16(y));
+  return lo | (hi << 16);
+}
+
+Vector3
+decodeOctahedralNormal(uint32_t packed)
+{
+  float x = decodeSnorm16(static_cast<int16_t>(packed & 0xffff));
+  float y = decodeSnorm16(static_cast<int16_t>(packed >> 16));
+  float z = 1.0f - std::abs(x) - std::abs(y);
+
+  float fold = std::max(-z, 0.0f);
+  x += x >= 0 ? -fold : fold;
+  y += y >= 0 ? -fold : fold;
+
+  float length = std::sqrt(x * x + y * y + z * z);
+  return Vector3{ x / length, y / length, z / length };
+}
+
+uint16_t
+encodeUnorm16(float value)
+{
+  return static_cast<uint16_t>(
+    std::round(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+float
+decodeUnorm16(uint16_t value)
+{
+  return static_cast<float>(value) / 65535.0f;
+}
+
+static QuantizedBounds
+getBounds(Positions const& positions)
+{
+  float low[3] = { 0, 0, 0 };
+  float high[3] = { 0, 0, 0 };
+  for (size_t i = 0; i < positions.size(); i++) {
+    for (int j = 0; j < 3; j++) {
+      low[j] = i == 0 ? positions[i][j] : std::min(low[j], positions[i][j]);
+      high[j] = i == 0 ? positions[i][j] : std::max(high[j], positions[i][j]);
+    }
+  }
+  return QuantizedBounds{
+    .min = simd::float3{ low[0], low[1], low[2] },
+    .extent =
+      simd::float3{ high[0] - low[0], high[1] - low[1], high[2] - low[2] },
+  };
+}
+
+static uint32_t
+encodeUV(Vector2 uv)
+{
+  return static_cast<uint32_t>(encodeUnorm16(uv[0])) |
+         (static_cast<uint32_t>(encodeUnorm16(uv[1])) << 16);
+}
+
+static Vector2
+decodeUV(uint32_t packed)
+{
+  return Vector2{ decodeUnorm16(packed & 0xffff), decodeUnorm16(packed >> 16) };
+}
+
+static Vector3
+decodePosition(QuantizedMesh const& quantized, size_t index)
+{
+  auto const& packed = quantized.positions[index];
+  if (quantized.positionQuantization == PositionQuantization::Half) {
+    return Vector3{ decodeHalf(packed[0]),
+                    decodeHalf(packed[1]),
+                    decodeHalf(packed[2]) };
+  }
+  auto const& bounds = quantized.bounds;
+  return Vector3{ bounds.min[0] + decodeUnorm16(packed[0]) * bounds.extent[0],
+                  bounds.min[1] + decodeUnorm16(packed[1]) * bounds.extent[1],
+                  bounds.min[2] + decodeUnorm16(packed[2]) * bounds.extent[2] };
+}
+
+QuantizedMesh
+quantizeMesh(Mesh const& mesh, QuantizeMeshOptions options)
+{
+  size_t vertexCount = mesh.positions.size();
+  QuantizedMesh quantized{
+    .positionQuantization = options.positions,
+    .bounds = getBounds(mesh.positions),
+    .positions = std::vector<QuantizedPosition>(vertexCount),
+    .normals = std::vector<uint32_t>(
+      mesh.normals.size() == vertexCount ? vertexCount : 0),
+    .uvs = std::vector<uint32_t>(mesh.uvs.size() == vertexCount ? vertexCount
+                                                                : 0),
+    .cells = mesh.cells,
+  };
+  auto const& bounds = quantized.bounds;
+
+  const size_t chunkSize = 16384;
+  size_t chunkCount = (vertexCount + chunkSize - 1) / chunkSize;
+  ParallelFor(chunkCount, 1, [&](size_t chunk) {
+    size_t begin = chunk * chunkSize;
+    size_t end = std::min(vertexCount, begin + chunkSize);
+
+    if (options.positions == PositionQuantization::Half) {
+      // Convert the whole chunk at once with the SIMD kernel. The padding w
+      // component is set to 1.
+      std::vector<float> floats((end - begin) * 4, 1.0f);
+      std::vector<uint16_t> halfs(floats.size());
+      for (size_t i = begin; i < end; i++) {
+        for (int j = 0; j < 3; j++) {
+          floats[(i - begin) * 4 + j] = mesh.positions[i][j];
+        }
+      }
+      encodeHalfs(floats, halfs);
+      std::memcpy(&quantized.positions[begin],
+                  halfs.data(),
+                  halfs.size() * sizeof(uint16_t));
+    } else {
+      for (size_t i = begin; i < end; i++) {
+        auto& packed = quantized.positions[i];
+        for (int j = 0; j < 3; j++) {
+          float extent = bounds.extent[j];
+          float offset = mesh.positions[i][j] - bounds.min[j];
+          packed[j] = extent == 0 ? 0 : encodeUnorm16(offset / extent);
+        }
+        packed[3] = 0;
+      }
+    }
+
+    for (size_t i = begin; i < std::min(end, quantized.normals.size()); i++) {
+      quantized.normals[i] = encodeOctahedralNormal(mesh.normals[i]);
+    }
+    for (size_t i = begin; i < std::min(end, quantized.uvs.size()); i++) {
+      quantized.uvs[i] = encodeUV(mesh.uvs[i]);
+    }
+  });
+
+  return quantized;
+}
+
+Mesh
+dequantizeMesh(QuantizedMesh const& quantized)
+{
+  Mesh mesh{};
+  mesh.cells = quantized.cells;
+  for (size_t i = 0; i < quantized.positions.size(); i++) {
+    mesh.positions.push_back(decodePosition(quantized, i));
+  }
+  for (auto packed : quantized.normals) {
+    mesh.normals.push_back(decodeOctahedralNormal(packed));
+  }
+  for (auto packed : quantized.uvs) {
+    mesh.uvs.push_back(decodeUV(packed));
+  }
+  return mesh;
+}
+
+QuantizationError
+measureQuantizationError(Mesh const& mesh, QuantizedMesh const& quantized)
+{
+  ReleaseAssert(mesh.positions.size() == quantized.positions.size(),
+                "The quantized mesh doesn't match the original.");
+  QuantizationError error{};
+  Mesh decoded = dequantizeMesh(quantized);
+
+  double positionSum = 0;
+  for (size_t i = 0; i < mesh.positions.size(); i++) {
+    float distance = 0;
+    for (int j = 0; j < 3; j++) {
+      float delta = decoded.positions[i][j] - mesh.positions[i][j];
+      distance += delta * delta;
+    }
+    distance = std::sqrt(distance);
+    error.maxPositionError = std::max(error.maxPositionError, distance);
+    positionSum += distance;
+  }
+
+  double normalSum = 0;
+  for (size_t i = 0; i < decoded.normals.size(); i++) {
+    float dot = 0;
+    float length = 0;
+    for (int j = 0; j < 3; j++) {
+      dot += decoded.normals[i][j] * mesh.normals[i][j];
+      length += mesh.normals[i][j] * mesh.normals[i][j];
+    }
+    if (length == 0) {
+      continue;
+    }
+    float angle = std::acos(std::clamp(dot / std::sqrt(length), -1.0f, 1.0f));
+    error.maxNormalError = std::max(error.maxNormalError, angle);
+    normalSum += angle;
+  }
+
+  for (size_t i = 0; i < decoded.uvs.size(); i++) {
+    for (int j = 0; j < 2; j++) {
+      error.maxUVError = std::max(
+        error.maxUVError, std::abs(decoded.uvs[i][j] - mesh.uvs[i][j]));
+    }
+  }
+
+  if (!mesh.positions.empty()) {
+    error.meanPositionError = positionSum / mesh.positions.size();
+  }
+  if (!decoded.normals.empty()) {
+    error.meanNormalError = normalSum / decoded.normals.size();
+  }
+  return error;
+}
+
+} // namespace viz
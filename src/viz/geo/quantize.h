@@ -0,0 +1,159 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include "viz/metal.h"
+#include "viz/shaders/quantize.h"
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * Convert a float to an IEEE half float, rounding to the nearest even value.
+ */
+uint16_t
+encodeHalf(float value);
+
+float
+decodeHalf(uint16_t value);
+
+/**
+ * Convert floats to half floats in bulk. These use F16C on x86 CPUs that have
+ * it, which is checked at runtime, and NEON on ARM, and match encodeHalf and
+ * decodeHalf exactly, except that the hardware may decode a signaling NaN as a
+ * quiet one. The output must be at least as long as the input.
+ */
+void
+encodeHalfs(std::span<const float> input, std::span<uint16_t> output);
+
+void
+decodeHalfs(std::span<const uint16_t> input, std::span<float> output);
+
+/**
+ * Map a unit normal onto an octahedron, and store it as 2 snorm16 values in a
+ * uint32_t. This matches Metal's pack_float_to_snorm2x16, so it can be read
+ * through a Short2Normalized vertex attribute.
+ */
+uint32_t
+encodeOctahedralNormal(Vector3 normal);
+
+Vector3
+decodeOctahedralNormal(uint32_t packed);
+
+/**
+ * Store a [0, 1] value as a unorm16, clamping values outside of that range.
+ */
+uint16_t
+encodeUnorm16(float value);
+
+float
+decodeUnorm16(uint16_t value);
+
+enum class PositionQuantization
+{
+  // 16 bit floats, which keep the most precision near the origin.
+  Half,
+  // unorm16 values relative to the mesh's bounding box, which have an even
+  // precision of extent / 65535 everywhere.
+  Bounds16,
+};
+
+/**
+ * x, y, z, and a padding w, as either Half4 or UShort4Normalized.
+ */
+using QuantizedPosition = std::array<uint16_t, 4>;
+
+struct QuantizeMeshOptions
+{
+  PositionQuantization positions = PositionQuantization::Bounds16;
+};
+
+/**
+ * A mesh with its vertex attributes quantized for the GPU. A vertex takes 16
+ * bytes rather than 32. Positions are padded to 4 components so that they stay
+ * 8 byte aligned, as 3 component 16 bit formats can't be read by Metal.
+ */
+struct QuantizedMesh
+{
+  PositionQuantization positionQuantization;
+  // Only used for Bounds16 positions.
+  QuantizedBounds bounds;
+  std::vector<QuantizedPosition> positions;
+  // Short2Normalized octahedral normals, if the mesh has normals.
+  std::vector<uint32_t> normals;
+  // UShort2Normalized uvs, if the mesh has uvs.
+  std::vector<uint32_t> uvs;
+  Cells cells;
+};
+
+/**
+ * How far the quantized attributes are from the originals.
+ */
+struct QuantizationError
+{
+  // In the mesh's units.
+  float maxPositionError = 0;
+  float meanPositionError = 0;
+  // The angle between the original and decoded normals, in radians.
+  float maxNormalError = 0;
+  float meanNormalError = 0;
+  float maxUVError = 0;
+};
+
+QuantizedMesh
+quantizeMesh(Mesh const& mesh, QuantizeMeshOptions options = {});
+
+Mesh
+dequantizeMesh(QuantizedMesh const& quantized);
+
+QuantizationError
+measureQuantizationError(Mesh const& mesh, QuantizedMesh const& quantized);
+
+/**
+ * The opt-in quantized version of MeshBuffers. The shaders need to decode the
+ * attributes with viz/shaders/quantize.h, and Bounds16 positions need the
+ * bounds buffer bound. The normals and uvs are only created when the mesh has
+ * them, as Metal can't create an empty buffer.
+ */
+class QuantizedMeshBuffers
+{
+public:
+  // Move only
+  QuantizedMeshBuffers(QuantizedMeshBuffers&& other) = default;
+  QuantizedMeshBuffers& operator=(QuantizedMeshBuffers&& other) = default;
+
+  QuantizedMeshBuffers(mtlpp::Device& device,
+                       QuantizedMesh const& mesh,
+                       mtlpp::ResourceOptions options)
+    : positions(
+        BufferViewList<QuantizedPosition>(mesh.positions, device, options))
+    , indices(IndexBuffer(device, options, mesh.positions.size(), mesh.cells))
+    , normals(OptionalList(mesh.normals, device, options))
+    , uvs(OptionalList(mesh.uvs, device, options))
+    , bounds(BufferViewStruct<QuantizedBounds>(
+        QuantizedBounds{ mesh.bounds }, device, options))
+    , positionQuantization(mesh.positionQuantization)
+  {}
+
+  BufferViewList<QuantizedPosition> positions;
+  IndexBuffer indices;
+  std::optional<BufferViewList<uint32_t>> normals;
+  std::optional<BufferViewList<uint32_t>> uvs;
+  BufferViewStruct<QuantizedBounds> bounds;
+  PositionQuantization positionQuantization;
+
+private:
+  static std::optional<BufferViewList<uint32_t>> OptionalList(
+    std::vector<uint32_t> const& list,
+    mtlpp::Device& device,
+    mtlpp::ResourceOptions options)
+  {
+    if (list.empty()) {
+      return std::nullopt;
+    }
+    return BufferViewList<uint32_t>(list, device, options);
+  }
+};
+
+} // namespace viz
@@ -0,0 +1,377 @@
+#include "viz/geo/simplify.h"
+#include "viz/assert.h"
+#include "viz/geo/adjacency.h"
+#include "viz/parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace viz {
+
+// Below this many cells, the work is done on the calling thread, as the cost of
+// starting threads would outweigh the work.
+static const size_t PARALLEL_CELL_COUNT = 32768;
+
+/**
+ * A symmetric 4x4 quadric, the sum of the squared distances to a set of planes.
+ */
+struct Quadric
+{
+  double a2 = 0, b2 = 0, c2 = 0, d2 = 0;
+  double ab = 0, ac = 0, ad = 0, bc = 0, bd = 0, cd = 0;
+  double weight = 0;
+
+  void Add(Quadric const& other)
+  {
+    a2 += other.a2;
+    b2 += other.b2;
+    c2 += other.c2;
+    d2 += other.d2;
+    ab += other.ab;
+    ac += other.ac;
+    ad += other.ad;
+    bc += other.bc;
+    bd += other.bd;
+    cd += other.cd;
+    weight += other.weight;
+  }
+
+  double Evaluate(Vector3 const& p) const
+  {
+    double x = p[0];
+    double y = p[1];
+    double z = p[2];
+    return a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+           2 * (ab * x * y + ac * x * z + bc * y * z) +
+           2 * (ad * x + bd * y + cd * z);
+  }
+};
+
+static std::array<double, 3>
+getCellCross(std::array<uint32_t, 3> const& cell,
+             std::span<const Vector3> positions)
+{
+  auto const& a = positions[cell[0]];
+  auto const& b = positions[cell[1]];
+  auto const& c = positions[cell[2]];
+  double abx = b[0] - a[0], aby = b[1] - a[1], abz = b[2] - a[2];
+  double acx = c[0] - a[0], acy = c[1] - a[1], acz = c[2] - a[2];
+  return { aby * acz - abz * acy,
+           abz * acx - abx * acz,
+           abx * acy - aby * acx };
+}
+
+// The plane quadric of a cell, weighted by its area.
+static Quadric
+getCellQuadric(std::array<uint32_t, 3> const& cell,
+               std::span<const Vector3> positions)
+{
+  auto cross = getCellCross(cell, positions);
+  double length = std::sqrt(cross[0] * cross[0] + cross[1] * cross[1] +
+                            cross[2] * cross[2]);
+  if (length == 0) {
+    return Quadric{};
+  }
+  double a = cross[0] / length;
+  double b = cross[1] / length;
+  double c = cross[2] / length;
+  auto const& p = positions[cell[0]];
+  double d = -(a * p[0] + b * p[1] + c * p[2]);
+  double w = length * 0.5;
+
+  return Quadric{
+    .a2 = w * a * a,
+    .b2 = w * b * b,
+    .c2 = w * c * c,
+    .d2 = w * d * d,
+    .ab = w * a * b,
+    .ac = w * a * c,
+    .ad = w * a * d,
+    .bc = w * b * c,
+    .bd = w * b * d,
+    .cd = w * c * d,
+    .weight = w,
+  };
+}
+
+struct Collapse
+{
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+template<typename Fn>
+static void
+forEachIndex(bool parallel, size_t count, size_t grainSize, Fn fn)
+{
+  if (parallel) {
+    ParallelFor(count, grainSize, fn);
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      fn(i);
+    }
+  }
+}
+
+/**
+ * Vertices that share a position with another vertex are on an attribute seam,
+ * and vertices on an open or non-manifold edge are on a border. Both are
+ * locked, so that collapses never pull them apart.
+ */
+static std::vector<uint8_t>
+findLockedVertices(MeshAdjacency const& adjacency,
+                   std::span<const Vector3> positions)
+{
+  std::vector<uint8_t> locked(positions.size(), 0);
+
+  // Sort the vertices by position, so that the shared positions end up next
+  // to each other.
+  std::vector<uint32_t> order(positions.size());
+  for (uint32_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  auto key = [&](uint32_t i) {
+    return std::array<float, 3>{ positions[i][0],
+                                 positions[i][1],
+                                 positions[i][2] };
+  };
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return key(a) < key(b);
+  });
+  for (size_t i = 1; i < order.size(); i++) {
+    if (key(order[i - 1]) == key(order[i])) {
+      locked[order[i - 1]] = 1;
+      locked[order[i]] = 1;
+    }
+  }
+
+  for (uint32_t edge = 0; edge < adjacency.GetEdgeCount(); edge++) {
+    if (adjacency.GetEdgeCells(edge).size() != 2) {
+      auto [a, b] = adjacency.GetEdges()[edge];
+      locked[a] = 1;
+      locked[b] = 1;
+    }
+  }
+
+  return locked;
+}
+
+// Does moving a vertex flip any of its cells, apart from the ones that
+// collapse away?
+static bool
+hasFlip(Cells const& cells,
+        MeshAdjacency const& adjacency,
+        std::span<const Vector3> positions,
+        uint32_t from,
+        uint32_t to)
+{
+  for (auto corner : adjacency.GetVertexCorners(from)) {
+    auto cell = cells[corner / 3];
+    if (cell[0] == to || cell[1] == to || cell[2] == to) {
+      continue;
+    }
+    auto before = getCellCross(cell, positions);
+    for (auto& index : cell) {
+      index = index == from ? to : index;
+    }
+    auto after = getCellCross(cell, positions);
+    double dot = before[0] * after[0] + before[1] * after[1] +
+                 before[2] * after[2];
+    if (dot <= 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static SimplifiedCells
+simplifyCells(std::span<const std::array<uint32_t, 3>> input,
+              std::span<const Vector3> positions,
+              SimplifyOptions options,
+              bool parallel)
+{
+  size_t vertexCount = positions.size();
+  Cells cells(input.begin(), input.end());
+  for (auto const& cell : cells) {
+    for (auto index : cell) {
+      ReleaseAssert(index < vertexCount, "A cell index is out of range.");
+    }
+  }
+  parallel = parallel && cells.size() >= PARALLEL_CELL_COUNT;
+
+  // The error is relative to the size of the mesh.
+  float low[3] = { 0, 0, 0 };
+  float high[3] = { 0, 0, 0 };
+  for (size_t i = 0; i < vertexCount; i++) {
+    for (int j = 0; j < 3; j++) {
+      low[j] = i == 0 ? positions[i][j] : std::min(low[j], positions[i][j]);
+      high[j] = i == 0 ? positions[i][j] : std::max(high[j], positions[i][j]);
+    }
+  }
+  double extent = std::sqrt((high[0] - low[0]) * (high[0] - low[0]) +
+                            (high[1] - low[1]) * (high[1] - low[1]) +
+                            (high[2] - low[2]) * (high[2] - low[2]));
+  double maxCost = static_cast<double>(options.targetError) * extent;
+  maxCost = std::isfinite(maxCost) ? maxCost * maxCost
+                                   : std::numeric_limits<double>::max();
+
+  MeshAdjacency adjacency(cells, vertexCount, parallel);
+
+  // Each vertex gathers the quadrics of its cells.
+  std::vector<Quadric> quadrics(vertexCount);
+  {
+    std::vector<Quadric> cellQuadrics(cells.size());
+    forEachIndex(parallel, cells.size(), 4096, [&](size_t i) {
+      cellQuadrics[i] = getCellQuadric(cells[i], positions);
+    });
+    forEachIndex(parallel, vertexCount, 4096, [&](size_t i) {
+      for (auto corner : adjacency.GetVertexCorners(i)) {
+        quadrics[i].Add(cellQuadrics[corner / 3]);
+      }
+    });
+  }
+
+  auto locked = findLockedVertices(adjacency, positions);
+  double largestCost = 0;
+
+  // Each pass picks the cheapest collapses that don't touch each other, and
+  // applies them all at once. This repeats until the target is reached.
+  while (cells.size() > options.targetCellCount) {
+    auto edges = adjacency.GetEdges();
+
+    std::vector<Collapse> collapses(edges.size());
+    forEachIndex(parallel, edges.size(), 4096, [&](size_t i) {
+      auto [a, b] = edges[i];
+      Quadric sum = quadrics[a];
+      sum.Add(quadrics[b]);
+      double weight = std::max(sum.weight, 1e-20);
+      double aCost = locked[b] ? std::numeric_limits<double>::max()
+                               : std::max(sum.Evaluate(positions[a]), 0.0);
+      double bCost = locked[a] ? std::numeric_limits<double>::max()
+                               : std::max(sum.Evaluate(positions[b]), 0.0);
+      // Collapse onto whichever end has the lower error.
+      collapses[i] = aCost < bCost ? Collapse{ b, a, aCost / weight }
+                                   : Collapse{ a, b, bCost / weight };
+    });
+    std::sort(collapses.begin(), collapses.end(), [](auto& a, auto& b) {
+      return a.cost < b.cost;
+    });
+
+    std::vector<uint32_t> remap(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      remap[i] = i;
+    }
+    std::vector<uint8_t> touched(vertexCount, 0);
+    size_t cellCount = cells.size();
+    size_t collapseCount = 0;
+
+    // Most collapses remove 2 cells. Only take collapses that are close in
+    // cost to the ones needed to reach the target, so that an expensive
+    // collapse isn't taken now when cheaper ones would open up next pass.
+    size_t collapseGoal = (cellCount - options.targetCellCount) / 2;
+    double passMaxCost = maxCost;
+    if (collapseGoal < collapses.size()) {
+      passMaxCost = std::min(passMaxCost, 1.5 * collapses[collapseGoal].cost);
+    }
+
+    while (true) {
+      for (auto const& [from, to, cost] : collapses) {
+        if (cellCount <= options.targetCellCount || cost > passMaxCost) {
+          break;
+        }
+        if (locked[from] || touched[from] || touched[to] ||
+            hasFlip(cells, adjacency, positions, from, to)) {
+          continue;
+        }
+
+        // Lock the whole one-ring for the rest of the pass, so that the cells
+        // around this collapse don't change underneath it.
+        for (auto corner : adjacency.GetVertexCorners(from)) {
+          auto const& cell = cells[corner / 3];
+          bool removed = cell[0] == to || cell[1] == to || cell[2] == to;
+          cellCount -= removed;
+          for (auto index : cell) {
+            touched[index] = 1;
+          }
+        }
+        remap[from] = to;
+        quadrics[to].Add(quadrics[from]);
+        largestCost = std::max(largestCost, cost);
+        collapseCount++;
+      }
+      if (collapseCount > 0 || passMaxCost >= maxCost) {
+        break;
+      }
+
+      // Every collapse under the cap was locked or flipped a cell. Rather
+      // than stopping short of the target, raise the cap past the next
+      // candidate, up to the target error.
+      auto next = std::upper_bound(
+        collapses.begin(),
+        collapses.end(),
+        passMaxCost,
+        [](double cost, Collapse const& collapse) {
+          return cost < collapse.cost;
+        });
+      if (next == collapses.end() || next->cost > maxCost) {
+        break;
+      }
+      passMaxCost = std::min(maxCost, 2 * std::max(passMaxCost, next->cost));
+    }
+
+    if (collapseCount == 0) {
+      break;
+    }
+
+    Cells nextCells{};
+    nextCells.reserve(cellCount);
+    for (auto const& cell : cells) {
+      std::array<uint32_t, 3> next{ remap[cell[0]],
+                                    remap[cell[1]],
+                                    remap[cell[2]] };
+      if (next[0] != next[1] && next[1] != next[2] && next[2] != next[0]) {
+        nextCells.push_back(next);
+      }
+    }
+    cells = std::move(nextCells);
+    if (cells.size() > options.targetCellCount) {
+      adjacency = MeshAdjacency(cells, vertexCount, parallel);
+    }
+  }
+
+  return SimplifiedCells{
+    .cells = std::move(cells),
+    .error = extent > 0 ? static_cast<float>(std::sqrt(largestCost) / extent)
+                        : 0.0f,
+  };
+}
+
+SimplifiedCells
+simplifyCells(std::span<const std::array<uint32_t, 3>> cells,
+              std::span<const Vector3> positions,
+              SimplifyOptions options)
+{
+  return simplifyCells(cells, positions, options, true);
+}
+
+SimplifiedCells
+simplifyMesh(Mesh const& mesh, SimplifyOptions options)
+{
+  return simplifyCells(mesh.cells, mesh.positions, options, true);
+}
+
+std::vector<MeshLod>
+buildLodChain(Mesh const& mesh, std::span<const SimplifyOptions> levels)
+{
+  std::vector<MeshLod> lods(levels.size());
+  // The levels are already spread across the threads, so each one runs on a
+  // single thread.
+  ParallelFor(levels.size(), 1, [&](size_t i) {
+    auto simplified =
+      simplifyCells(mesh.cells, mesh.positions, levels[i], false);
+    lods[i] = MeshLod{ std::move(simplified.cells), simplified.error };
+  });
+  return lods;
+}
+
+} // namespace viz
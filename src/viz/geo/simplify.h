@@ -0,0 +1,105 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+struct SimplifyOptions
+{
+  // Stop once the mesh has this many cells or fewer.
+  size_t targetCellCount = 0;
+  // Stop before any collapse would move the surface further than this,
+  // relative to the diagonal of the mesh's bounding box.
+  float targetError = std::numeric_limits<float>::max();
+};
+
+struct SimplifiedCells
+{
+  Cells cells;
+  // The largest error of any collapse, relative to the bounding box diagonal.
+  float error;
+};
+
+/**
+ * Simplify the cells with quadric error metric edge collapses, from "Surface
+ * Simplification Using Quadric Error Metrics", Garland and Heckbert 1997.
+ *
+ * Vertices are only ever collapsed onto other existing vertices, so the result
+ * is a new set of cells for the same vertex buffers. Attribute seams, which
+ * are vertices that share a position with another vertex, and open borders are
+ * locked in place so they don't tear. Collapses that would flip a cell are
+ * rejected. Large meshes are processed in parallel.
+ */
+SimplifiedCells
+simplifyCells(std::span<const std::array<uint32_t, 3>> cells,
+              std::span<const Vector3> positions,
+              SimplifyOptions options);
+
+SimplifiedCells
+simplifyMesh(Mesh const& mesh, SimplifyOptions options);
+
+/**
+ * Simplify packed positions and cells, in the same layout that
+ * ComputeAngleNormalsPacked uses. Returns the new packed cells.
+ */
+template<typename Decimal, typename Integer>
+std::vector<Integer>
+simplifyPacked(std::span<Integer> cells,
+               std::span<Decimal> positions,
+               SimplifyOptions options)
+{
+  std::vector<Vector3> unpackedPositions{};
+  unpackedPositions.reserve(positions.size() / 3);
+  for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+    unpackedPositions.push_back(
+      Vector3{ static_cast<float>(positions[i]),
+               static_cast<float>(positions[i + 1]),
+               static_cast<float>(positions[i + 2]) });
+  }
+
+  Cells unpackedCells(cells.size() / 3);
+  for (size_t i = 0; i < unpackedCells.size(); i++) {
+    unpackedCells[i] = { static_cast<uint32_t>(cells[i * 3]),
+                         static_cast<uint32_t>(cells[i * 3 + 1]),
+                         static_cast<uint32_t>(cells[i * 3 + 2]) };
+  }
+
+  auto simplified = simplifyCells(unpackedCells, unpackedPositions, options);
+  std::vector<Integer> result{};
+  result.reserve(simplified.cells.size() * 3);
+  for (auto const& cell : simplified.cells) {
+    for (auto index : cell) {
+      result.push_back(static_cast<Integer>(index));
+    }
+  }
+  return result;
+}
+
+/**
+ * One level of detail. It shares the original mesh's vertices.
+ */
+struct MeshLod
+{
+  Cells cells;
+  float error;
+};
+
+/**
+ * Simplify the mesh once for each set of options, starting from the full mesh
+ * each time. The levels are built in parallel.
+ *
+ * e.g. Halve the cell count at each level:
+ *
+ * auto lods = buildLodChain(mesh, std::vector<SimplifyOptions>{
+ *   { .targetCellCount = mesh.cells.size() / 2 },
+ *   { .targetCellCount = mesh.cells.size() / 4 },
+ *   { .targetCellCount = mesh.cells.size() / 8 },
+ * });
+ */
+std::vector<MeshLod>
+buildLodChain(Mesh const& mesh, std::span<const SimplifyOptions> levels);
+
+} // namespace viz
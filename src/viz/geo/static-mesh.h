@@ -0,0 +1,273 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <cstdint>
+
+namespace viz {
+
+/**
+ * A square root that can run at compile time. This is Newton's method in
+ * double precision, starting above the root, so that it only ever walks down
+ * to it, and stops once it can't get any closer.
+ */
+constexpr float
+constexprSqrt(float value)
+{
+  if (!(value > 0.0f)) {
+    return 0.0f;
+  }
+  double x = value;
+  double guess = x > 1.0 ? x : 1.0;
+  for (;;) {
+    double next = 0.5 * (guess + x / guess);
+    if (next >= guess) {
+      return static_cast<float>(guess);
+    }
+    guess = next;
+  }
+}
+
+/**
+ * A mesh whose streams are fixed size arrays, so that it can be generated in a
+ * constexpr context, and stored in the binary as a static table. UvCount is
+ * either VertexCount or 0, for meshes without uvs.
+ */
+template<size_t VertexCount, size_t CellCount, size_t UvCount = 0>
+struct StaticMesh
+{
+  std::array<std::array<float, 3>, VertexCount> positions = {};
+  std::array<std::array<float, 2>, UvCount> uvs = {};
+  std::array<std::array<float, 3>, VertexCount> normals = {};
+  std::array<std::array<uint32_t, 3>, CellCount> cells = {};
+
+  static constexpr MeshCounts counts = {
+    .vertexCount = VertexCount,
+    .cellCount = CellCount,
+  };
+
+  /**
+   * Copy the tables into the output spans, which must be at least as large as
+   * the counts. Like the generators, this skips any empty vertex attribute
+   * span, so it can be handed to MeshBuffers as the generate function.
+   */
+  void Write(MeshSpans output) const
+  {
+    for (size_t i = 0; i < VertexCount; i++) {
+      auto const& p = positions[i];
+      output.positions[i] = Vector3{ p[0], p[1], p[2] };
+      if (!output.normals.empty()) {
+        auto const& n = normals[i];
+        output.normals[i] = Vector3{ n[0], n[1], n[2] };
+      }
+    }
+    if (!output.uvs.empty()) {
+      for (size_t i = 0; i < UvCount; i++) {
+        output.uvs[i] = Vector2{ uvs[i][0], uvs[i][1] };
+      }
+    }
+    for (size_t i = 0; i < CellCount; i++) {
+      output.cells[i] = cells[i];
+    }
+  }
+
+  Mesh ToMesh() const
+  {
+    Mesh mesh{};
+    Write(allocateMeshSpans(mesh, counts, UvCount != 0));
+    return mesh;
+  }
+};
+
+/**
+ * The icosphere from generateIcosphere, with a radius of 1, built at compile
+ * time. The vertices and cells are in the same order as the runtime generator,
+ * and each midpoint is interpolated in the same direction as subdivide(), so
+ * the two can be swapped freely. The positions come out bit for bit the same.
+ * The one caveat is the square root, which is rounded from a double here, and
+ * could in principle differ in the last bit from the platform's sqrtf.
+ *
+ * Only the low levels are supported, as the tables are stored in the binary.
+ *
+ * e.g. Draw the level 2 sphere without generating anything at startup:
+ *
+ * auto const& sphere = STATIC_ICOSPHERE<2>;
+ * MeshBuffers buffers(
+ *   device,
+ *   sphere.counts,
+ *   [&](MeshSpans spans) { sphere.Write(spans); },
+ *   options);
+ */
+template<size_t Subdivisions>
+constexpr auto
+generateStaticIcosphere()
+{
+  static_assert(Subdivisions <= 3,
+                "Static icospheres are only built up to 3 subdivisions.");
+  constexpr size_t n = size_t(1) << Subdivisions;
+  constexpr size_t vertexCount = 10 * n * n + 2;
+  constexpr size_t cellCount = 20 * n * n;
+
+  StaticMesh<vertexCount, cellCount> mesh{};
+
+  // This is the icosahedron from generateIcosphere.
+  float t = 0.5f + constexprSqrt(5.0f) / 2.0f;
+  std::array<std::array<float, 3>, 12> corners = { {
+    { -1.0f, +t, 0.0f },
+    { +1.0f, +t, 0.0f },
+    { -1.0f, -t, 0.0f },
+    { +1.0f, -t, 0.0f },
+    { 0.0f, -1.0f, +t },
+    { 0.0f, +1.0f, +t },
+    { 0.0f, -1.0f, -t },
+    { 0.0f, +1.0f, -t },
+    { +t, 0.0f, -1.0f },
+    { +t, 0.0f, +1.0f },
+    { -t, 0.0f, -1.0f },
+    { -t, 0.0f, +1.0f },
+  } };
+  std::array<std::array<uint32_t, 3>, 20> faces = { {
+    { 0, 11, 5 }, { 0, 5, 1 },  { 0, 1, 7 },   { 0, 7, 10 }, { 0, 10, 11 },
+    { 1, 5, 9 },  { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+    { 3, 9, 4 },  { 3, 4, 2 },  { 3, 2, 6 },   { 3, 6, 8 },  { 3, 8, 9 },
+    { 4, 9, 5 },  { 2, 4, 11 }, { 6, 2, 10 },  { 8, 6, 7 },  { 9, 8, 1 },
+  } };
+  for (size_t i = 0; i < corners.size(); i++) {
+    mesh.positions[i] = corners[i];
+  }
+  for (size_t i = 0; i < faces.size(); i++) {
+    mesh.cells[i] = faces[i];
+  }
+
+  // Subdivide the same way as subdivide(), where the midpoints are numbered in
+  // the order their edges are first visited, and interpolated from the first
+  // visited endpoint towards the second. Rather than a hash map, each
+  // vertex keeps the midpoints of the edges to its higher neighbors, of which
+  // there are at most 6.
+  size_t currentVertexCount = corners.size();
+  size_t currentCellCount = faces.size();
+  for (size_t level = 0; level < Subdivisions; level++) {
+    std::array<std::array<std::array<uint32_t, 2>, 6>, vertexCount> midpoints{};
+    std::array<uint8_t, vertexCount> midpointCounts{};
+    uint32_t nextIndex = static_cast<uint32_t>(currentVertexCount);
+
+    auto getMidpointIndex = [&](uint32_t a, uint32_t b) {
+      uint32_t low = a < b ? a : b;
+      uint32_t high = a < b ? b : a;
+      for (uint8_t i = 0; i < midpointCounts[low]; i++) {
+        if (midpoints[low][i][0] == high) {
+          return midpoints[low][i][1];
+        }
+      }
+      midpoints[low][midpointCounts[low]++] = { high, nextIndex };
+      auto const& pa = mesh.positions[a];
+      auto const& pb = mesh.positions[b];
+      mesh.positions[nextIndex] = { pa[0] + (pb[0] - pa[0]) * 0.5f,
+                                    pa[1] + (pb[1] - pa[1]) * 0.5f,
+                                    pa[2] + (pb[2] - pa[2]) * 0.5f };
+      return nextIndex++;
+    };
+
+    std::array<std::array<uint32_t, 3>, cellCount> cells{};
+    for (size_t i = 0; i < currentCellCount; i++) {
+      auto cell = mesh.cells[i];
+      uint32_t mid0 = getMidpointIndex(cell[0], cell[1]);
+      uint32_t mid1 = getMidpointIndex(cell[1], cell[2]);
+      uint32_t mid2 = getMidpointIndex(cell[2], cell[0]);
+
+      cells[i * 4 + 0] = { cell[0], mid0, mid2 };
+      cells[i * 4 + 1] = { cell[1], mid1, mid0 };
+      cells[i * 4 + 2] = { cell[2], mid2, mid1 };
+      cells[i * 4 + 3] = { mid0, mid1, mid2 };
+    }
+    mesh.cells = cells;
+    currentVertexCount = nextIndex;
+    currentCellCount *= 4;
+  }
+
+  for (size_t i = 0; i < vertexCount; i++) {
+    auto& p = mesh.positions[i];
+    float scale = 1.0f / constexprSqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+    p = { p[0] * scale, p[1] * scale, p[2] * scale };
+    mesh.normals[i] = p;
+  }
+  return mesh;
+}
+
+/**
+ * The box from generateBox, with a size of 1, built at compile time. The
+ * panels are written in the same order as the runtime generator, with the same
+ * uvs and normals, so the two can be swapped freely.
+ */
+template<size_t SegmentsX = 1, size_t SegmentsY = 1, size_t SegmentsZ = 1>
+constexpr auto
+generateStaticBox()
+{
+  constexpr size_t vertexCount =
+    2 * ((SegmentsX + 1) * (SegmentsY + 1) + (SegmentsZ + 1) * (SegmentsY + 1) +
+         (SegmentsX + 1) * (SegmentsZ + 1));
+  constexpr size_t cellCount =
+    4 * (SegmentsX * SegmentsY + SegmentsZ * SegmentsY + SegmentsX * SegmentsZ);
+
+  StaticMesh<vertexCount, cellCount, vertexCount> mesh{};
+  uint32_t vertexOffset = 0;
+  size_t cellOffset = 0;
+
+  // This follows writePanel in viz/geo/box.cpp, step for step.
+  auto writePanel = [&](size_t sx,
+                        size_t sy,
+                        std::array<float, 3> normal,
+                        auto toPosition) {
+    uint32_t columns = static_cast<uint32_t>(sx) + 1;
+    uint32_t rows = static_cast<uint32_t>(sy) + 1;
+    float stepX = 1.0f / sx;
+    float stepY = 1.0f / sy;
+
+    for (uint32_t y = 0; y < rows; y++) {
+      float height = stepY * y - 0.5f;
+      for (uint32_t x = 0; x < columns; x++) {
+        float width = stepX * x - 0.5f;
+        uint32_t index = vertexOffset + columns * y + x;
+        mesh.positions[index] = toPosition(width, height);
+        mesh.uvs[index] = { static_cast<float>(width / 1.0f + 0.5),
+                            static_cast<float>(height / 1.0f + 0.5) };
+        mesh.normals[index] = normal;
+      }
+    }
+
+    for (uint32_t x = 0; x < columns - 1; x++) {
+      for (uint32_t y = 0; y < rows - 1; y++) {
+        uint32_t a = vertexOffset + columns * (y + 0) + (x + 0);
+        uint32_t b = vertexOffset + columns * (y + 0) + (x + 1);
+        uint32_t c = vertexOffset + columns * (y + 1) + (x + 1);
+        uint32_t d = vertexOffset + columns * (y + 1) + (x + 0);
+        mesh.cells[cellOffset++] = { a, b, c };
+        mesh.cells[cellOffset++] = { c, d, a };
+      }
+    }
+
+    vertexOffset += columns * rows;
+  };
+
+  using Position = std::array<float, 3>;
+  // clang-format off
+  writePanel(SegmentsX, SegmentsY, { 0, 0, 1 },  [](float u, float v) { return Position{  u,     v,     0.5f }; });
+  writePanel(SegmentsX, SegmentsY, { 0, 0, -1 }, [](float u, float v) { return Position{  u,    -v,    -0.5f }; });
+  writePanel(SegmentsZ, SegmentsY, { 1, 0, 0 },  [](float u, float v) { return Position{  0.5f, -v,     u    }; });
+  writePanel(SegmentsZ, SegmentsY, { -1, 0, 0 }, [](float u, float v) { return Position{ -0.5f,  v,     u    }; });
+  writePanel(SegmentsX, SegmentsZ, { 0, 1, 0 },  [](float u, float v) { return Position{  u,     0.5f, -v    }; });
+  writePanel(SegmentsX, SegmentsZ, { 0, -1, 0 }, [](float u, float v) { return Position{  u,    -0.5f,  v    }; });
+  // clang-format on
+
+  return mesh;
+}
+
+/**
+ * The static tables, which are evaluated once at compile time.
+ */
+template<size_t Subdivisions>
+inline constexpr auto STATIC_ICOSPHERE =
+  generateStaticIcosphere<Subdivisions>();
+
+inline constexpr auto STATIC_UNIT_BOX = generateStaticBox();
+
+} // namespace viz
@@ -0,0 +1,346 @@
+#include "viz/geo/subdivide.h"
+#include "viz/assert.h"
+#include "viz/geo/adjacency.h"
+#include "viz/geo/edge-map.h"
+#include "viz/geo/normals.h"
+#include "viz/math.h"
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace viz {
+
+void
+subdivide(Mesh& mesh)
+{
+  auto vertexCount = static_cast<uint32_t>(mesh.positions.size());
+  auto cellCount = mesh.cells.size();
+
+  // Every cell has three edges, so this is the most edges that can exist. A
+  // closed mesh will only use half of them.
+  EdgeMap edgeToMidpoint{ cellCount * 3 };
+  uint32_t nextIndex = vertexCount;
+
+  // The endpoints of each midpoint, in the order the edge was first visited.
+  // The midpoint is interpolated from the first towards the second, like the
+  // original position keyed version did, so that the output is unchanged.
+  std::vector<std::array<uint32_t, 2>> midpointEdges{};
+  midpointEdges.reserve(cellCount * 3 / 2);
+
+  auto getMidpointIndex = [&](uint32_t a, uint32_t b) {
+    auto [index, inserted] = edgeToMidpoint.Insert(a, b, nextIndex);
+    if (inserted) {
+      midpointEdges.push_back({ a, b });
+      nextIndex++;
+    }
+    return index;
+  };
+
+  // Build the new cells directly from the old ones. The old cells are only read
+  // from, so they don't need to be copied.
+  Cells cells(cellCount * 4);
+  for (size_t i = 0; i < cellCount; i++) {
+    auto const& cell = mesh.cells[i];
+
+    auto mid0 = getMidpointIndex(cell[0], cell[1]);
+    auto mid1 = getMidpointIndex(cell[1], cell[2]);
+    auto mid2 = getMidpointIndex(cell[2], cell[0]);
+
+    cells[i * 4 + 0] = { cell[0], mid0, mid2 };
+    cells[i * 4 + 1] = { cell[1], mid1, mid0 };
+    cells[i * 4 + 2] = { cell[2], mid2, mid1 };
+    cells[i * 4 + 3] = { mid0, mid1, mid2 };
+  }
+  mesh.cells = std::move(cells);
+
+  // Now that the edge count is known, the vertex attributes can be sized
+  // exactly, and each midpoint written once.
+  size_t newVertexCount = vertexCount + midpointEdges.size();
+  bool hasNormals = mesh.normals.size() == vertexCount;
+  bool hasUvs = mesh.uvs.size() == vertexCount;
+
+  mesh.positions.resize(newVertexCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  if (hasNormals) {
+    mesh.normals.resize(newVertexCount, Vector3{ 0.0f, 0.0f, 0.0f });
+  }
+  if (hasUvs) {
+    mesh.uvs.resize(newVertexCount, Vector2{ 0.0f, 0.0f });
+  }
+
+  for (uint32_t i = 0; i < midpointEdges.size(); i++) {
+    auto [a, b] = midpointEdges[i];
+    uint32_t index = vertexCount + i;
+    mesh.positions[index] = mesh.positions[a].lerp(mesh.positions[b], 0.5f);
+
+    if (hasNormals) {
+      auto normal = mesh.normals[a].lerp(mesh.normals[b], 0.5f);
+      normal.Normalize();
+      mesh.normals[index] = normal;
+    }
+
+    if (hasUvs) {
+      auto& uvA = mesh.uvs[a];
+      auto& uvB = mesh.uvs[b];
+      mesh.uvs[index] = Vector2{ (uvA[0] + uvB[0]) * 0.5f,
+                                 (uvA[1] + uvB[1]) * 0.5f };
+    }
+  }
+}
+
+/**
+ * The weight of each neighbor in the even stencil of an interior vertex with n
+ * neighbors, from Loop's thesis.
+ */
+static float
+getLoopBeta(size_t n)
+{
+  float c = 0.375f + 0.25f * std::cos(2.0f * static_cast<float>(M_PI) / n);
+  return (0.625f - c * c) / n;
+}
+
+static bool
+isCreaseEdge(MeshAdjacency const& adjacency, uint32_t edge)
+{
+  return adjacency.GetEdgeCells(edge).size() != 2;
+}
+
+static Vector3
+getEvenPosition(MeshAdjacency const& adjacency,
+                std::span<const Vector3> positions,
+                uint32_t vertex)
+{
+  auto neighbors = adjacency.GetVertexNeighbors(vertex);
+  float sum[3] = { 0, 0, 0 };
+  float crease[3] = { 0, 0, 0 };
+  size_t creaseCount = 0;
+  for (auto neighbor : neighbors) {
+    auto const& p = positions[neighbor];
+    for (int i = 0; i < 3; i++) {
+      sum[i] += p.v[i];
+    }
+    if (isCreaseEdge(adjacency, adjacency.FindEdge(vertex, neighbor).value())) {
+      creaseCount++;
+      for (int i = 0; i < 3; i++) {
+        crease[i] += p.v[i];
+      }
+    }
+  }
+
+  // A single crease edge is a dart, which fades the crease out, so the vertex
+  // is smooth. Two is a crease vertex, and three or more is a corner.
+  auto const& p = positions[vertex];
+  if (creaseCount <= 1 && !neighbors.empty()) {
+    float beta = getLoopBeta(neighbors.size());
+    float self = 1.0f - beta * neighbors.size();
+    return Vector3{ self * p.v[0] + beta * sum[0],
+                    self * p.v[1] + beta * sum[1],
+                    self * p.v[2] + beta * sum[2] };
+  }
+  if (creaseCount == 2) {
+    return Vector3{ 0.75f * p.v[0] + 0.125f * crease[0],
+                    0.75f * p.v[1] + 0.125f * crease[1],
+                    0.75f * p.v[2] + 0.125f * crease[2] };
+  }
+  return p;
+}
+
+static Vector3
+getOddPosition(MeshAdjacency const& adjacency,
+               Cells const& cells,
+               std::span<const Vector3> positions,
+               uint32_t edge)
+{
+  auto [a, b] = adjacency.GetEdges()[edge];
+  auto const& pa = positions[a];
+  auto const& pb = positions[b];
+  if (isCreaseEdge(adjacency, edge)) {
+    return Vector3{ 0.5f * (pa.v[0] + pb.v[0]),
+                    0.5f * (pa.v[1] + pb.v[1]),
+                    0.5f * (pa.v[2] + pb.v[2]) };
+  }
+
+  float opposite[3] = { 0, 0, 0 };
+  for (auto cellIndex : adjacency.GetEdgeCells(edge)) {
+    for (auto index : cells[cellIndex]) {
+      if (index != a && index != b) {
+        for (int i = 0; i < 3; i++) {
+          opposite[i] += positions[index].v[i];
+        }
+      }
+    }
+  }
+  return Vector3{ 0.375f * (pa.v[0] + pb.v[0]) + 0.125f * opposite[0],
+                  0.375f * (pa.v[1] + pb.v[1]) + 0.125f * opposite[1],
+                  0.375f * (pa.v[2] + pb.v[2]) + 0.125f * opposite[2] };
+}
+
+static float
+getDistanceSquared(Vector3 const& a, Vector3 const& b)
+{
+  float x = a.v[0] - b.v[0];
+  float y = a.v[1] - b.v[1];
+  float z = a.v[2] - b.v[2];
+  return x * x + y * y + z * z;
+}
+
+/**
+ * Write the children of a cell, given the new vertex on each of its edges, or
+ * NO_EDGE where the edge isn't split. Returns how many children there are.
+ * Passing no output only counts them.
+ */
+static uint32_t
+splitCell(std::array<uint32_t, 3> const& cell,
+          std::array<uint32_t, 3> const& mids,
+          std::span<const Vector3> positions,
+          std::array<uint32_t, 3>* output)
+{
+  uint32_t splitCount = (mids[0] != NO_EDGE) + (mids[1] != NO_EDGE) +
+                        (mids[2] != NO_EDGE);
+  if (output == nullptr) {
+    return splitCount + 1;
+  }
+
+  switch (splitCount) {
+    case 0:
+      output[0] = cell;
+      break;
+    case 1: {
+      // Bisect from the split edge to the vertex across from it.
+      uint32_t i = mids[0] != NO_EDGE ? 0 : (mids[1] != NO_EDGE ? 1 : 2);
+      uint32_t a = cell[i];
+      uint32_t b = cell[(i + 1) % 3];
+      uint32_t c = cell[(i + 2) % 3];
+      output[0] = { a, mids[i], c };
+      output[1] = { mids[i], b, c };
+      break;
+    }
+    case 2: {
+      // Cut off the corner between the split edges, and then cut the quad
+      // that is left along its shorter diagonal.
+      uint32_t i = mids[0] == NO_EDGE ? 0 : (mids[1] == NO_EDGE ? 1 : 2);
+      uint32_t a = cell[i];
+      uint32_t b = cell[(i + 1) % 3];
+      uint32_t c = cell[(i + 2) % 3];
+      uint32_t midBc = mids[(i + 1) % 3];
+      uint32_t midCa = mids[(i + 2) % 3];
+      output[0] = { c, midCa, midBc };
+      if (getDistanceSquared(positions[a], positions[midBc]) <=
+          getDistanceSquared(positions[b], positions[midCa])) {
+        output[1] = { a, b, midBc };
+        output[2] = { a, midBc, midCa };
+      } else {
+        output[1] = { a, b, midCa };
+        output[2] = { b, midBc, midCa };
+      }
+      break;
+    }
+    default:
+      output[0] = { cell[0], mids[0], mids[2] };
+      output[1] = { cell[1], mids[1], mids[0] };
+      output[2] = { cell[2], mids[2], mids[1] };
+      output[3] = { mids[0], mids[1], mids[2] };
+      break;
+  }
+  return splitCount + 1;
+}
+
+void
+loopSubdivide(Mesh& mesh, std::span<const uint8_t> refineCells)
+{
+  ReleaseAssert(refineCells.size() == mesh.cells.size(),
+                "There must be one refine flag per cell.");
+  auto vertexCount = static_cast<uint32_t>(mesh.positions.size());
+  MeshAdjacency adjacency{ mesh };
+
+  // An edge is split when any of its cells is refined, and each split edge
+  // gets the next new vertex.
+  std::vector<uint32_t> edgeToVertex(adjacency.GetEdgeCount());
+  ParallelFor(edgeToVertex.size(), 4096, [&](size_t edge) {
+    bool split = false;
+    for (auto cell : adjacency.GetEdgeCells(edge)) {
+      split = split || refineCells[cell] != 0;
+    }
+    edgeToVertex[edge] = split ? 1 : 0;
+  });
+  uint32_t nextVertex = vertexCount;
+  for (auto& vertex : edgeToVertex) {
+    vertex = vertex ? nextVertex++ : NO_EDGE;
+  }
+
+  // Only the vertices on a split edge move.
+  std::vector<uint8_t> moved(vertexCount, 0);
+  for (uint32_t edge = 0; edge < edgeToVertex.size(); edge++) {
+    if (edgeToVertex[edge] != NO_EDGE) {
+      auto [a, b] = adjacency.GetEdges()[edge];
+      moved[a] = 1;
+      moved[b] = 1;
+    }
+  }
+
+  Positions positions(nextVertex, Vector3{ 0.0f, 0.0f, 0.0f });
+  ParallelFor(vertexCount, 4096, [&](size_t vertex) {
+    positions[vertex] = moved[vertex]
+                          ? getEvenPosition(adjacency, mesh.positions, vertex)
+                          : mesh.positions[vertex];
+  });
+  ParallelFor(edgeToVertex.size(), 4096, [&](size_t edge) {
+    if (edgeToVertex[edge] != NO_EDGE) {
+      positions[edgeToVertex[edge]] =
+        getOddPosition(adjacency, mesh.cells, mesh.positions, edge);
+    }
+  });
+
+  if (mesh.uvs.size() == vertexCount) {
+    mesh.uvs.resize(nextVertex, Vector2{ 0.0f, 0.0f });
+    ParallelFor(edgeToVertex.size(), 4096, [&](size_t edge) {
+      if (edgeToVertex[edge] != NO_EDGE) {
+        auto [a, b] = adjacency.GetEdges()[edge];
+        mesh.uvs[edgeToVertex[edge]] =
+          Vector2{ (mesh.uvs[a][0] + mesh.uvs[b][0]) * 0.5f,
+                   (mesh.uvs[a][1] + mesh.uvs[b][1]) * 0.5f };
+      }
+    });
+  }
+
+  // Count the children of every cell, so that each one knows where to write.
+  auto getMids = [&](size_t cell) {
+    auto const& edges = adjacency.GetCellEdges(cell);
+    std::array<uint32_t, 3> mids{};
+    for (int i = 0; i < 3; i++) {
+      mids[i] = edges[i] == NO_EDGE ? NO_EDGE : edgeToVertex[edges[i]];
+    }
+    return mids;
+  };
+  std::vector<uint32_t> cellOffsets(mesh.cells.size() + 1, 0);
+  ParallelFor(mesh.cells.size(), 4096, [&](size_t cell) {
+    cellOffsets[cell + 1] =
+      splitCell(mesh.cells[cell], getMids(cell), positions, nullptr);
+  });
+  for (size_t i = 0; i < mesh.cells.size(); i++) {
+    cellOffsets[i + 1] += cellOffsets[i];
+  }
+
+  Cells cells(cellOffsets.back());
+  ParallelFor(mesh.cells.size(), 4096, [&](size_t cell) {
+    splitCell(mesh.cells[cell],
+              getMids(cell),
+              positions,
+              cells.data() + cellOffsets[cell]);
+  });
+
+  bool hasNormals = mesh.normals.size() == vertexCount;
+  mesh.positions = std::move(positions);
+  mesh.cells = std::move(cells);
+  if (hasNormals) {
+    computeAngleNormals(mesh);
+  }
+}
+
+void
+loopSubdivide(Mesh& mesh)
+{
+  std::vector<uint8_t> refineCells(mesh.cells.size(), 1);
+  loopSubdivide(mesh, refineCells);
+}
+
+} // namespace viz
@@ -0,0 +1,72 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include "viz/parallel.h"
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * Split every triangle of a mesh into four, by adding a vertex at the midpoint
+ * of every edge. The newly created geometry is not smoothed or moved.
+ *
+ * Midpoints are shared between the cells on either side of an edge, and are
+ * appended after the existing vertices in the order the edges are first
+ * visited. Normals and uvs are interpolated when the mesh has one per vertex.
+ */
+void
+subdivide(Mesh& mesh);
+
+/**
+ * One step of Loop subdivision, which splits every triangle into four and
+ * smooths the result, so that repeated steps converge to a smooth surface.
+ *
+ * The existing vertices keep their indices and are moved by the even stencil,
+ * which blends each vertex with its one ring. A new vertex is appended for
+ * every edge, in the sorted edge order of MeshAdjacency, and placed by the odd
+ * stencil, from the edge and the two vertices across from it. Both stencils
+ * are computed in parallel, and only read the old positions.
+ *
+ * Edges that don't have exactly two cells, such as boundaries, are treated as
+ * creases. A vertex on one crease edge is a dart, and is smoothed like any
+ * other. A vertex on two only blends along the crease, with the cubic B-spline
+ * rules, and a vertex on three or more is a corner, and stays put.
+ *
+ * The uvs are interpolated linearly. The normals are recomputed as angle
+ * weighted normals when the mesh has one per vertex, as the smoothing moves
+ * the surface.
+ */
+void
+loopSubdivide(Mesh& mesh);
+
+/**
+ * Loop subdivision on just the cells that are non-zero in refineCells, which
+ * has one entry per cell. Only the edges of those cells are split, and only
+ * the vertices on a split edge are moved.
+ *
+ * The cells next to a refined region keep the mesh watertight with a red
+ * green refinement. A cell with every edge split becomes four cells, and a
+ * cell with one or two split edges is cut into two or three cells, without
+ * adding any more vertices.
+ */
+void
+loopSubdivide(Mesh& mesh, std::span<const uint8_t> refineCells);
+
+/**
+ * Adaptive Loop subdivision of the cells that pass the predicate, such as the
+ * cells that are large on screen. The predicate is called in parallel as:
+ *
+ * (uint32_t cellIndex) -> bool
+ */
+template<typename Predicate>
+void
+loopSubdivideWhere(Mesh& mesh, Predicate predicate)
+{
+  std::vector<uint8_t> refineCells(mesh.cells.size());
+  ParallelFor(refineCells.size(), 4096, [&](size_t cell) {
+    refineCells[cell] = predicate(static_cast<uint32_t>(cell)) ? 1 : 0;
+  });
+  loopSubdivide(mesh, refineCells);
+}
+
+} // namespace viz
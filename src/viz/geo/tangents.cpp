@@ -0,0 +1,160 @@
+#include "viz/geo/tangents.h"
+#include "viz/assert.h"
+#include "viz/geo/adjacency.h"
+#include "viz/parallel.h"
+#include <cmath>
+#include <limits>
+
+namespace viz {
+
+// MikkTSpace only normalizes vectors that are longer than this, and otherwise
+// leaves them as they are.
+static const float MIN_LENGTH = std::numeric_limits<float>::min();
+
+/**
+ * A cell's unit tangent, and whether its uv mapping keeps the winding of the
+ * cell, which is 1, or mirrors it, which is -1. Cells with degenerate uvs have
+ * an orientation of 0, and add nothing.
+ */
+struct TangentCell
+{
+  simd::float3 tangent;
+  float orientation;
+};
+
+static simd::float3
+toFloat3(Vector3 const& vector)
+{
+  return simd::float3{ vector.v[0], vector.v[1], vector.v[2] };
+}
+
+static simd::float3
+normalizeOrKeep(simd::float3 vector)
+{
+  float length = simd::length(vector);
+  return length > MIN_LENGTH ? vector * (1.0f / length) : vector;
+}
+
+// Remove the part of the vector along the unit normal.
+static simd::float3
+projectOntoPlane(simd::float3 vector, simd::float3 normal)
+{
+  return vector - normal * simd::dot(normal, vector);
+}
+
+static TangentCell
+getTangentCell(std::array<uint32_t, 3> const& cell,
+               std::span<const Vector3> positions,
+               std::span<const Vector2> uvs)
+{
+  simd::float3 edge1 = toFloat3(positions[cell[1]]) -
+                       toFloat3(positions[cell[0]]);
+  simd::float3 edge2 = toFloat3(positions[cell[2]]) -
+                       toFloat3(positions[cell[0]]);
+  float u1 = uvs[cell[1]].v[0] - uvs[cell[0]].v[0];
+  float v1 = uvs[cell[1]].v[1] - uvs[cell[0]].v[1];
+  float u2 = uvs[cell[2]].v[0] - uvs[cell[0]].v[0];
+  float v2 = uvs[cell[2]].v[1] - uvs[cell[0]].v[1];
+
+  // Twice the signed area of the cell in uv space.
+  float area = u1 * v2 - v1 * u2;
+  if (std::abs(area) <= MIN_LENGTH) {
+    return { simd::float3{ 0, 0, 0 }, 0 };
+  }
+
+  float orientation = area > 0 ? 1 : -1;
+  simd::float3 tangent = edge1 * v2 - edge2 * v1;
+  float length = simd::length(tangent);
+  if (length > MIN_LENGTH) {
+    tangent = tangent * (orientation / length);
+  }
+  return { tangent, orientation };
+}
+
+// Any unit vector orthogonal to the normal, for vertices without a tangent.
+static simd::float3
+getOrthogonal(simd::float3 normal)
+{
+  simd::float3 axis = std::abs(normal[0]) < 0.9f ? simd::float3{ 1, 0, 0 }
+                                                 : simd::float3{ 0, 1, 0 };
+  return normalizeOrKeep(projectOntoPlane(axis, normal));
+}
+
+static simd::float4
+gatherTangent(std::span<const std::array<uint32_t, 3>> cells,
+              std::span<const Vector3> positions,
+              std::span<const Vector3> normals,
+              VertexCorners const& vertexCorners,
+              std::span<const TangentCell> tangentCells,
+              uint32_t vertex)
+{
+  simd::float3 normal = toFloat3(normals[vertex]);
+  simd::float3 position = toFloat3(positions[vertex]);
+  simd::float3 sum{ 0, 0, 0 };
+  float handedness = 0;
+
+  for (auto corner : vertexCorners.Get(vertex)) {
+    auto const& tangentCell = tangentCells[corner / 3];
+    if (tangentCell.orientation == 0) {
+      continue;
+    }
+
+    // The corner angle is measured in the plane of the vertex's normal.
+    auto const& cell = cells[corner / 3];
+    uint32_t i = corner % 3;
+    simd::float3 next = normalizeOrKeep(projectOntoPlane(
+      toFloat3(positions[cell[(i + 1) % 3]]) - position, normal));
+    simd::float3 previous = normalizeOrKeep(projectOntoPlane(
+      toFloat3(positions[cell[(i + 2) % 3]]) - position, normal));
+    float angle =
+      std::acos(std::min(1.0f, std::max(-1.0f, simd::dot(next, previous))));
+
+    sum += angle *
+           normalizeOrKeep(projectOntoPlane(tangentCell.tangent, normal));
+    handedness += angle * tangentCell.orientation;
+  }
+
+  // Keep the sum in the plane, in case the vertex has no valid normal.
+  simd::float3 tangent = projectOntoPlane(sum, normal);
+  float length = simd::length(tangent);
+  tangent = length > MIN_LENGTH ? tangent * (1.0f / length)
+                                : getOrthogonal(normal);
+  return simd::float4{
+    tangent[0], tangent[1], tangent[2], handedness < 0 ? -1.0f : 1.0f
+  };
+}
+
+void
+computeTangents(std::span<const std::array<uint32_t, 3>> cells,
+                std::span<const Vector3> positions,
+                std::span<const Vector3> normals,
+                std::span<const Vector2> uvs,
+                std::span<simd::float4> tangents)
+{
+  size_t vertexCount = positions.size();
+  ReleaseAssert(normals.size() == vertexCount && uvs.size() == vertexCount &&
+                  tangents.size() == vertexCount,
+                "Tangents need one normal, uv, and tangent per position.");
+
+  auto vertexCorners = buildVertexCorners(cells, vertexCount);
+
+  std::vector<TangentCell> tangentCells(cells.size());
+  ParallelFor(cells.size(), 4096, [&](size_t cell) {
+    tangentCells[cell] = getTangentCell(cells[cell], positions, uvs);
+  });
+
+  ParallelFor(vertexCount, 4096, [&](size_t vertex) {
+    tangents[vertex] = gatherTangent(
+      cells, positions, normals, vertexCorners, tangentCells, vertex);
+  });
+}
+
+std::vector<simd::float4>
+computeTangents(Mesh const& mesh)
+{
+  std::vector<simd::float4> tangents(mesh.positions.size());
+  computeTangents(mesh.cells, mesh.positions, mesh.normals, mesh.uvs, tangents);
+  return tangents;
+}
+
+} // namespace viz
@@ -0,0 +1,42 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * Per vertex tangents for normal mapping, following the MikkTSpace
+ * construction. The xyz is the unit tangent, which points along +u, and the w
+ * is the handedness, 1 or -1, so that the shader rebuilds the bitangent as:
+ *
+ * float3 bitangent = tangent.w * cross(normal, tangent.xyz);
+ *
+ * Each cell's tangent comes from its uv mapping. Every vertex then gathers the
+ * tangents of its cells, projected onto the plane of its normal, and weighted
+ * by the corner angle. The cells are computed in parallel first, and then the
+ * vertices, so the threads never write to shared memory, and the result is the
+ * same on any number of threads.
+ *
+ * The normals must already be computed, as the tangents are made orthogonal to
+ * them. A vertex that only touches cells with degenerate uvs still gets a
+ * tangent, along any direction orthogonal to its normal.
+ *
+ * e.g. Upload the tangents next to the mesh's other buffers:
+ *
+ * MeshBuffers buffers(device, mesh, options);
+ * BufferViewList<simd::float4> tangents(
+ *   computeTangents(mesh), device, options);
+ */
+void
+computeTangents(std::span<const std::array<uint32_t, 3>> cells,
+                std::span<const Vector3> positions,
+                std::span<const Vector3> normals,
+                std::span<const Vector2> uvs,
+                std::span<simd::float4> tangents);
+
+std::vector<simd::float4>
+computeTangents(Mesh const& mesh);
+
+} // namespace viz
@@ -0,0 +1,244 @@
+#include "viz/geo/vertex-cache.h"
+#include "viz/assert.h"
+#include <algorithm> // std::find
+#include <cmath>
+#include <vector>
+
+namespace viz {
+
+// The optimizer scores vertices against an LRU cache of this size. The actual
+// hardware cache doesn't need to match it, the order works well for any cache
+// that is about this size or smaller.
+static const uint32_t SCORE_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_CELL_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+static const uint32_t NO_CELL = ~0u;
+
+/**
+ * The score tables are only computed once, as the pow calls are the slowest part
+ * of the scoring.
+ */
+struct VertexScoreTable
+{
+  std::array<float, SCORE_CACHE_SIZE> cache;
+  std::array<float, 64> valence;
+
+  VertexScoreTable()
+  {
+    for (uint32_t i = 0; i < SCORE_CACHE_SIZE; i++) {
+      if (i < 3) {
+        // The vertices of the last cell are scored the same, as the cell was
+        // just drawn, and the order within it doesn't matter.
+        cache[i] = LAST_CELL_SCORE;
+      } else {
+        float scale = 1.0f / (SCORE_CACHE_SIZE - 3);
+        cache[i] = std::pow(1.0f - (i - 3) * scale, CACHE_DECAY_POWER);
+      }
+    }
+    for (uint32_t i = 0; i < valence.size(); i++) {
+      valence[i] = i == 0 ? 0.0f : getValenceBoost(i);
+    }
+  }
+
+  // Boost vertices with few cells left, so that lone cells get finished rather
+  // than left behind.
+  static float getValenceBoost(uint32_t remaining)
+  {
+    return VALENCE_BOOST_SCALE *
+           std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+  }
+
+  float GetScore(int32_t cachePosition, uint32_t remaining) const
+  {
+    if (remaining == 0) {
+      return -1.0f;
+    }
+    float score = cachePosition < 0 ? 0.0f : cache[cachePosition];
+    return score + (remaining < valence.size() ? valence[remaining]
+                                               : getValenceBoost(remaining));
+  }
+};
+
+VertexCacheStats
+analyzeVertexCache(std::span<const std::array<uint32_t, 3>> cells,
+                   size_t vertexCount,
+                   uint32_t cacheSize)
+{
+  // A vertex is in the FIFO if fewer than cacheSize vertices have been pushed
+  // since it was. A timestamp of 0 means it was never transformed.
+  std::vector<uint32_t> timestamps(vertexCount, 0);
+  uint32_t time = cacheSize + 1;
+  size_t transformCount = 0;
+  size_t referencedCount = 0;
+
+  for (auto const& cell : cells) {
+    for (auto index : cell) {
+      DebugAssert(index < vertexCount, "A cell index is out of range.");
+      if (time - timestamps[index] > cacheSize) {
+        referencedCount += timestamps[index] == 0;
+        timestamps[index] = time++;
+        transformCount++;
+      }
+    }
+  }
+
+  return VertexCacheStats{
+    .acmr = cells.empty() ? 0.0f
+                          : static_cast<float>(transformCount) / cells.size(),
+    .atvr = referencedCount == 0
+              ? 0.0f
+              : static_cast<float>(transformCount) / referencedCount,
+    .transformCount = transformCount,
+  };
+}
+
+void
+optimizeVertexCache(std::span<const std::array<uint32_t, 3>> input,
+                    std::span<std::array<uint32_t, 3>> output,
+                    size_t vertexCount)
+{
+  ReleaseAssert(input.size() == output.size(),
+                "The vertex cache output must be the same size as the input.");
+  static const VertexScoreTable scores{};
+  size_t cellCount = input.size();
+  if (cellCount == 0) {
+    return;
+  }
+
+  // Build the vertex to cell adjacency as a compressed list. Each vertex's list
+  // only keeps the cells that haven't been emitted yet, at the front.
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  for (auto const& cell : input) {
+    for (auto index : cell) {
+      ReleaseAssert(index < vertexCount, "A cell index is out of range.");
+      offsets[index + 1]++;
+    }
+  }
+  for (size_t i = 0; i < vertexCount; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<uint32_t> adjacency(cellCount * 3);
+  std::vector<uint32_t> remaining(vertexCount, 0);
+  for (uint32_t cellIndex = 0; cellIndex < cellCount; cellIndex++) {
+    for (auto index : input[cellIndex]) {
+      adjacency[offsets[index] + remaining[index]++] = cellIndex;
+    }
+  }
+
+  std::vector<int32_t> cachePositions(vertexCount, -1);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t i = 0; i < vertexCount; i++) {
+    vertexScores[i] = scores.GetScore(-1, remaining[i]);
+  }
+
+  auto getCellScore = [&](uint32_t cellIndex) {
+    auto const& cell = input[cellIndex];
+    return vertexScores[cell[0]] + vertexScores[cell[1]] +
+           vertexScores[cell[2]];
+  };
+
+  std::vector<uint8_t> emitted(cellCount, 0);
+  uint32_t bestCell = 0;
+  float bestScore = -1.0f;
+  for (uint32_t cellIndex = 0; cellIndex < cellCount; cellIndex++) {
+    float score = getCellScore(cellIndex);
+    if (score > bestScore) {
+      bestScore = score;
+      bestCell = cellIndex;
+    }
+  }
+
+  // Leave room for the 3 vertices that get pushed before the cache is trimmed.
+  std::array<uint32_t, SCORE_CACHE_SIZE + 3> cache;
+  std::array<uint32_t, SCORE_CACHE_SIZE + 3> nextCache;
+  size_t cacheCount = 0;
+  size_t scanCursor = 0;
+
+  for (size_t outputIndex = 0; outputIndex < cellCount; outputIndex++) {
+    if (bestCell == NO_CELL) {
+      // Nothing in the cache touches a remaining cell, so start a new strip
+      // from the next cell in the input order.
+      while (emitted[scanCursor]) {
+        scanCursor++;
+      }
+      bestCell = scanCursor;
+    }
+
+    auto const& cell = input[bestCell];
+    output[outputIndex] = cell;
+    emitted[bestCell] = 1;
+
+    // Remove the cell from its vertices' remaining lists.
+    for (auto index : cell) {
+      uint32_t* begin = &adjacency[offsets[index]];
+      uint32_t* last = begin + --remaining[index];
+      for (uint32_t* it = begin; it <= last; it++) {
+        if (*it == bestCell) {
+          std::swap(*it, *last);
+          break;
+        }
+      }
+    }
+
+    // Push the cell's vertices to the front of the LRU cache.
+    size_t nextCount = 0;
+    for (auto index : cell) {
+      if (std::find(nextCache.begin(), nextCache.begin() + nextCount, index) ==
+          nextCache.begin() + nextCount) {
+        nextCache[nextCount++] = index;
+      }
+    }
+    for (size_t i = 0; i < cacheCount; i++) {
+      uint32_t index = cache[i];
+      if (index != cell[0] && index != cell[1] && index != cell[2]) {
+        nextCache[nextCount++] = index;
+      }
+    }
+
+    // Rescore the vertices in the cache, including the ones that just fell
+    // out of it.
+    for (size_t i = 0; i < nextCount; i++) {
+      uint32_t index = nextCache[i];
+      cachePositions[index] = i < SCORE_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+      vertexScores[index] = scores.GetScore(cachePositions[index], remaining[index]);
+    }
+
+    // Only cells that touch the cache changed their score, so the next best
+    // cell is picked from those.
+    bestCell = NO_CELL;
+    bestScore = -1.0f;
+    for (size_t i = 0; i < nextCount; i++) {
+      uint32_t index = nextCache[i];
+      for (uint32_t j = 0; j < remaining[index]; j++) {
+        uint32_t cellIndex = adjacency[offsets[index] + j];
+        float score = getCellScore(cellIndex);
+        if (score > bestScore) {
+          bestScore = score;
+          bestCell = cellIndex;
+        }
+      }
+    }
+
+    cacheCount = std::min<size_t>(nextCount, SCORE_CACHE_SIZE);
+    std::copy(nextCache.begin(), nextCache.begin() + cacheCount, cache.begin());
+  }
+}
+
+VertexCacheReport
+optimizeVertexCache(Mesh& mesh, uint32_t cacheSize)
+{
+  size_t vertexCount = mesh.positions.size();
+  VertexCacheReport report{};
+  report.before = analyzeVertexCache(mesh.cells, vertexCount, cacheSize);
+
+  Cells cells(mesh.cells.size());
+  optimizeVertexCache(mesh.cells, cells, vertexCount);
+  mesh.cells = std::move(cells);
+
+  report.after = analyzeVertexCache(mesh.cells, vertexCount, cacheSize);
+  return report;
+}
+
+} // namespace viz
@@ -0,0 +1,55 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <span>
+
+namespace viz {
+
+/**
+ * How well a cell order reuses the GPU's post-transform vertex cache.
+ */
+struct VertexCacheStats
+{
+  // Average cache miss ratio, the vertex shader invocations per triangle. This
+  // is 3 for no reuse, and approaches 0.5 for large regular meshes.
+  float acmr = 0;
+  // Average transform to vertex ratio, the vertex shader invocations per
+  // referenced vertex. 1 is the best possible result.
+  float atvr = 0;
+  size_t transformCount = 0;
+};
+
+struct VertexCacheReport
+{
+  VertexCacheStats before;
+  VertexCacheStats after;
+};
+
+/**
+ * Simulate a FIFO post-transform cache of the given size over the cells, which
+ * is what most GPUs approximate.
+ */
+VertexCacheStats
+analyzeVertexCache(std::span<const std::array<uint32_t, 3>> cells,
+                   size_t vertexCount,
+                   uint32_t cacheSize = 16);
+
+/**
+ * Reorder the cells to maximize post-transform vertex cache hits, using Tom
+ * Forsyth's linear-speed vertex cache optimisation. The input and output must
+ * be the same length, and must not overlap. The vertices are not moved.
+ */
+void
+optimizeVertexCache(std::span<const std::array<uint32_t, 3>> input,
+                    std::span<std::array<uint32_t, 3>> output,
+                    size_t vertexCount);
+
+/**
+ * Reorder the mesh's cells in place, and report the cache behavior before and
+ * after for a FIFO cache of the given size. This is meant to be run once, when
+ * a mesh is loaded or baked.
+ */
+VertexCacheReport
+optimizeVertexCache(Mesh& mesh, uint32_t cacheSize = 16);
+
+} // namespace viz
@@ -0,0 +1,50 @@
+#include "viz/geo/vertex-fetch.h"
+#include "viz/assert.h"
+
+namespace viz {
+
+size_t
+remapCellsByFirstUse(std::span<std::array<uint32_t, 3>> cells,
+                     std::span<uint32_t> remap)
+{
+  std::fill(remap.begin(), remap.end(), UNUSED_VERTEX);
+  uint32_t nextIndex = 0;
+
+  for (auto& cell : cells) {
+    for (auto& index : cell) {
+      ReleaseAssert(index < remap.size(), "A cell index is out of range.");
+      if (remap[index] == UNUSED_VERTEX) {
+        remap[index] = nextIndex++;
+      }
+      index = remap[index];
+    }
+  }
+  return nextIndex;
+}
+
+// Attributes that aren't per-vertex, such as missing uvs, are left alone.
+template<typename List>
+static void
+remapVertexList(List& list, std::span<const uint32_t> remap, size_t usedCount)
+{
+  if (list.size() != remap.size() || list.empty()) {
+    return;
+  }
+  List result(usedCount, list[0]);
+  remapVertexStream<typename List::value_type>(list, result, remap);
+  list = std::move(result);
+}
+
+std::vector<uint32_t>
+optimizeVertexFetch(Mesh& mesh)
+{
+  std::vector<uint32_t> remap(mesh.positions.size());
+  size_t usedCount = remapCellsByFirstUse(mesh.cells, remap);
+
+  remapVertexList(mesh.positions, remap, usedCount);
+  remapVertexList(mesh.normals, remap, usedCount);
+  remapVertexList(mesh.uvs, remap, usedCount);
+  return remap;
+}
+
+} // namespace viz
@@ -0,0 +1,50 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+/**
+ * The remap value for vertices that no cell references.
+ */
+static const uint32_t UNUSED_VERTEX = ~0u;
+
+/**
+ * Rewrite the cells' indices into the order that the vertices are first
+ * referenced, and fill in remap[oldIndex] = newIndex. Unreferenced vertices are
+ * given UNUSED_VERTEX. The remap must have one entry per vertex. Returns the
+ * number of vertices that are still used.
+ */
+size_t
+remapCellsByFirstUse(std::span<std::array<uint32_t, 3>> cells,
+                     std::span<uint32_t> remap);
+
+/**
+ * Move every used vertex of a stream to its remapped index. The output must
+ * have room for the used vertex count, and must not overlap the input.
+ */
+template<typename T>
+void
+remapVertexStream(std::span<const T> input,
+                  std::span<T> output,
+                  std::span<const uint32_t> remap)
+{
+  for (size_t i = 0; i < input.size(); i++) {
+    if (remap[i] != UNUSED_VERTEX) {
+      output[remap[i]] = input[i];
+    }
+  }
+}
+
+/**
+ * Reorder the mesh's vertices into the order the cells first reference them,
+ * and drop the ones that are never referenced. This keeps vertex fetches close
+ * together in memory, and should be run after the cells have been reordered.
+ * Returns the remap table from old to new vertex indices.
+ */
+std::vector<uint32_t>
+optimizeVertexFetch(Mesh& mesh);
+
+} // namespace viz
@@ -0,0 +1,369 @@
+#include "viz/geo/vertex-layout.h"
+#include "viz/assert.h"
+#include "viz/geo/mesh.h"
+#include "viz/geo/quantize.h"
+#include "viz/parallel.h"
+#include <cstring> // std::memcpy
+
+namespace viz {
+
+static bool
+isFloatFormat(mtlpp::VertexFormat format)
+{
+  switch (format) {
+    case mtlpp::VertexFormat::Float:
+    case mtlpp::VertexFormat::Float2:
+    case mtlpp::VertexFormat::Float3:
+    case mtlpp::VertexFormat::Float4:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static uint32_t
+getVertexFormatComponents(mtlpp::VertexFormat format)
+{
+  switch (format) {
+    case mtlpp::VertexFormat::Float:
+      return 1;
+    case mtlpp::VertexFormat::Float2:
+    case mtlpp::VertexFormat::Half2:
+    case mtlpp::VertexFormat::Short2Normalized:
+    case mtlpp::VertexFormat::UShort2Normalized:
+      return 2;
+    case mtlpp::VertexFormat::Float3:
+      return 3;
+    case mtlpp::VertexFormat::Float4:
+    case mtlpp::VertexFormat::Half4:
+      return 4;
+    default:
+      throw ErrorMessage("The vertex layout does not support this format.");
+  }
+}
+
+uint32_t
+getVertexFormatSize(mtlpp::VertexFormat format)
+{
+  uint32_t componentSize =
+    isFloatFormat(format) ? sizeof(float) : sizeof(uint16_t);
+  return getVertexFormatComponents(format) * componentSize;
+}
+
+VertexLayout
+getFloat3VertexLayout()
+{
+  return {
+    .attributes = {
+      { VertexAttribute::Position, mtlpp::VertexFormat::Float3 },
+      { VertexAttribute::Normal, mtlpp::VertexFormat::Float3 },
+    },
+    .interleaved = false,
+  };
+}
+
+VertexLayoutTable
+compileVertexLayout(VertexLayout const& layout)
+{
+  VertexLayoutTable table{};
+
+  for (auto const& [attribute, format] : layout.attributes) {
+    uint32_t size = getVertexFormatSize(format);
+
+    // The 16 bit normalized formats are specific encodings, rather than a
+    // plain conversion, so they only make sense for one attribute each.
+    if (format == mtlpp::VertexFormat::Short2Normalized &&
+        attribute != VertexAttribute::Normal) {
+      throw ErrorMessage("Short2Normalized is only supported for octahedral "
+                         "normals.");
+    }
+    if (format == mtlpp::VertexFormat::UShort2Normalized &&
+        attribute != VertexAttribute::UV) {
+      throw ErrorMessage("UShort2Normalized is only supported for uvs.");
+    }
+
+    if (layout.interleaved) {
+      if (table.strides.empty()) {
+        table.strides.push_back(0);
+      }
+      table.attributes.push_back({ attribute, format, 0, table.strides[0] });
+      table.strides[0] += size;
+    } else {
+      uint32_t bufferIndex = table.strides.size();
+      table.attributes.push_back({ attribute, format, bufferIndex, 0 });
+      table.strides.push_back(size);
+    }
+  }
+
+  return table;
+}
+
+/**
+ * A view of one of the mesh's attribute streams, as packed floats.
+ */
+struct AttributeSource
+{
+  const float* data;
+  uint32_t components;
+  size_t count;
+  // The value of the w component, if it is asked for.
+  float w;
+};
+
+static AttributeSource
+getAttributeSource(Mesh const& mesh, VertexAttribute attribute)
+{
+  switch (attribute) {
+    case VertexAttribute::Position:
+      return { mesh.positions[0].v, 3, mesh.positions.size(), 1.0f };
+    case VertexAttribute::Normal:
+      ReleaseAssert(mesh.normals.size() == mesh.positions.size(),
+                    "The vertex layout needs normals, but the mesh has none.");
+      return { mesh.normals[0].v, 3, mesh.normals.size(), 0.0f };
+    case VertexAttribute::UV:
+      ReleaseAssert(mesh.uvs.size() == mesh.positions.size(),
+                    "The vertex layout needs uvs, but the mesh has none.");
+      return { mesh.uvs[0].v, 2, mesh.uvs.size(), 0.0f };
+  }
+  throw ErrorMessage("Unknown VertexAttribute");
+}
+
+// The component counts are template parameters so that each combination gets
+// its own tight loop, which the compiler can unroll and vectorize.
+template<uint32_t SourceComponents, uint32_t DestComponents>
+static void
+packAttributeRange(AttributeSource const& source,
+                   uint8_t* destination,
+                   uint32_t stride,
+                   size_t begin,
+                   size_t end)
+{
+  for (size_t i = begin; i < end; i++) {
+    const float* input = source.data + i * SourceComponents;
+    float value[DestComponents];
+    for (uint32_t c = 0; c < DestComponents; c++) {
+      value[c] = c < SourceComponents ? input[c] : (c == 3 ? source.w : 0.0f);
+    }
+    std::memcpy(destination + i * stride, value, sizeof(value));
+  }
+}
+
+template<uint32_t SourceComponents>
+static void
+packAttributeRange(AttributeSource const& source,
+                   uint32_t destComponents,
+                   uint8_t* destination,
+                   uint32_t stride,
+                   size_t begin,
+                   size_t end)
+{
+  switch (destComponents) {
+    case 1:
+      return packAttributeRange<SourceComponents, 1>(
+        source, destination, stride, begin, end);
+    case 2:
+      return packAttributeRange<SourceComponents, 2>(
+        source, destination, stride, begin, end);
+    case 3:
+      return packAttributeRange<SourceComponents, 3>(
+        source, destination, stride, begin, end);
+    case 4:
+      return packAttributeRange<SourceComponents, 4>(
+        source, destination, stride, begin, end);
+  }
+}
+
+/**
+ * Pack an attribute into one of the quantized formats from viz/geo/quantize.h.
+ */
+static void
+packQuantizedAttributeRange(AttributeSource const& source,
+                            mtlpp::VertexFormat format,
+                            uint8_t* destination,
+                            uint32_t stride,
+                            size_t begin,
+                            size_t end)
+{
+  switch (format) {
+    case mtlpp::VertexFormat::Half2:
+    case mtlpp::VertexFormat::Half4: {
+      uint32_t destComponents = getVertexFormatComponents(format);
+      for (size_t i = begin; i < end; i++) {
+        const float* input = source.data + i * source.components;
+        uint16_t value[4];
+        for (uint32_t c = 0; c < destComponents; c++) {
+          value[c] = encodeHalf(c < source.components
+                                  ? input[c]
+                                  : (c == 3 ? source.w : 0.0f));
+        }
+        std::memcpy(destination + i * stride,
+                    value,
+                    destComponents * sizeof(uint16_t));
+      }
+      return;
+    }
+    case mtlpp::VertexFormat::Short2Normalized:
+      for (size_t i = begin; i < end; i++) {
+        const float* input = source.data + i * source.components;
+        uint32_t value =
+          encodeOctahedralNormal(Vector3{ input[0], input[1], input[2] });
+        std::memcpy(destination + i * stride, &value, sizeof(value));
+      }
+      return;
+    case mtlpp::VertexFormat::UShort2Normalized:
+      for (size_t i = begin; i < end; i++) {
+        const float* input = source.data + i * source.components;
+        uint16_t value[2] = { encodeUnorm16(input[0]),
+                              encodeUnorm16(input[1]) };
+        std::memcpy(destination + i * stride, value, sizeof(value));
+      }
+      return;
+    default:
+      throw ErrorMessage("The vertex layout does not support this format.");
+  }
+}
+
+void
+packVertices(Mesh const& mesh,
+             VertexLayoutTable const& table,
+             std::span<std::span<uint8_t>> outputs)
+{
+  size_t vertexCount = mesh.positions.size();
+  ReleaseAssert(outputs.size() == table.strides.size(),
+                "There must be one output for every buffer in the layout.");
+  for (size_t i = 0; i < outputs.size(); i++) {
+    ReleaseAssert(outputs[i].size() >= table.strides[i] * vertexCount,
+                  "A vertex layout output is too small for the mesh.");
+  }
+  if (vertexCount == 0) {
+    return;
+  }
+
+  // Resolve the attribute sources once, outside of the vertex loop.
+  std::vector<AttributeSource> sources{};
+  for (auto const& placement : table.attributes) {
+    sources.push_back(getAttributeSource(mesh, placement.attribute));
+  }
+
+  // Split the vertices into chunks, and pack every attribute of a chunk while
+  // its destination is still in the cache.
+  const size_t chunkSize = 16384;
+  size_t chunkCount = (vertexCount + chunkSize - 1) / chunkSize;
+
+  ParallelFor(chunkCount, 1, [&](size_t chunk) {
+    size_t begin = chunk * chunkSize;
+    size_t end = std::min(vertexCount, begin + chunkSize);
+
+    for (size_t i = 0; i < table.attributes.size(); i++) {
+      auto const& placement = table.attributes[i];
+      auto const& source = sources[i];
+      uint32_t destComponents = getVertexFormatComponents(placement.format);
+      uint8_t* destination =
+        outputs[placement.bufferIndex].data() + placement.offset;
+      uint32_t stride = table.strides[placement.bufferIndex];
+
+      if (!isFloatFormat(placement.format)) {
+        packQuantizedAttributeRange(
+          source, placement.format, destination, stride, begin, end);
+      } else if (source.components == 2) {
+        packAttributeRange<2>(
+          source, destComponents, destination, stride, begin, end);
+      } else {
+        packAttributeRange<3>(
+          source, destComponents, destination, stride, begin, end);
+      }
+    }
+  });
+}
+
+std::vector<std::vector<uint8_t>>
+packVertices(Mesh const& mesh, VertexLayoutTable const& table)
+{
+  std::vector<std::vector<uint8_t>> buffers{};
+  std::vector<std::span<uint8_t>> outputs{};
+  for (auto stride : table.strides) {
+    buffers.emplace_back(stride * mesh.positions.size());
+  }
+  for (auto& buffer : buffers) {
+    outputs.push_back(buffer);
+  }
+  packVertices(mesh, table, outputs);
+  return buffers;
+}
+
+mtlpp::VertexDescriptor
+createVertexDescriptor(VertexLayoutTable const& table,
+                       uint32_t firstBufferIndex)
+{
+  mtlpp::VertexDescriptor descriptor{};
+
+  // The attribute index matches the order of the layout, which is what the
+  // shader's [[attribute(n)]] refers to.
+  for (size_t i = 0; i < table.attributes.size(); i++) {
+    auto const& placement = table.attributes[i];
+    auto attribute = descriptor.GetAttributes()[i];
+    attribute.SetFormat(placement.format);
+    attribute.SetOffset(placement.offset);
+    attribute.SetBufferIndex(firstBufferIndex + placement.bufferIndex);
+  }
+
+  for (size_t i = 0; i < table.strides.size(); i++) {
+    auto layout = descriptor.GetLayouts()[firstBufferIndex + i];
+    layout.SetStride(table.strides[i]);
+    layout.SetStepFunction(mtlpp::VertexStepFunction::PerVertex);
+  }
+
+  return descriptor;
+}
+
+VertexBuffers::VertexBuffers(mtlpp::Device& device,
+                             Mesh const& mesh,
+                             VertexLayout const& layout,
+                             mtlpp::ResourceOptions options)
+  : VertexBuffers(device, mesh.positions.size(), layout, options)
+{
+  std::vector<std::span<uint8_t>> outputs{};
+  for (size_t i = 0; i < buffers.size(); i++) {
+    outputs.push_back(std::span<uint8_t>{
+      static_cast<uint8_t*>(buffers[i].buffer.GetContents()),
+      table.strides[i] * vertexCount });
+  }
+  packVertices(mesh, table, outputs);
+}
+
+VertexBuffers::VertexBuffers(mtlpp::Device& device,
+                             size_t vertexCount,
+                             VertexLayout const& layout,
+                             mtlpp::ResourceOptions options)
+  : table(compileVertexLayout(layout))
+  , vertexCount(vertexCount)
+{
+  for (auto stride : table.strides) {
+    buffers.emplace_back(device, options, stride * vertexCount);
+  }
+}
+
+BufferRefs
+VertexBuffers::Refs()
+{
+  BufferRefs refs{};
+  for (auto& buffer : buffers) {
+    refs.push_back(buffer.Ref());
+  }
+  return refs;
+}
+
+void*
+VertexBuffers::GetAttributeContents(VertexAttribute attribute,
+                                    mtlpp::VertexFormat format)
+{
+  for (auto const& placement : table.attributes) {
+    if (placement.attribute == attribute && placement.format == format &&
+        table.strides[placement.bufferIndex] == getVertexFormatSize(format)) {
+      return buffers[placement.bufferIndex].buffer.GetContents();
+    }
+  }
+  return nullptr;
+}
+
+} // namespace viz
@@ -0,0 +1,171 @@
+#pragma once
+#include "viz/metal.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+// This is included by viz/geo/mesh.h, for MeshBuffers.
+struct Mesh;
+
+/**
+ * The vertex attributes that a Mesh can provide.
+ */
+enum class VertexAttribute
+{
+  Position,
+  Normal,
+  UV,
+};
+
+struct VertexAttributeLayout
+{
+  VertexAttribute attribute;
+  mtlpp::VertexFormat format;
+};
+
+/**
+ * Describes how the vertex attributes of a mesh should be laid out for the GPU.
+ * The attributes are packed in the order they are listed. Interleaved layouts
+ * put every attribute into a single buffer, while split layouts give each
+ * attribute its own buffer.
+ *
+ * The Float formats are supported for any attribute, and Half2 and Half4 are
+ * half float conversions of them. The quantized encodings from
+ * viz/geo/quantize.h are supported as Short2Normalized octahedral normals and
+ * UShort2Normalized uvs.
+ *
+ * e.g. Interleave the positions and normals into a single buffer:
+ *
+ * VertexLayout{
+ *   .attributes = {
+ *     { VertexAttribute::Position, mtlpp::VertexFormat::Float3 },
+ *     { VertexAttribute::Normal, mtlpp::VertexFormat::Float3 },
+ *   },
+ * }
+ */
+struct VertexLayout
+{
+  std::vector<VertexAttributeLayout> attributes = {};
+  bool interleaved = true;
+};
+
+/**
+ * The layout that MeshBuffers uses by default, with the positions and then the
+ * normals in their own packed_float3 buffers.
+ */
+VertexLayout
+getFloat3VertexLayout();
+
+/**
+ * Where a single attribute ended up, after compiling a VertexLayout.
+ */
+struct VertexAttributePlacement
+{
+  VertexAttribute attribute;
+  mtlpp::VertexFormat format;
+  uint32_t bufferIndex;
+  uint32_t offset;
+};
+
+/**
+ * The stride and offset table for a VertexLayout. This matches what a
+ * pipeline's vertex descriptor needs, and what the shader will read.
+ */
+struct VertexLayoutTable
+{
+  std::vector<VertexAttributePlacement> attributes = {};
+  // The stride in bytes of each buffer.
+  std::vector<uint32_t> strides = {};
+};
+
+/**
+ * The size in bytes of a vertex format. Throws for formats that the layout
+ * compiler doesn't know how to pack.
+ */
+uint32_t
+getVertexFormatSize(mtlpp::VertexFormat format);
+
+VertexLayoutTable
+compileVertexLayout(VertexLayout const& layout);
+
+/**
+ * Pack the mesh's attributes into the buffers described by the table. There
+ * must be one output per buffer in the table, each at least
+ * stride * vertexCount bytes long. Missing components are filled with 0, apart
+ * from the w of a position, which is filled with 1.
+ */
+void
+packVertices(Mesh const& mesh,
+             VertexLayoutTable const& table,
+             std::span<std::span<uint8_t>> outputs);
+
+/**
+ * Pack a mesh into CPU-side buffers, mostly useful for measuring layouts.
+ */
+std::vector<std::vector<uint8_t>>
+packVertices(Mesh const& mesh, VertexLayoutTable const& table);
+
+/**
+ * Creates a vertex descriptor that matches the table. Buffer i of the table is
+ * bound at vertex buffer index firstBufferIndex + i.
+ */
+mtlpp::VertexDescriptor
+createVertexDescriptor(VertexLayoutTable const& table,
+                       uint32_t firstBufferIndex = 0);
+
+/**
+ * GPU buffers for a mesh's vertices in any VertexLayout. The attributes are
+ * packed straight into the buffer contents.
+ */
+class VertexBuffers
+{
+public:
+  // Move only
+  VertexBuffers(VertexBuffers&& other) = default;
+  VertexBuffers& operator=(VertexBuffers&& other) = default;
+
+  VertexBuffers(mtlpp::Device& device,
+                Mesh const& mesh,
+                VertexLayout const& layout,
+                mtlpp::ResourceOptions options);
+
+  /**
+   * Allocate the buffers for vertexCount vertices, without filling them in.
+   */
+  VertexBuffers(mtlpp::Device& device,
+                size_t vertexCount,
+                VertexLayout const& layout,
+                mtlpp::ResourceOptions options);
+
+  /**
+   * Refs to every buffer, in the order they should be bound.
+   */
+  BufferRefs Refs();
+
+  /**
+   * The contents of the attribute's buffer, when the attribute has a buffer to
+   * itself in the given format, so that it can be written to directly.
+   * Otherwise this is nullptr.
+   */
+  void* GetAttributeContents(VertexAttribute attribute,
+                             mtlpp::VertexFormat format);
+
+  /**
+   * GetAttributeContents as a span of one T per vertex, or an empty span.
+   */
+  template<typename T>
+  std::span<T> GetAttributeSpan(VertexAttribute attribute,
+                                mtlpp::VertexFormat format)
+  {
+    void* contents = GetAttributeContents(attribute, format);
+    return { static_cast<T*>(contents), contents ? vertexCount : 0 };
+  }
+
+  VertexLayoutTable table;
+  std::vector<BufferView> buffers;
+  uint32_t vertexCount;
+};
+
+} // namespace viz
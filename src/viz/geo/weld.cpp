@@ -0,0 +1,276 @@
+#include "viz/geo/weld.h"
+#include "viz/assert.h"
+#include <cmath>
+#include <unordered_set>
+
+namespace viz {
+
+static const uint32_t NO_VERTEX = ~0u;
+
+/**
+ * A uniform grid over space, where each bucket holds a linked list of the
+ * vertices in the grid cells that hash to it. Only the buckets and one link per
+ * vertex are stored, so it never needs to be rehashed.
+ */
+class SpatialHash
+{
+public:
+  SpatialHash(size_t vertexCount, float cellSize)
+    : mNext(vertexCount, NO_VERTEX)
+    , mInverseCellSize(1.0f / cellSize)
+  {
+    size_t bucketCount = 16;
+    while (bucketCount < vertexCount * 2) {
+      bucketCount *= 2;
+    }
+    mBuckets.resize(bucketCount, NO_VERTEX);
+  }
+
+  std::array<int64_t, 3> GetCell(Vector3 const& position) const
+  {
+    return { static_cast<int64_t>(std::floor(position[0] * mInverseCellSize)),
+             static_cast<int64_t>(std::floor(position[1] * mInverseCellSize)),
+             static_cast<int64_t>(std::floor(position[2] * mInverseCellSize)) };
+  }
+
+  void Insert(uint32_t vertex, std::array<int64_t, 3> const& cell)
+  {
+    uint32_t& head = mBuckets[GetBucket(cell)];
+    mNext[vertex] = head;
+    head = vertex;
+  }
+
+  /**
+   * Visit the vertices in the 27 grid cells around a cell, along with any
+   * others that share their buckets. Stops early when fn returns true.
+   */
+  template<typename Fn>
+  void ForEachNear(std::array<int64_t, 3> const& cell, Fn fn) const
+  {
+    for (int64_t x = -1; x <= 1; x++) {
+      for (int64_t y = -1; y <= 1; y++) {
+        for (int64_t z = -1; z <= 1; z++) {
+          size_t bucket = GetBucket({ cell[0] + x, cell[1] + y, cell[2] + z });
+          for (uint32_t vertex = mBuckets[bucket]; vertex != NO_VERTEX;
+               vertex = mNext[vertex]) {
+            if (fn(vertex)) {
+              return;
+            }
+          }
+        }
+      }
+    }
+  }
+
+private:
+  size_t GetBucket(std::array<int64_t, 3> const& cell) const
+  {
+    uint64_t hash = static_cast<uint64_t>(cell[0]) * 73856093u ^
+                    static_cast<uint64_t>(cell[1]) * 19349663u ^
+                    static_cast<uint64_t>(cell[2]) * 83492791u;
+    // Finish with a splitmix64 mix, so neighboring cells spread out.
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash & (mBuckets.size() - 1);
+  }
+
+  std::vector<uint32_t> mBuckets;
+  std::vector<uint32_t> mNext;
+  float mInverseCellSize;
+};
+
+template<typename CanMerge>
+static size_t
+weldPositions(std::span<const Vector3> positions,
+              float epsilon,
+              std::span<uint32_t> remap,
+              CanMerge canMerge)
+{
+  ReleaseAssert(epsilon > 0, "The weld epsilon must be positive.");
+  ReleaseAssert(remap.size() == positions.size(),
+                "The remap must have one entry per vertex.");
+
+  // With the grid cells as large as epsilon, every vertex within epsilon is
+  // in one of the 27 cells around a vertex.
+  SpatialHash hash(positions.size(), epsilon);
+  float epsilonSquared = epsilon * epsilon;
+  uint32_t nextIndex = 0;
+
+  for (uint32_t i = 0; i < positions.size(); i++) {
+    auto const& position = positions[i];
+    auto cell = hash.GetCell(position);
+    uint32_t match = NO_VERTEX;
+
+    hash.ForEachNear(cell, [&](uint32_t other) {
+      auto const& otherPosition = positions[other];
+      float distanceSquared = 0;
+      for (int j = 0; j < 3; j++) {
+        float delta = position[j] - otherPosition[j];
+        distanceSquared += delta * delta;
+      }
+      if (distanceSquared <= epsilonSquared && canMerge(i, other)) {
+        match = other;
+        return true;
+      }
+      return false;
+    });
+
+    if (match == NO_VERTEX) {
+      // Only the kept vertices go into the hash, so that a chain of close
+      // vertices doesn't drift further than epsilon from the one it's merged
+      // into.
+      remap[i] = nextIndex++;
+      hash.Insert(i, cell);
+    } else {
+      remap[i] = remap[match];
+    }
+  }
+  return nextIndex;
+}
+
+size_t
+weldPositions(std::span<const Vector3> positions,
+              float epsilon,
+              std::span<uint32_t> remap)
+{
+  return weldPositions(
+    positions, epsilon, remap, [](uint32_t, uint32_t) { return true; });
+}
+
+struct CellHash
+{
+  size_t operator()(std::array<uint32_t, 3> const& cell) const
+  {
+    uint64_t hash = (static_cast<uint64_t>(cell[0]) << 32 | cell[1]) ^
+                    (static_cast<uint64_t>(cell[2]) * 0x9e3779b97f4a7c15ull);
+    hash ^= hash >> 31;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 29;
+    return hash;
+  }
+};
+
+size_t
+removeDegenerateCells(Cells& cells,
+                      std::span<const Vector3> positions,
+                      float areaEpsilon)
+{
+  std::unordered_set<std::array<uint32_t, 3>, CellHash> seen{};
+  seen.reserve(cells.size());
+  size_t kept = 0;
+
+  for (size_t i = 0; i < cells.size(); i++) {
+    auto cell = cells[i];
+    if (cell[0] == cell[1] || cell[1] == cell[2] || cell[2] == cell[0]) {
+      continue;
+    }
+
+    auto const& a = positions[cell[0]];
+    auto const& b = positions[cell[1]];
+    auto const& c = positions[cell[2]];
+    float abx = b[0] - a[0], aby = b[1] - a[1], abz = b[2] - a[2];
+    float acx = c[0] - a[0], acy = c[1] - a[1], acz = c[2] - a[2];
+    float x = aby * acz - abz * acy;
+    float y = abz * acx - abx * acz;
+    float z = abx * acy - aby * acx;
+    float area = 0.5f * std::sqrt(x * x + y * y + z * z);
+    if (area < areaEpsilon) {
+      continue;
+    }
+
+    // Rotate the smallest index to the front, which keeps the winding, so
+    // that the same cell always has the same key.
+    std::array<uint32_t, 3> key = cell;
+    while (key[0] > key[1] || key[0] > key[2]) {
+      key = { key[1], key[2], key[0] };
+    }
+    if (!seen.insert(key).second) {
+      continue;
+    }
+
+    cells[kept++] = cell;
+  }
+
+  size_t removed = cells.size() - kept;
+  cells.resize(kept);
+  return removed;
+}
+
+template<typename List>
+static float
+getDistanceSquared(List const& list, uint32_t a, uint32_t b, int components)
+{
+  float distanceSquared = 0;
+  for (int j = 0; j < components; j++) {
+    float delta = list[a][j] - list[b][j];
+    distanceSquared += delta * delta;
+  }
+  return distanceSquared;
+}
+
+// Keep the first vertex of each group. Those are given increasing indices in
+// order, so a vertex is kept when its new index is the next one.
+template<typename List>
+static void
+compactVertexList(List& list, std::vector<uint32_t> const& remap)
+{
+  if (list.size() != remap.size()) {
+    return;
+  }
+  List result{};
+  for (size_t i = 0; i < list.size(); i++) {
+    if (remap[i] == result.size()) {
+      result.push_back(list[i]);
+    }
+  }
+  list = std::move(result);
+}
+
+WeldResult
+weldMesh(Mesh& mesh, WeldOptions options)
+{
+  size_t vertexCount = mesh.positions.size();
+  WeldResult result{ .remap = std::vector<uint32_t>(vertexCount) };
+
+  bool hasNormals = mesh.normals.size() == vertexCount;
+  bool hasUvs = mesh.uvs.size() == vertexCount;
+  size_t weldedCount = 0;
+
+  if (options.attributeEpsilon) {
+    float attributeEpsilon = options.attributeEpsilon.value();
+    float attributeEpsilonSquared = attributeEpsilon * attributeEpsilon;
+    auto canMerge = [&](uint32_t a, uint32_t b) {
+      if (hasNormals && getDistanceSquared(mesh.normals, a, b, 3) >
+                          attributeEpsilonSquared) {
+        return false;
+      }
+      return !hasUvs ||
+             getDistanceSquared(mesh.uvs, a, b, 2) <= attributeEpsilonSquared;
+    };
+    weldedCount =
+      weldPositions(mesh.positions, options.epsilon, result.remap, canMerge);
+  } else {
+    weldedCount = weldPositions(mesh.positions, options.epsilon, result.remap);
+  }
+
+  compactVertexList(mesh.positions, result.remap);
+  compactVertexList(mesh.normals, result.remap);
+  compactVertexList(mesh.uvs, result.remap);
+  result.removedVertexCount = vertexCount - weldedCount;
+
+  for (auto& cell : mesh.cells) {
+    for (auto& index : cell) {
+      ReleaseAssert(index < vertexCount, "A cell index is out of range.");
+      index = result.remap[index];
+    }
+  }
+  result.removedCellCount =
+    removeDegenerateCells(mesh.cells, mesh.positions, options.areaEpsilon);
+
+  return result;
+}
+
+} // namespace viz
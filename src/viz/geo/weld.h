@@ -0,0 +1,59 @@
+#pragma once
+#include "viz/geo/mesh.h"
+#include <array>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace viz {
+
+struct WeldOptions
+{
+  // Vertices closer together than this are merged.
+  float epsilon = 1e-6f;
+  // Only merge vertices whose normals and uvs are also within this of each
+  // other, so that attribute seams are kept. Set to std::nullopt to merge on
+  // position alone.
+  std::optional<float> attributeEpsilon = 1e-4f;
+  // Cells with less than this much area are removed.
+  float areaEpsilon = 1e-12f;
+};
+
+struct WeldResult
+{
+  // remap[oldIndex] = newIndex for every original vertex.
+  std::vector<uint32_t> remap;
+  size_t removedVertexCount;
+  size_t removedCellCount;
+};
+
+/**
+ * Find the vertices that are within epsilon of an earlier vertex, using a
+ * uniform spatial hash, so this runs in linear time. Fills in remap[oldIndex]
+ * with the new index, where the first vertex of each group is kept, in order.
+ * Returns the number of vertices that are left.
+ */
+size_t
+weldPositions(std::span<const Vector3> positions,
+              float epsilon,
+              std::span<uint32_t> remap);
+
+/**
+ * Remove cells that repeat a vertex, have less than areaEpsilon area, or that
+ * repeat an earlier cell with the same winding. The order of the remaining
+ * cells is kept. Returns the number of cells that were removed.
+ */
+size_t
+removeDegenerateCells(Cells& cells,
+                      std::span<const Vector3> positions,
+                      float areaEpsilon = 1e-12f);
+
+/**
+ * Merge the mesh's duplicate vertices, rewrite the cells to use them, and
+ * strip the degenerate and duplicate cells. Vertices that end up unreferenced
+ * are kept, optimizeVertexFetch can drop them.
+ */
+WeldResult
+weldMesh(Mesh& mesh, WeldOptions options = {});
+
+} // namespace viz
@@ -541,6 +541,9 @@ public:
 
 // Taken from: https://github.com/mikolalysenko/angle-normals/pull/1
 // MIT License, Mikola Lysenko, with Ricky Reusser.
+//
+// This is the simple single threaded version. computeAngleNormalsPackedParallel
+// in viz/geo/normals.h gives identical results, and runs in parallel.
 template<typename Decimal, typename Integer>
 std::vector<Decimal>
 ComputeAngleNormalsPacked(const std::span<Integer>& cells,
@@ -144,6 +144,13 @@ public:
     , data(std::span<T>{ static_cast<T*>(buffer.GetContents()), list.size() })
   {}
 
+  // Initialize a BufferViewList of a given size, without writing to it. The
+  // contents can then be filled in through the data span.
+  BufferViewList(Device& device, mtlpp::ResourceOptions options, size_t size)
+    : BufferView(device, options, sizeof(T) * size)
+    , data(std::span<T>{ static_cast<T*>(buffer.GetContents()), size })
+  {}
+
   // Initialize the BufferViewList through a callback.
   template<typename Fn>
   BufferViewList(Fn fn,
@@ -861,6 +868,8 @@ struct RenderPipelineInitializer
   std::optional<const mtlpp::PixelFormat> depthAttachmentPixelFormat =
     std::nullopt;
   std::vector<mtlpp::PixelFormat> colorAttachmentPixelFormats = {};
+  // Only needed when the vertex shader reads its inputs with [[stage_in]].
+  std::optional<mtlpp::VertexDescriptor> vertexDescriptor = std::nullopt;
   // TODO - Add more options as they are needed
 };
 
@@ -896,6 +905,8 @@ struct DrawIndexedInitializer
   std::optional<uint32_t> instanceCount;
   std::optional<mtlpp::CullMode> cullMode;
   std::optional<mtlpp::DepthStencilState> depthStencilState;
+  // The offset in bytes into the index buffer, for drawing a range of cells.
+  std::optional<uint32_t> indexBufferOffset;
 };
 
 struct DrawInitializer
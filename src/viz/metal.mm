@@ -212,6 +212,10 @@ InitializeRenderPipeline(RenderPipelineInitializer&& initializer)
       initializer.colorAttachmentPixelFormats[i]);
   }
 
+  if (initializer.vertexDescriptor) {
+    descriptor.SetVertexDescriptor(initializer.vertexDescriptor.value());
+  }
+
   if (std::getenv("LOG_SHADER_CALLS")) {
     // clang-format off
     std::cout << "-------------------------------------------" << std::endl;
@@ -408,7 +412,8 @@ AutoDraw::DrawIndexed(DrawIndexedInitializer&& initializer)
          fragmentInputs,
          instanceCount,
          cullMode,
-         depthStencilState] = initializer;
+         depthStencilState,
+         indexBufferOffset] = initializer;
 
   // This command doesn't know about multiple color attachments. Handle the
   // clear statement. This was a big motiviation for originally creating this
@@ -476,18 +481,19 @@ AutoDraw::DrawIndexed(DrawIndexedInitializer&& initializer)
     // clang-format on
   }
 
-  uint32_t indexBufferOffset = 0;
-
   if (instanceCount) {
     renderCommandEncoder.DrawIndexed(primitiveType,
                                      indexCount,
                                      indexType,
                                      indexBuffer,
-                                     indexBufferOffset,
+                                     indexBufferOffset.value_or(0),
                                      instanceCount.value());
   } else {
-    renderCommandEncoder.DrawIndexed(
-      primitiveType, indexCount, indexType, indexBuffer, indexBufferOffset);
+    renderCommandEncoder.DrawIndexed(primitiveType,
+                                     indexCount,
+                                     indexType,
+                                     indexBuffer,
+                                     indexBufferOffset.value_or(0));
   }
 
   renderCommandEncoder.EndEncoding();
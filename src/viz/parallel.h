@@ -0,0 +1,64 @@
+#pragma once
+#include <algorithm> // std::min, std::max
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace viz {
+
+/**
+ * The number of threads that the parallel helpers will spread work across.
+ */
+inline size_t
+GetThreadCount()
+{
+  size_t count = std::thread::hardware_concurrency();
+  return count == 0 ? 1 : count;
+}
+
+/**
+ * Calls fn(i) for every i in [0, count) across worker threads, and returns once
+ * every index has been visited. Indices are handed out in chunks of grainSize
+ * from a shared counter, so uneven work still balances across the threads. The
+ * calling thread does work as well.
+ *
+ * The function must be safe to call concurrently for different indices, and
+ * must not throw.
+ */
+template<typename Fn>
+void
+ParallelFor(size_t count, size_t grainSize, Fn fn)
+{
+  if (count == 0) {
+    return;
+  }
+  grainSize = std::max<size_t>(grainSize, 1);
+  size_t chunkCount = (count + grainSize - 1) / grainSize;
+  size_t threadCount = std::min(GetThreadCount(), chunkCount);
+  std::atomic<size_t> nextChunk = 0;
+
+  auto worker = [&]() {
+    for (;;) {
+      size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+      if (chunk >= chunkCount) {
+        return;
+      }
+      size_t end = std::min(count, (chunk + 1) * grainSize);
+      for (size_t i = chunk * grainSize; i < end; i++) {
+        fn(i);
+      }
+    }
+  };
+
+  std::vector<std::thread> threads{};
+  threads.reserve(threadCount - 1);
+  for (size_t i = 1; i < threadCount; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace viz
@@ -0,0 +1,80 @@
+#pragma once
+#include <simd/simd.h>
+
+/**
+ * Decoders for the quantized vertex formats in viz/geo/quantize.h. This header
+ * is shared between C++ and Metal, like shader-utils.h.
+ *
+ * e.g. Reading a quantized vertex from raw buffers:
+ *
+ * float3 position = quantize::decodeBoundsPosition(positions[vid], *bounds);
+ * float3 normal = quantize::decodeOctahedralNormal(normals[vid]);
+ * float2 uv = quantize::decodeUV(uvs[vid]);
+ */
+
+/**
+ * Bounds16 positions are stored as unorm16 values relative to the mesh's
+ * bounding box. Bind this alongside them so that they can be decoded.
+ */
+struct QuantizedBounds
+{
+  simd::float3 min;
+  simd::float3 extent;
+};
+
+#ifdef __METAL_VERSION__
+#include <metal_stdlib>
+
+namespace quantize {
+
+/**
+ * Decode a position that was read through a UShort4Normalized vertex
+ * attribute, or from a ushort4 buffer.
+ */
+inline float3
+decodeBoundsPosition(float3 unorm, constant QuantizedBounds& bounds)
+{
+  return bounds.min + unorm * bounds.extent;
+}
+
+inline float3
+decodeBoundsPosition(ushort4 packed, constant QuantizedBounds& bounds)
+{
+  return decodeBoundsPosition(float3(packed.xyz) / 65535.0, bounds);
+}
+
+inline float3
+decodeHalfPosition(half4 packed)
+{
+  return float3(packed.xyz);
+}
+
+/**
+ * Decode a normal that was read through a Short2Normalized vertex attribute.
+ * This is the branchless form from "A Survey of Efficient Representations for
+ * Independent Unit Vectors", Cigolle et al. 2014.
+ */
+inline float3
+decodeOctahedralNormal(float2 encoded)
+{
+  float3 normal = float3(encoded, 1.0 - metal::abs(encoded.x) -
+                                    metal::abs(encoded.y));
+  float fold = metal::saturate(-normal.z);
+  normal.xy += metal::select(float2(fold), float2(-fold), normal.xy >= 0.0);
+  return metal::normalize(normal);
+}
+
+inline float3
+decodeOctahedralNormal(uint packed)
+{
+  return decodeOctahedralNormal(metal::unpack_snorm2x16_to_float(packed));
+}
+
+inline float2
+decodeUV(uint packed)
+{
+  return metal::unpack_unorm2x16_to_float(packed);
+}
+
+} // namespace quantize
+#endif